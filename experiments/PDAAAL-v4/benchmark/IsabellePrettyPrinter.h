@@ -339,7 +339,7 @@ end
                     accepting_ctr_loc_st.push_back(from);
                 }
             }
-            for (const auto&[to, labels]: state->_edges) {
+            for (const auto&[to, labels]: state->edges()) {
                 for (const auto& label: labels) {
                     if (first) {
                         first = false;
@@ -0,0 +1,321 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures the throughput of the solver engines on a directory of test instances (pda<i>.json, initial<i>.json, final<i>.json),
+// e.g. the random test set (experiments/random-tests-json.tar.gz) or a network test set in the same format.
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <boost/program_options.hpp>
+#include <pdaaal/Solver.h>
+#include <pdaaal/TypedPAutomaton.h>
+#include "../src/pdaaal-bin/parsing/PdaJsonParser.h"
+#include "../src/pdaaal-bin/utils/stopwatch.h"
+
+namespace fs = std::filesystem;
+namespace po = boost::program_options;
+using namespace pdaaal;
+
+struct instance_files_t {
+    size_t index;
+    std::string pda;
+    std::string initial;
+    std::string final;
+};
+
+std::optional<std::string> read_file(const fs::path& path) {
+    std::ifstream stream(path);
+    if (!stream.is_open()) return std::nullopt;
+    std::stringstream content;
+    content << stream.rdbuf();
+    return content.str();
+}
+
+template <typename pda_t, typename W = weight<void>>
+using engine_fn = std::function<bool(const pda_t&, PAutomaton<W>, PAutomaton<W>)>;
+
+template <typename pda_t, typename W>
+std::vector<std::pair<std::string, engine_fn<pda_t,W>>> all_engines() {
+    std::vector<std::pair<std::string, engine_fn<pda_t,W>>> engines{
+        {"post", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::post_star_accepts(instance);
+        }},
+        {"post-no-trace", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::post_star_accepts<Trace_Type::None>(instance);
+        }},
+        {"post-no-ET", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::post_star_accepts_no_ET(instance);
+        }},
+        {"post-no-ET-no-trace", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::post_star_accepts_no_ET<Trace_Type::None>(instance);
+        }},
+        {"post-no-ET-emptiness", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            instance.enable_emptiness_only();
+            return Solver::post_star_accepts_no_ET<Trace_Type::None>(instance);
+        }},
+        {"pre", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::pre_star_accepts(instance);
+        }},
+        {"pre-emptiness", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            instance.enable_emptiness_only();
+            return Solver::pre_star_accepts(instance);
+        }},
+        {"dual", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::dual_search_accepts(instance);
+        }},
+        {"dual-frontier", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::dual_search_accepts(instance, budget(), Dual_Policy::Frontier);
+        }},
+        {"dual-edges", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::dual_search_accepts(instance, budget(), Dual_Policy::Edges);
+        }},
+    };
+    if constexpr (W::is_weight) {
+        // Shortest trace post*, pre* and dual*, including finding the trace. The priority queue depends on the weight type (see shortest_queue).
+        engines.emplace_back("post-shortest", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            if (!Solver::post_star_accepts<Trace_Type::Shortest>(instance)) return false;
+            return !Solver::get_trace<Trace_Type::Shortest>(instance).first.empty();
+        });
+        engines.emplace_back("pre-shortest", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            if (!Solver::pre_star_accepts<Trace_Type::Shortest>(instance)) return false;
+            return !Solver::get_trace<Trace_Type::Shortest>(instance).first.empty();
+        });
+        engines.emplace_back("dual-shortest", [](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            if (!Solver::dual_search_accepts<Trace_Type::Shortest>(instance)) return false;
+            return !Solver::get_trace_dual_search<Trace_Type::Shortest>(instance).first.empty();
+        });
+    }
+    return engines;
+}
+
+// Engines parameterized by a number of threads are named <engine>/<threads>, e.g. pre-parallel/4.
+template <typename pda_t, typename W>
+std::optional<engine_fn<pda_t,W>> threaded_engine(const std::string& name) {
+    auto pos = name.find('/');
+    if (pos == std::string::npos) return std::nullopt;
+    size_t threads = 0;
+    try {
+        threads = std::stoul(name.substr(pos + 1));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    if (name.substr(0, pos) == "pre-parallel") {
+        return [threads](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::pre_star_parallel_accepts(instance, threads);
+        };
+    }
+    if (name.substr(0, pos) == "post-parallel") {
+        return [threads](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::post_star_parallel_accepts(instance, threads);
+        };
+    }
+    if (name.substr(0, pos) == "dual-parallel") {
+        return [threads](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::dual_search_parallel_accepts(instance, threads);
+        };
+    }
+    return std::nullopt;
+}
+
+// Engines with a workset policy are named <engine>:<policy>, e.g. post:distance (see Workset_Policy).
+template <typename pda_t, typename W>
+std::optional<engine_fn<pda_t,W>> workset_engine(const std::string& name) {
+    auto pos = name.find(':');
+    if (pos == std::string::npos) return std::nullopt;
+    Workset_Policy policy;
+    std::istringstream policy_stream(name.substr(pos + 1));
+    if (!(policy_stream >> policy)) return std::nullopt;
+    if (name.substr(0, pos) == "pre") {
+        return [policy](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::pre_star_accepts(instance, budget(), policy);
+        };
+    }
+    if (name.substr(0, pos) == "post") {
+        return [policy](const pda_t& pda, PAutomaton<W> initial, PAutomaton<W> final) {
+            PAutomatonProduct instance(pda, std::move(initial), std::move(final));
+            return Solver::post_star_accepts(instance, budget(), policy);
+        };
+    }
+    return std::nullopt;
+}
+
+template <typename W, bool use_state_names>
+int run(const std::vector<instance_files_t>& instances, const std::vector<std::string>& engine_names, size_t repeat) {
+    using pda_t = decltype(PdaJSONParser::parse<W,use_state_names>(std::declval<std::istream&>(), std::declval<std::ostream&>()));
+    auto engines = all_engines<pda_t,W>();
+    std::vector<std::pair<std::string, engine_fn<pda_t,W>>> selected;
+    for (const auto& name : engine_names) {
+        auto it = std::find_if(engines.begin(), engines.end(), [&name](const auto& e){ return e.first == name; });
+        if (it != engines.end()) {
+            selected.push_back(*it);
+        } else if (auto engine = threaded_engine<pda_t,W>(name); engine) {
+            selected.emplace_back(name, std::move(engine).value());
+        } else if (auto workset_engine_fn = workset_engine<pda_t,W>(name); workset_engine_fn) {
+            selected.emplace_back(name, std::move(workset_engine_fn).value());
+        } else {
+            std::cerr << "Unknown engine: " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<stopwatch> timers(selected.size(), stopwatch(false));
+    std::vector<size_t> accepted(selected.size(), 0);
+    for (const auto& files : instances) {
+        std::stringstream dummy;
+        std::istringstream pda_stream(files.pda);
+        auto pda = PdaJSONParser::parse<W,use_state_names>(pda_stream, dummy);
+        std::optional<bool> answer;
+        for (size_t e = 0; e < selected.size(); ++e) {
+            for (size_t r = 0; r < repeat; ++r) {
+                std::istringstream initial_stream(files.initial), final_stream(files.final);
+                auto initial_automaton = PAutomatonJsonParser::parse(initial_stream, pda);
+                auto final_automaton = PAutomatonJsonParser::parse(final_stream, pda);
+                timers[e].start();
+                bool result = selected[e].second(pda, std::move(initial_automaton), std::move(final_automaton));
+                timers[e].stop();
+                if (r == 0) {
+                    if (result) ++accepted[e];
+                    if (answer && answer.value() != result) {
+                        std::cerr << "Engines disagree on instance " << files.index << " (" << selected[e].first << ")" << std::endl;
+                    }
+                    answer = result;
+                }
+            }
+        }
+    }
+
+    std::cout << std::left << std::setw(24) << "engine" << std::setw(14) << "time (s)" << std::setw(18) << "instances/s" << std::setw(10) << "accepted" << std::endl;
+    for (size_t e = 0; e < selected.size(); ++e) {
+        auto time = timers[e].duration();
+        std::cout << std::left << std::setw(24) << selected[e].first << std::setw(14) << time
+                  << std::setw(18) << (time > 0 ? (double)(instances.size() * repeat) / time : 0.0)
+                  << std::setw(10) << accepted[e] << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, const char** argv) {
+    po::options_description opts;
+    opts.add_options()
+            ("help,h", "produce help message");
+
+    po::options_description input("Input Options");
+    std::string input_dir;
+    size_t from = 0;
+    size_t to = std::numeric_limits<size_t>::max();
+    size_t repeat = 1;
+    bool state_names = false;
+    std::vector<std::string> engine_names{"post", "post-no-trace"};
+    size_t max_threads = 0;
+    bool worksets = false;
+    std::string weights = "none";
+    input.add_options()
+            ("dir,d", po::value<std::string>(&input_dir), "Input directory with files pda<i>.json, initial<i>.json and final<i>.json.")
+            ("from", po::value<size_t>(&from), "Index of first instance (default 0).")
+            ("to", po::value<size_t>(&to), "Index after last instance (default: until a file is missing).")
+            ("repeat,r", po::value<size_t>(&repeat), "Number of times to run each engine on each instance.")
+            ("state-names", po::bool_switch(&state_names), "Enable named states (instead of index).")
+            ("engines,e", po::value<std::vector<std::string>>(&engine_names)->multitoken(),
+                    "Engines to compare: post, post-no-trace, post-no-ET, post-no-ET-no-trace, post-no-ET-emptiness, pre, pre-emptiness, dual, dual-frontier, dual-edges, pre-parallel/<threads>, post-parallel/<threads>, dual-parallel/<threads>, pre:<workset>, post:<workset>, and with --weights: post-shortest, pre-shortest, dual-shortest.")
+            ("threads", po::value<size_t>(&max_threads),
+                    "Measure thread scaling: adds pre-parallel/<k> and post-parallel/<k> for k = 1, 2, 4, ... up to the given number of threads.")
+            ("worksets", po::bool_switch(&worksets),
+                    "Compare workset policies: adds pre:<workset> and post:<workset> for workset = lifo, fifo, distance, label, goal.")
+            ("weights", po::value<std::string>(&weights),
+                    "Weight type of the PDA rules: none (default), uint32 or int32. "
+                    "Shortest trace post* and pre* use a radix heap for uint32 and a 4-ary heap for int32, so running post-shortest or pre-shortest with both compares the priority queues.")
+            ;
+    opts.add(input);
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opts), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << opts << std::endl;
+        return 1;
+    }
+    if (input_dir.empty()) {
+        std::cerr << "Please specify an input directory";
+        return 1;
+    }
+    fs::path input_dir_path(input_dir);
+    if (!fs::is_directory(input_dir_path)) {
+        std::cerr << "Specified input directory: " << input_dir_path << " is not a valid directory.";
+        return 1;
+    }
+
+    for (size_t k = 1; k <= max_threads; k = k < max_threads && 2 * k > max_threads ? max_threads : 2 * k) {
+        engine_names.push_back("pre-parallel/" + std::to_string(k));
+        engine_names.push_back("post-parallel/" + std::to_string(k));
+    }
+    if (worksets) {
+        for (const auto& engine : {"pre", "post"}) {
+            for (auto policy : {Workset_Policy::LIFO, Workset_Policy::FIFO, Workset_Policy::Distance, Workset_Policy::Label, Workset_Policy::Goal}) {
+                std::stringstream name;
+                name << engine << ":" << policy;
+                engine_names.push_back(name.str());
+            }
+        }
+    }
+
+    std::vector<instance_files_t> instances;
+    for (size_t i = from; i < to; ++i) {
+        auto index = std::to_string(i);
+        auto pda = read_file(input_dir_path / ("pda" + index + ".json"));
+        auto initial = read_file(input_dir_path / ("initial" + index + ".json"));
+        auto final = read_file(input_dir_path / ("final" + index + ".json"));
+        if (!pda || !initial || !final) break;
+        instances.push_back(instance_files_t{i, std::move(pda).value(), std::move(initial).value(), std::move(final).value()});
+    }
+    std::cout << "Loaded " << instances.size() << " instances." << std::endl;
+
+    auto run_weights = [&](auto w) {
+        using W = decltype(w);
+        return state_names ? run<W,true>(instances, engine_names, repeat) : run<W,false>(instances, engine_names, repeat);
+    };
+    if (weights == "none") {
+        return run_weights(weight<void>());
+    } else if (weights == "uint32") {
+        return run_weights(weight<uint32_t>());
+    } else if (weights == "int32") {
+        return run_weights(weight<int32_t>());
+    }
+    std::cerr << "Unknown weight type: " << weights << std::endl;
+    return 1;
+}
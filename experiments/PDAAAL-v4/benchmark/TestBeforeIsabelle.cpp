@@ -31,18 +31,21 @@ using namespace pdaaal;
 template <typename pda_t>
 bool solve_pre(const pda_t& pda, PAutomaton<> initial_automaton, PAutomaton<> final_automaton) {
     PAutomatonProduct instance(pda, std::move(initial_automaton), std::move(final_automaton));
+    instance.enable_emptiness_only();
     bool answer = Solver::pre_star_accepts(instance);
     return answer;
 }
 template <typename pda_t>
 bool solve_post(const pda_t& pda, PAutomaton<> initial_automaton, PAutomaton<> final_automaton) {
     PAutomatonProduct instance(pda, std::move(initial_automaton), std::move(final_automaton));
+    instance.enable_emptiness_only();
     bool answer = Solver::post_star_accepts(instance);
     return answer;
 }
 template <typename pda_t>
 bool solve_dual(const pda_t& pda, PAutomaton<> initial_automaton, PAutomaton<> final_automaton) {
     PAutomatonProduct instance(pda, std::move(initial_automaton), std::move(final_automaton));
+    instance.enable_emptiness_only();
     bool answer = Solver::dual_search_accepts(instance);
     return answer;
 }
@@ -29,7 +29,11 @@
 
 #include <pdaaal/TypedPDA.h>
 #include <pdaaal/utils/fut_set.h>
+#include <pdaaal/utils/arena.h>
+#include <pdaaal/utils/frozen_edges.h>
+#include <pdaaal/utils/indexed_heap.h>
 #include <pdaaal/NFA.h>
+#include <absl/hash/hash.h>
 
 #include <memory>
 #include <functional>
@@ -49,11 +53,39 @@ namespace pdaaal {
         ShortestFixedPoint // TODO: Detect the need for fixed-point computation automatically.
     };
 
-    template<typename W, Trace_Type trace_type> using solver_weight = std::conditional_t<trace_type == Trace_Type::Longest, max_weight<typename W::type>, min_weight<typename W::type>>;
+    namespace details {
+        template<typename W, Trace_Type trace_type, typename = void>
+        struct solver_weight_select {
+            using type = std::conditional_t<trace_type == Trace_Type::Longest, max_weight<typename W::type>, min_weight<typename W::type>>;
+        };
+        template<typename W, Trace_Type trace_type>
+        struct solver_weight_select<W, trace_type, std::enable_if_t<is_semiring_weight<W>>> {
+            static_assert(trace_type != Trace_Type::Longest, "A semiring weight defines which weights are better. Use Trace_Type::Shortest or Trace_Type::ShortestFixedPoint.");
+            static_assert(trace_type == Trace_Type::ShortestFixedPoint || is_selective<typename W::semiring>,
+                          "A semiring without a selective combine has no single best trace. Use Trace_Type::ShortestFixedPoint.");
+            using type = semiring_impl<typename W::semiring>;
+        };
+    }
+    template<typename W, Trace_Type trace_type> using solver_weight = typename details::solver_weight_select<W,trace_type>::type;
 
+    namespace details {
+        template<typename SolverW>
+        struct solver_weight_less {
+            bool operator()(const typename SolverW::type& lhs, const typename SolverW::type& rhs) const { return SolverW::less(lhs, rhs); }
+        };
+    }
+    // Priority queue (see indexed_heap.h) for the Dijkstra searches of shortest traces.
+    // Unsigned integer weights (of min_weight) use a radix heap. Other weights use a 4-ary heap ordered by solver_weight.
+    template<typename W, Trace_Type trace_type = Trace_Type::Shortest>
+    using shortest_queue = std::conditional_t<trace_type != Trace_Type::Longest && std::is_unsigned_v<typename W::type> && !is_semiring_weight<W>,
+                                              indexed_radix_heap<typename W::type>,
+                                              indexed_dary_heap<typename W::type, details::solver_weight_less<solver_weight<W,trace_type>>>>;
+
+    // Automaton states and rule ids are stored in 32 bits, so a trace_t is 12 bytes. PAutomaton::add_state checks that state ids fit.
     struct trace_t {
-        size_t _state = std::numeric_limits<size_t>::max(); // _state = p
-        size_t _rule_id = std::numeric_limits<size_t>::max(); // size_t _to = pda.states()[_from]._rules[_rule_id]._to; // _to = q
+        static constexpr uint32_t no_state = std::numeric_limits<uint32_t>::max();
+        uint32_t _state = no_state; // _state = p
+        uint32_t _rule_id = std::numeric_limits<uint32_t>::max(); // size_t _to = pda.states()[_from]._rules[_rule_id]._to; // _to = q
         uint32_t _label = std::numeric_limits<uint32_t>::max(); // _label = \gamma
         // if is_null() { return; all is invalid. }
         // if is_pre_trace() {
@@ -65,13 +97,13 @@ namespace pdaaal {
         constexpr trace_t() = default;
 
         constexpr trace_t(size_t rule_id, size_t temp_state)
-                : _state(temp_state), _rule_id(rule_id), _label(std::numeric_limits<uint32_t>::max() - 1) {};
+                : _state(static_cast<uint32_t>(temp_state)), _rule_id(static_cast<uint32_t>(rule_id)), _label(std::numeric_limits<uint32_t>::max() - 1) {};
 
         constexpr trace_t(size_t from, size_t rule_id, uint32_t label)
-                : _state(from), _rule_id(rule_id), _label(label) {};
+                : _state(static_cast<uint32_t>(from)), _rule_id(static_cast<uint32_t>(rule_id)), _label(label) {};
 
         constexpr explicit trace_t(size_t epsilon_state)
-                : _state(epsilon_state) {};
+                : _state(static_cast<uint32_t>(epsilon_state)) {};
 
         [[nodiscard]] constexpr bool is_pre_trace() const {
             return _label == std::numeric_limits<uint32_t>::max() - 1;
@@ -80,26 +112,48 @@ namespace pdaaal {
             return _label == std::numeric_limits<uint32_t>::max();
         }
         [[nodiscard]] constexpr bool is_null() const {
-            return _state == std::numeric_limits<size_t>::max() &&
-                   _rule_id == std::numeric_limits<size_t>::max() &&
+            return _state == no_state &&
+                   _rule_id == std::numeric_limits<uint32_t>::max() &&
                    _label == std::numeric_limits<uint32_t>::max();
         }
+        constexpr bool operator==(const trace_t& other) const {
+            return _state == other._state && _rule_id == other._rule_id && _label == other._label;
+        }
+        constexpr bool operator!=(const trace_t& other) const {
+            return !(*this == other);
+        }
+        template <typename H>
+        friend H AbslHashValue(H h, const trace_t& trace) {
+            return H::combine(std::move(h), trace._state, trace._rule_id, trace._label);
+        }
     };
 
-    template<bool indirect> using trace_ = std::conditional_t<indirect, const trace_t*, trace_t>;
-    template<bool indirect> inline constexpr trace_<indirect> default_trace_() {
-        if constexpr (indirect) {
-            return nullptr;
-        } else {
-            return trace_t();
+    // Refers to a trace_t stored in the trace information of a PAutomaton. Use PAutomaton::get_trace to look it up.
+    struct trace_handle {
+        static constexpr uint32_t null_id = std::numeric_limits<uint32_t>::max();
+        uint32_t _id = null_id;
+
+        constexpr trace_handle() = default;
+        constexpr trace_handle(std::nullptr_t) {}; // The null handle. Allows nullptr where traces used to be pointers.
+        constexpr explicit trace_handle(uint32_t id) : _id(id) {};
+
+        [[nodiscard]] constexpr bool is_null() const {
+            return _id == null_id;
+        }
+        constexpr bool operator==(const trace_handle& other) const {
+            return _id == other._id;
         }
+        constexpr bool operator!=(const trace_handle& other) const {
+            return _id != other._id;
+        }
+    };
+
+    template<bool indirect> using trace_ = std::conditional_t<indirect, trace_handle, trace_t>;
+    template<bool indirect> inline constexpr trace_<indirect> default_trace_() {
+        return trace_<indirect>();
     }
     template<bool indirect> inline constexpr bool trace_is_null(trace_<indirect> trace) {
-        if constexpr (indirect) {
-            return trace == nullptr;
-        } else {
-            return trace.is_null();
-        }
+        return trace.is_null();
     }
     template<typename W, bool indirect = true> using trace_ptr = std::conditional_t<is_weighted<W>, std::pair<trace_<indirect>, typename W::type>, trace_<indirect>>;
     template<typename W, bool indirect = true> inline constexpr trace_ptr<W,indirect> default_trace_ptr() {
@@ -126,19 +180,34 @@ namespace pdaaal {
 
     // indirect trace_info saves space for normal pre* and post*, but for weighted fixed point versions it might not,
     // since we need to update it several times, and we don't know when it is safe to delete from _trace_info.
+    // Indirect trace information is stored (without duplicates) in an arena, and edges refer to it by 32-bit trace_handle.
     template <typename W = weight<void>, bool indirect = true>
     class PAutomaton {
     public:
         static constexpr auto epsilon = std::numeric_limits<uint32_t>::max();
+        // A wildcard edge (from, wildcard, to) stands for the edges (from, l, to) for all labels l, sharing one trace.
+        // pre* adds these for rules with wildcard pre-label instead of one edge per label.
+        static constexpr auto wildcard = std::numeric_limits<uint32_t>::max() - 1;
+
+        using edge_set_t = fut::set<std::tuple<size_t,uint32_t,trace_ptr<W,indirect>>, fut::type::hash, fut::type::vector>;
 
         struct state_t {
             bool _accepting = false;
             size_t _id;
-            fut::set<std::tuple<size_t,uint32_t,trace_ptr<W,indirect>>, fut::type::hash, fut::type::vector> _edges;
 
             state_t(bool accepting, size_t id) : _accepting(accepting), _id(id) {};
 
             state_t(const state_t &other) = default;
+
+            // The outgoing edges. A frozen automaton keeps its edges elsewhere, so read them through PAutomaton::with_edges while it may be frozen.
+            [[nodiscard]] const edge_set_t& edges() const {
+                assert(!_frozen);
+                return _edges;
+            }
+        private:
+            friend class PAutomaton;
+            edge_set_t _edges;
+            bool _frozen = false;
         };
 
     public:
@@ -184,10 +253,11 @@ namespace pdaaal {
         }
         PAutomaton(PAutomaton<W,indirect>&& other, const PDA<W>& pda) noexcept // Move constructor, but update reference to PDA.
         : _states(std::move(other._states)), _initial(std::move(other._initial)),
-          _accepting(std::move(other._accepting)), _trace_info(std::move(other._trace_info)), _pda(pda) {};
+          _accepting(std::move(other._accepting)), _frozen(other._frozen), _frozen_edges(std::move(other._frozen_edges)),
+          _trace_info(std::move(other._trace_info)), _pda(pda) {};
 
         PAutomaton(PAutomaton<W,indirect> &&) noexcept = default;
-        PAutomaton(const PAutomaton<W,indirect>& other) : _pda(other._pda) {
+        PAutomaton(const PAutomaton<W,indirect>& other) : _frozen(other._frozen), _frozen_edges(other._frozen_edges), _pda(other._pda) {
             assert(other._trace_info.empty()); // This should not be needed. Otherwise, implement it...
             std::unordered_map<state_t *, state_t *> indir;
             for (auto &s : other._states) {
@@ -216,6 +286,8 @@ namespace pdaaal {
             assert(other._states.size() >= pda_size);
             assert(other._initial.size() == pda_size);
             size_t offset = automaton_size - pda_size;
+            thaw();
+            other.thaw();
             for (size_t i = 0; i < other._states.size(); ++i) {
                 assert(i >= pda_size || _initial[i]->_id == i);
                 assert(i >= pda_size || other._initial[i]->_id == i);
@@ -238,6 +310,13 @@ namespace pdaaal {
         void to_dot(std::ostream &out,
                     const std::function<void(std::ostream &, const uint32_t&)>& label_printer = [](auto &s, auto &l){ s << l; },
                     const std::function<void(std::ostream &, const size_t&)>& state_printer = [](auto &s, auto &id){ s << id; }) const {
+            with_edges([&](const auto& edges){ to_dot(out, label_printer, state_printer, edges); });
+        }
+    private:
+        template<typename Edges>
+        void to_dot(std::ostream &out,
+                    const std::function<void(std::ostream &, const uint32_t&)>& label_printer,
+                    const std::function<void(std::ostream &, const size_t&)>& state_printer, const Edges& edges) const {
             out << "digraph NFA {\n";
             for (const auto& s : _states) {
                 out << "\"";
@@ -246,20 +325,25 @@ namespace pdaaal {
                 if (s->_accepting)
                     out << "double";
                 out << "circle];\n";
-                for (const auto& [to, labels] : s->_edges) {
+                for (const auto& [to, labels] : edges(s->_id)) {
                     out << "\"";
                     state_printer(out, s->_id);
                     out << "\" -> \"";
                     state_printer(out, to);
                     out << "\" [ label=\"";
                     auto has_epsilon = labels.contains(epsilon);
-                    auto size = labels.size() - (has_epsilon ? 1 : 0);
+                    auto has_wildcard = labels.contains(wildcard);
+                    auto size = labels.size() - (has_epsilon ? 1 : 0) - (has_wildcard ? 1 : 0);
+                    if (has_wildcard) {
+                        out << "*";
+                        if (size > 0) out << " ";
+                    }
                     if constexpr(is_weighted<W>) {
                         if (size > 0) {
                             out << "\\[";
                             bool first = true;
                             for (const auto& [l,tw] : labels) {
-                                if (l == epsilon) { continue; }
+                                if (l == epsilon || l == wildcard) { continue; }
                                 if (!first)
                                     out << ", ";
                                 first = false;
@@ -283,13 +367,13 @@ namespace pdaaal {
                             out << "\\]";
                         }
                     } else {
-                        if (size == number_of_labels()) {
+                        if (size == number_of_labels() && !has_wildcard) {
                             out << "*";
                         } else if (size > 0) {
                             out << "\\[";
                             bool first = true;
                             for (const auto& [l,tw] : labels) {
-                                if (l == epsilon) { continue; }
+                                if (l == epsilon || l == wildcard) { continue; }
                                 if (!first)
                                     out << ", ";
                                 first = false;
@@ -319,10 +403,19 @@ namespace pdaaal {
             }
             out << "}\n";
         }
+    public:
 
         [[nodiscard]] bool accepts(size_t state, const std::vector<uint32_t> &stack) const {
             //Equivalent to (but hopefully faster than): return !_accept_path(state, stack).empty();
-
+            return with_edges([&](const auto& edges){ return accepts(state, stack, edges); });
+        }
+        template<Trace_Type trace_type = Trace_Type::Any>
+        [[nodiscard]] auto accept_path(size_t state, const std::vector<uint32_t> &stack) const {
+            return with_edges([&](const auto& edges){ return accept_path<trace_type>(state, stack, edges); });
+        }
+    private:
+        template<typename Edges>
+        [[nodiscard]] bool accepts(size_t state, const std::vector<uint32_t> &stack, const Edges& edges) const {
             if (stack.empty()) {
                 return _states[state]->_accepting;
             }
@@ -334,8 +427,8 @@ namespace pdaaal {
                 search_stack.pop();
                 auto current_state = current.first;
                 auto stack_index = current.second;
-                for (const auto &[to,labels] : _states[current_state]->_edges) {
-                    if (labels.contains(stack[stack_index])) {
+                for (const auto &[to,labels] : edges(current_state)) {
+                    if (labels_match(labels, stack[stack_index])) {
                         if (stack_index + 1 < stack.size()) {
                             search_stack.emplace(to, stack_index + 1);
                         } else if (_states[to]->_accepting) {
@@ -347,10 +440,10 @@ namespace pdaaal {
             return false;
         }
 
-        template<Trace_Type trace_type = Trace_Type::Any>
+        template<Trace_Type trace_type, typename Edges>
         [[nodiscard]] typename std::conditional_t<trace_type == Trace_Type::Shortest && is_weighted<W>,
                 std::pair<std::vector<size_t>, typename W::type>, std::vector<size_t>>
-        accept_path(size_t state, const std::vector<uint32_t> &stack) const {
+        accept_path(size_t state, const std::vector<uint32_t> &stack, const Edges& edges) const {
             if constexpr (trace_type == Trace_Type::Shortest && is_weighted<W>) { // TODO: Consider unweighted shortest path.
                 if (stack.empty()) {
                     if (_states[state]->_accepting) {
@@ -359,64 +452,50 @@ namespace pdaaal {
                         return std::make_pair(std::vector<size_t>(), solver_weight<W,trace_type>::max());
                     }
                 }
-                // Dijkstra.
-                struct queue_elem {
-                    typename W::type _weight;
+                // Dijkstra over (state, stack index) pairs. The pairs get ids in the order they are reached.
+                using solverW = solver_weight<W,trace_type>;
+                struct search_node {
                     size_t _state;
                     size_t _stack_index;
-                    const queue_elem* _back_pointer;
-                    queue_elem(typename W::type weight, size_t state, size_t stack_index, const queue_elem* back_pointer = nullptr)
-                    : _weight(weight), _state(state), _stack_index(stack_index), _back_pointer(back_pointer) {};
-
-                    bool operator<(const queue_elem& other) const {
-                        return std::tie(_state, _stack_index) < std::tie(other._state, other._stack_index);
-                    }
-                    bool operator==(const queue_elem& other) const {
-                        return _state == other._state && _stack_index == other._stack_index;
-                    }
-                    bool operator!=(const queue_elem& other) const {
-                        return !(*this == other);
-                    }
+                    typename W::type _weight;
+                    size_t _back_pointer;
                 };
-                struct queue_elem_comp {
-                    bool operator()(const queue_elem& lhs, const queue_elem& rhs){
-                        return solver_weight<W,trace_type>::less(rhs._weight, lhs._weight); // Used in a max-heap, so swap arguments to make it a min-heap.
+                constexpr auto no_node = std::numeric_limits<size_t>::max();
+                std::vector<search_node> nodes;
+                std::unordered_map<std::pair<size_t,size_t>, size_t, absl::Hash<std::pair<size_t,size_t>>> node_ids;
+                shortest_queue<W,trace_type> search_queue;
+                auto relax = [&](size_t state, size_t stack_index, const typename W::type& weight, size_t back_pointer) {
+                    auto [it, fresh] = node_ids.emplace(std::make_pair(state, stack_index), nodes.size());
+                    if (fresh) {
+                        nodes.push_back(search_node{state, stack_index, weight, back_pointer});
+                    } else if (solverW::less(weight, nodes[it->second]._weight)) {
+                        nodes[it->second]._weight = weight;
+                        nodes[it->second]._back_pointer = back_pointer;
+                    } else {
+                        return;
                     }
+                    search_queue.push(it->second, weight);
                 };
-                queue_elem_comp less;
-                std::priority_queue<queue_elem, std::vector<queue_elem>, queue_elem_comp> search_queue;
-                std::vector<queue_elem> visited;
-                std::vector<std::unique_ptr<queue_elem>> pointers;
-                search_queue.emplace(W::zero(), state, 0);
+                relax(state, 0, W::zero(), no_node);
                 while(!search_queue.empty()) {
-                    auto current = search_queue.top();
-                    search_queue.pop();
+                    auto current_id = search_queue.pop().first;
+                    auto current = nodes[current_id];
                     if (current._stack_index == stack.size()) {
                         std::vector<size_t> path(stack.size() + 1);
-                        path[current._stack_index] = current._state;
-                        for (auto p = current._back_pointer; p != nullptr; p = p->_back_pointer) {
-                            path[p->_stack_index] = p->_state;
+                        for (auto p = current_id; p != no_node; p = nodes[p]._back_pointer) {
+                            path[nodes[p]._stack_index] = nodes[p]._state;
                         }
                         return std::make_pair(path, current._weight);
                     }
-                    auto lb = std::lower_bound(visited.begin(), visited.end(), current);
-                    if (lb != std::end(visited) && *lb == current) {
-                        if (less(*lb, current)) {
-                            *lb = current;
-                        } else {
-                            continue;
-                        }
-                    } else {
-                        lb = visited.insert(lb, current);
-                    }
-                    auto u_pointer = std::make_unique<queue_elem>(*lb);
-                    auto pointer = u_pointer.get();
-                    pointers.push_back(std::move(u_pointer));
-                    for (const auto& [to,labels] : _states[current._state]->_edges) {
+                    for (const auto& [to,labels] : edges(current._state)) {
                         auto label = labels.get(stack[current._stack_index]);
+                        if (auto wildcard_label = labels.get(wildcard); wildcard_label != nullptr &&
+                            (label == nullptr || solverW::less(wildcard_label->second, label->second))) {
+                            label = wildcard_label;
+                        }
                         if (label != nullptr) {
                             if (current._stack_index + 1 < stack.size() || _states[to]->_accepting) {
-                                search_queue.emplace(solver_weight<W,trace_type>::add(current._weight, label->second), to, current._stack_index + 1, pointer);
+                                relax(to, current._stack_index + 1, solverW::add(current._weight, label->second), current_id);
                             }
                         }
                     }
@@ -440,8 +519,8 @@ namespace pdaaal {
                     auto current_state = current.first;
                     auto stack_index = current.second;
                     path[stack_index] = current_state;
-                    for (const auto &[to,labels] : _states[current_state]->_edges) {
-                        if (labels.contains(stack[stack_index])) {
+                    for (const auto &[to,labels] : edges(current_state)) {
+                        if (labels_match(labels, stack[stack_index])) {
                             if (stack_index + 1 < stack.size()) {
                                 search_stack.emplace(to, stack_index + 1);
                             } else if (_states[to]->_accepting) {
@@ -454,15 +533,83 @@ namespace pdaaal {
                 return std::vector<size_t>();
             }
         }
+    public:
 
         [[nodiscard]] trace_<indirect> get_trace_label(const std::tuple<size_t, uint32_t, size_t> &edge) const {
             return get_trace_label(std::get<0>(edge), std::get<1>(edge), std::get<2>(edge));
         }
         [[nodiscard]] trace_<indirect> get_trace_label(size_t from, uint32_t label, size_t to) const {
-            auto trace = _states[from]->_edges.get(to, label);
-            if (trace) return trace_from<W,indirect>(*trace);
-            assert(false); // We assume the edge exists.
-            return default_trace_<indirect>();
+            auto trace = get_edge(from, label, to);
+            assert(trace != nullptr); // We assume the edge exists.
+            return trace ? trace_from<W,indirect>(*trace) : default_trace_<indirect>();
+        }
+        // Weight of an existing edge, like get_trace_label.
+        template<typename WW = W, typename = std::enable_if_t<is_weighted<WW>>>
+        [[nodiscard]] typename W::type get_edge_weight(size_t from, uint32_t label, size_t to) const {
+            auto trace = get_edge(from, label, to);
+            assert(trace != nullptr); // We assume the edge exists.
+            return trace ? trace->second : W::zero();
+        }
+    private:
+        [[nodiscard]] const trace_ptr<W,indirect>* get_edge(size_t from, uint32_t label, size_t to) const {
+            auto get = [this, from, to](uint32_t l) {
+                return _frozen ? _frozen_edges.get(from, to, l) : _states[from]->_edges.get(to, l);
+            };
+            auto trace = get(label);
+            if (!trace && label != epsilon) { // The edge may be covered by a wildcard edge.
+                trace = get(wildcard);
+            }
+            return trace;
+        }
+    public:
+
+        // Compacts the edges into contiguous (CSR) arrays: state offsets, target states, sorted labels, and the traces in a parallel array.
+        // This is meant for the read-only phases after saturation (product construction, finding paths and traces), which are faster on the frozen form.
+        // The per-state edge sets are released, so read edges through with_edges (or get_trace_label). state_t::edges() asserts that the automaton is not frozen.
+        // Adding states or edges to a frozen automaton thaws it first.
+        void freeze() {
+            if (_frozen) return;
+            frozen_edges<trace_ptr<W,indirect>> frozen;
+            for (auto& s : _states) {
+                for (const auto& [to, labels] : s->_edges) {
+                    for (const auto& [label, trace] : labels) { // Labels are sorted, with wildcard and epsilon last.
+                        frozen.add_edge(to, label, trace);
+                    }
+                }
+                frozen.end_state();
+                s->_edges = edge_set_t();
+                s->_frozen = true;
+            }
+            frozen.shrink_to_fit();
+            _frozen_edges = std::move(frozen);
+            _frozen = true;
+        }
+        // Restores the normal (mutable) representation of the edges.
+        void thaw() {
+            if (!_frozen) return;
+            for (auto& s : _states) {
+                for (const auto& [to, labels] : _frozen_edges.edges(s->_id)) {
+                    for (const auto& [label, trace] : labels) {
+                        s->_edges.emplace(to, label, trace);
+                    }
+                }
+                s->_frozen = false;
+            }
+            _frozen_edges = frozen_edges<trace_ptr<W,indirect>>();
+            _frozen = false;
+        }
+        [[nodiscard]] bool frozen() const { return _frozen; }
+
+        // Calls fn(edges), where edges(state) is the range of (to, labels) pairs of the outgoing edges of state.
+        // The range and labels types differ between the normal and the frozen representation, so fn must be generic, e.g. [&](const auto& edges){ ... }.
+        // The automaton must not be changed while edges is in use.
+        template<typename Fn>
+        decltype(auto) with_edges(Fn&& fn) const {
+            if (_frozen) {
+                return fn([this](size_t state) { return _frozen_edges.edges(state); });
+            } else {
+                return fn([this](size_t state) -> const edge_set_t& { return _states[state]->_edges; });
+            }
         }
 
         [[nodiscard]] size_t number_of_labels() const { return _pda.number_of_labels(); }
@@ -472,7 +619,11 @@ namespace pdaaal {
         };
 
         size_t add_state(bool initial, bool accepting) {
+            thaw();
             auto id = next_state_id();
+            if (id >= trace_t::no_state) {
+                throw std::runtime_error("PAutomaton: Too many states. State ids must fit in 32 bits.");
+            }
             _states.emplace_back(std::make_unique<state_t>(accepting, id));
             if (accepting) {
                 _accepting.push_back(_states.back().get());
@@ -487,14 +638,26 @@ namespace pdaaal {
         }
 
         void add_epsilon_edge(size_t from, size_t to, trace_ptr<W,indirect> trace = default_trace_ptr<W,indirect>()) {
+            thaw();
             _states[from]->_edges.emplace(to, epsilon, trace);
         }
 
         void add_edge(size_t from, size_t to, uint32_t label, trace_ptr<W,indirect> trace = default_trace_ptr<W,indirect>()) {
             assert(label < std::numeric_limits<uint32_t>::max() - 1);
+            thaw();
             _states[from]->_edges.emplace(to, label, trace);
         }
+        void add_wildcard_edge(size_t from, size_t to, trace_ptr<W,indirect> trace = default_trace_ptr<W,indirect>()) {
+            thaw();
+            _states[from]->_edges.emplace(to, wildcard, trace);
+        }
+        // Does an edge with these labels accept label. Label must not be epsilon.
+        template <typename labels_map_t>
+        static bool labels_match(const labels_map_t& labels, uint32_t label) {
+            return labels.contains(label) || labels.contains(wildcard);
+        }
         void update_edge(size_t from, size_t to, uint32_t label, trace_ptr<W,indirect> trace) {
+            thaw();
             auto ptr = _states[from]->_edges.get(to, label);
             assert(ptr != nullptr);
             *ptr = trace;
@@ -550,37 +713,37 @@ namespace pdaaal {
         }
 
         trace_<indirect> new_pre_trace(size_t rule_id) {
-            if constexpr (indirect) {
-                _trace_info.emplace_back(std::make_unique<trace_t>(rule_id, std::numeric_limits<size_t>::max()));
-                return _trace_info.back().get();
-            } else {
-                return trace_t(rule_id, std::numeric_limits<size_t>::max());
-            }
+            return new_trace(trace_t(rule_id, trace_t::no_state));
         }
         trace_<indirect> new_pre_trace(size_t rule_id, size_t temp_state) {
-            if constexpr (indirect) {
-                _trace_info.emplace_back(std::make_unique<trace_t>(rule_id, temp_state));
-                return _trace_info.back().get();
-            } else {
-                return trace_t(rule_id, temp_state);
-            }
+            return new_trace(trace_t(rule_id, temp_state));
         }
         trace_<indirect> new_post_trace(size_t from, size_t rule_id, uint32_t label) {
+            return new_trace(trace_t(from, rule_id, label));
+        }
+        trace_<indirect> new_post_trace(size_t epsilon_state) {
+            return new_trace(trace_t(epsilon_state));
+        }
+        // Equal trace information is only stored once, so the same handle may be returned for different edges.
+        trace_<indirect> new_trace(const trace_t& trace) {
             if constexpr (indirect) {
-                _trace_info.emplace_back(std::make_unique<trace_t>(from, rule_id, label));
-                return _trace_info.back().get();
+                return trace_handle(_trace_info.intern(trace));
             } else {
-                return trace_t(from, rule_id, label);
+                return trace;
             }
         }
-        trace_<indirect> new_post_trace(size_t epsilon_state) {
+        [[nodiscard]] trace_t get_trace(trace_<indirect> trace) const {
             if constexpr (indirect) {
-                _trace_info.emplace_back(std::make_unique<trace_t>(epsilon_state));
-                return _trace_info.back().get();
+                assert(!trace.is_null());
+                return _trace_info[trace._id];
             } else {
-                return trace_t(epsilon_state);
+                return trace;
             }
         }
+        // Approximate number of bytes used for (indirect) trace information.
+        [[nodiscard]] size_t trace_memory_usage() const {
+            return _trace_info.memory_usage();
+        }
     private:
         template<typename T, bool use_mapping = true>
         void construct(const NFA<T>& nfa, const std::vector<size_t>& states, const std::function<std::vector<uint32_t>(const std::vector<T>&)>& map_symbols) {
@@ -633,7 +796,10 @@ namespace pdaaal {
         std::vector<state_t *> _initial;
         std::vector<state_t *> _accepting;
 
-        std::vector<std::unique_ptr<trace_t>> _trace_info;
+        bool _frozen = false;
+        frozen_edges<trace_ptr<W,indirect>> _frozen_edges;
+
+        interning_arena<trace_t> _trace_info;
 
         const PDA<W>& _pda;
     };
@@ -27,78 +27,92 @@
 #ifndef PDAAAL_PAUTOMATONALGORITHMS_H
 #define PDAAAL_PAUTOMATONALGORITHMS_H
 
-#include <pdaaal/utils/workset.h>
+#include <pdaaal/utils/scc_fixed_point.h>
 #include <pdaaal/PAutomaton.h>
 
 namespace pdaaal {
 
+    // Best path weights (Trace_Type::Longest or Trace_Type::ShortestFixedPoint) from the initial states to the states of an automaton.
+    // The weight of a state is a fixed point over the edges from reachable states, solved per SCC by scc_fixed_point,
+    // so a cycle that improves the weight without bound gives bottom weight to the states that depend on it.
+    // For weights that are not selective, the weight is the combine over all paths to accepting states, and the path is just some path.
     template<typename W, bool indirect, Trace_Type trace_type>
-    class PAutomatonFixedPoint : public fixed_point_workset<PAutomatonFixedPoint<W, indirect, trace_type>, size_t> {
-        using parent_t = fixed_point_workset<PAutomatonFixedPoint<W, indirect, trace_type>, size_t>;
+    class PAutomatonFixedPoint {
         using solverW = solver_weight<W,trace_type>;
-        struct state_info {
-            typename W::type weight = solverW::max();
+        struct path_step { // The last edge of the best path into a state.
             uint32_t label = std::numeric_limits<uint32_t>::max();
             size_t predecessor = std::numeric_limits<size_t>::max();
-            bool in_queue = false;
         };
         const PAutomaton<W, indirect>& _automaton;
-        std::vector<state_info> _states;
-        size_t _min_accepting_state = std::numeric_limits<size_t>::max(); // Id of accept state with minimum path weight to it. (keep it updated).
+        scc_fixed_point<solverW, path_step> _fixed_point;
+        size_t _min_accepting_state = std::numeric_limits<size_t>::max(); // Id of accept state with minimum path weight to it.
+        typename W::type _weight = solverW::max(); // Weight of the answer.
     public:
-        static constexpr size_t next_round_elem = std::numeric_limits<size_t>::max(); // Needs to be different from any proper queue element.
-
         explicit PAutomatonFixedPoint(const PAutomaton<W, indirect>& automaton)
-        : parent_t(automaton.states().size()),
-        _automaton(automaton), _states(_automaton.states().size()) {
+        : _automaton(automaton) {
             initialize();
         };
         void initialize() {
-            for (size_t i = 0; i < _automaton.pda().states().size(); ++i) { // Iterate over initial states, i.e. the states in the PDA.
-                parent_t::emplace(i);
-                _states[i].weight = W::zero();
-                _states[i].in_queue = true;
+            for (size_t i = 0; i < _automaton.states().size(); ++i) {
+                _fixed_point.add_node();
             }
-        }
-        template<bool change_is_bottom = false>
-        bool step_with(size_t&& current) {
-            _states[current].in_queue = false;
-            const auto& current_weight = _states[current].weight;
-            if (_automaton.states()[current]->_accepting) {
-                if (current_weight == solverW::bottom()) {
-                    _min_accepting_state = current;
-                    return false; // Signal stop
-                }
-                if (_min_accepting_state == std::numeric_limits<size_t>::max() || solverW::less(current_weight, _states[_min_accepting_state].weight)) {
-                    _min_accepting_state = current;
-                }
+            std::vector<bool> seen(_automaton.states().size(), false);
+            std::vector<size_t> waiting;
+            for (size_t i = 0; i < _automaton.pda().states().size(); ++i) { // Iterate over initial states, i.e. the states in the PDA.
+                _fixed_point.add_derivation(i, W::zero(), path_step{});
+                seen[i] = true;
+                waiting.push_back(i);
             }
-            for (const auto& [to,labels] : _automaton.states()[current]->_edges) {
-                if (!labels.empty()) {
-                    auto label = std::min_element(labels.begin(), labels.end(), [](const auto& a, const auto& b){ return solverW::less(a.second.second, b.second.second); });
-                    auto to_weight = solverW::add(current_weight, label->second.second);
-                    if (solverW::less(to_weight, _states[to].weight)) {
-                        if constexpr(change_is_bottom) {
-                            _states[to].weight = solverW::bottom();
-                        } else {
-                            _states[to].weight = to_weight;
-                        }
-                        _states[to].label = label->first;
-                        _states[to].predecessor = current;
-                        if (!_states[to].in_queue) {
-                            _states[to].in_queue = true;
-                            parent_t::emplace(to);
+            _automaton.with_edges([&](const auto& edges) {
+                while (!waiting.empty()) {
+                    auto current = waiting.back();
+                    waiting.pop_back();
+                    for (const auto& [to,labels] : edges(current)) {
+                        if (!labels.empty()) {
+                            if constexpr (is_selective<solverW>) {
+                                auto label = std::min_element(labels.begin(), labels.end(), [](const auto& a, const auto& b){ return solverW::less(a.second.second, b.second.second); });
+                                _fixed_point.add_derivation(to, label->second.second, path_step{label->first, current}, current);
+                            } else {
+                                for (const auto& [label, trace_weight] : labels) {
+                                    _fixed_point.add_derivation(to, trace_weight.second, path_step{label, current}, current);
+                                }
+                            }
+                            if (!seen[to]) {
+                                seen[to] = true;
+                                waiting.push_back(to);
+                            }
                         }
                     }
                 }
+            });
+        }
+        void run(const budget& limits = budget()) {
+            if (!_fixed_point.run(limits)) return;
+            for (size_t state = 0; state < _automaton.states().size(); ++state) {
+                if (!_automaton.states()[state]->_accepting || !_fixed_point.reached(state)) continue;
+                if constexpr (is_selective<solverW>) {
+                    if (not_accepting() || solverW::less(_fixed_point.weight(state), _weight)) {
+                        _min_accepting_state = state;
+                        _weight = _fixed_point.weight(state);
+                    }
+                } else {
+                    if (not_accepting()) _min_accepting_state = state;
+                    _weight = solverW::combine(_weight, _fixed_point.weight(state));
+                }
             }
-            return true;
+        }
+        [[nodiscard]] size_t memory_usage() const {
+            return _fixed_point.memory_usage();
         }
         [[nodiscard]] bool not_accepting() const {
             return _min_accepting_state == std::numeric_limits<size_t>::max();
         }
         [[nodiscard]] bool is_infinite() const {
-            return _states[_min_accepting_state].weight == solverW::bottom(); // TODO: Allow for better stuff than this...
+            if constexpr (is_bounded_height<solverW>) {
+                return false;
+            } else {
+                return _weight == solverW::bottom(); // TODO: Allow for better stuff than this...
+            }
         }
         [[nodiscard]] auto get_path() const {
             return get_path([](size_t s){ return s; });
@@ -106,22 +120,22 @@ namespace pdaaal {
         template<typename MapFn>
         [[nodiscard]] std::tuple<std::vector<size_t>, std::vector<uint32_t>, typename W::type> get_path(MapFn&& state_map) const {
             static_assert(std::is_convertible_v<MapFn,std::function<size_t(size_t)>>);
-            // assert(this->_workset.size() == 1 && this->_workset.back() == next_round_elem);
             // Return path and stack
             std::vector<size_t> path;
             path.emplace_back(state_map(_min_accepting_state));
             std::vector<uint32_t> stack;
             size_t state = _min_accepting_state;
-            while (_states[state].predecessor != std::numeric_limits<size_t>::max()) {
-                assert(_states[state].label != std::numeric_limits<uint32_t>::max());
-                path.emplace_back(state_map(_states[state].predecessor));
-                stack.emplace_back(_states[state].label);
-                state = _states[state].predecessor;
-                assert(path.size() <= _states.size()); // There should be no loop here - covered elsewhere.
+            while (_fixed_point.payload(state).predecessor != std::numeric_limits<size_t>::max()) {
+                // The label is set together with the predecessor. It may be epsilon (the same value as the unset label) in a post* product.
+                const auto& step = _fixed_point.payload(state);
+                path.emplace_back(state_map(step.predecessor));
+                stack.emplace_back(step.label);
+                state = step.predecessor;
+                assert(path.size() <= _automaton.states().size()); // There should be no loop here - covered elsewhere.
             }
             std::reverse(path.begin(), path.end());
             std::reverse(stack.begin(), stack.end());
-            return {path, stack, _states[_min_accepting_state].weight};
+            return {path, stack, _weight};
         }
     };
 }
@@ -28,6 +28,8 @@
 #define PDAAAL_PAUTOMATONPRODUCT_H
 
 #include <pdaaal/PAutomatonAlgorithms.h>
+#include <absl/hash/hash.h>
+#include <unordered_set>
 
 namespace pdaaal {
 
@@ -36,6 +38,7 @@ namespace pdaaal {
         using product_automaton_t = PAutomaton<W>; // No explicit abstraction on product automaton - this is covered by _initial and _final.
         using state_t = typename product_automaton_t::state_t;
         static constexpr auto epsilon = product_automaton_t::epsilon;
+        static constexpr auto wildcard = product_automaton_t::wildcard;
     public:
         template<typename T>
         PAutomatonProduct(const pda_t& pda, const NFA<T>& initial_nfa, const std::vector<size_t>& initial_states,
@@ -52,6 +55,10 @@ namespace pdaaal {
         // Returns whether an accepting state in the product automaton was reached.
         template<bool needs_back_lookup = false, bool ET = true>
         bool initialize_product() {
+            if (_emptiness_only) {
+                return initialize_pairs<needs_back_lookup,ET>(_swap_initial_final ? _final : _initial,
+                                                              _swap_initial_final ? _initial : _final);
+            }
             std::vector<size_t> ids(_product.states().size());
             std::iota (ids.begin(), ids.end(), 0); // Fill with 0,1,...,size-1;
             return construct_reachable<needs_back_lookup,ET>(ids,
@@ -105,6 +112,28 @@ namespace pdaaal {
             _swap_initial_final = true;
         }
 
+        // Only decide whether the language of the product is empty. The reachable pairs of states are recorded in a hash set,
+        // but no states or edges are added to the product automaton, so find_path (and getting a trace) cannot be used afterwards.
+        // Must be enabled before the product is initialized.
+        void enable_emptiness_only() {
+            assert(_product.states().size() == _pda_size && _pairs.empty());
+            _emptiness_only = true;
+        }
+        [[nodiscard]] bool emptiness_only() const {
+            return _emptiness_only;
+        }
+
+        // Freezes the automaton that is only read during saturation (i.e. not automaton()), see PAutomaton::freeze.
+        void freeze_input() {
+            (_swap_initial_final ? _initial : _final).freeze();
+        }
+        // Freezes all automata. Use this after solving, before finding a path and trace.
+        void freeze() {
+            _initial.freeze();
+            _final.freeze();
+            _product.freeze();
+        }
+
         template<bool abstraction>
         using path_state = std::conditional_t<abstraction, std::pair<size_t,size_t>, size_t>;
 
@@ -114,141 +143,185 @@ namespace pdaaal {
         std::tuple<std::vector<path_state<abstraction>>, std::vector<uint32_t>, typename W::type>,
         std::tuple<std::vector<path_state<abstraction>>, std::vector<uint32_t>>>
         find_path() const {
+            if (_emptiness_only) {
+                assert(false);
+                throw std::runtime_error("PAutomatonProduct: Cannot find a path, since the product was only checked for emptiness.");
+            }
             if constexpr ((trace_type == Trace_Type::Longest || trace_type == Trace_Type::ShortestFixedPoint) && W::is_weight) {
                 PAutomatonFixedPoint<W,true,trace_type> fixed_point(_product);
                 fixed_point.run();
                 if (fixed_point.not_accepting()) {
                     return {std::vector<size_t>(), std::vector<uint32_t>(), solver_weight<W,trace_type>::max()};
                 }
-                if (fixed_point.is_infinite()) {
-                    return {std::vector<size_t>(), std::vector<uint32_t>(), solver_weight<W,trace_type>::bottom()}; // TODO: Can we provide more info than this??
+                if constexpr (!is_bounded_height<solver_weight<W,trace_type>>) {
+                    if (fixed_point.is_infinite()) {
+                        return {std::vector<size_t>(), std::vector<uint32_t>(), solver_weight<W,trace_type>::bottom()}; // TODO: Can we provide more info than this??
+                    }
                 }
                 return fixed_point.get_path([this](size_t state) -> size_t { return get_original_ids(state).first; });
             } else if constexpr (trace_type == Trace_Type::Shortest && is_weighted<W>) { // TODO: Consider unweighted shortest path.
-                // Dijkstra.
-                struct queue_elem {
-                    typename W::type weight;
-                    size_t state;
-                    uint32_t label;
-                    size_t stack_index;
-                    const queue_elem *back_pointer;
-                    queue_elem(typename W::type weight, size_t state, uint32_t label, size_t stack_index, const queue_elem *back_pointer = nullptr)
-                            : weight(weight), state(state), label(label), stack_index(stack_index), back_pointer(back_pointer) {};
-
-                    bool operator<(const queue_elem& other) const {
-                        return std::tie(state, label) < std::tie(other.state, other.label); // TODO: Is this correct? Should it not just be state?? and better then make 'visited' std::unordered_map<size_t, typename W::type>.
-                    }
-                    bool operator==(const queue_elem& other) const {
-                        return state == other.state && label == other.label;
-                    }
-                    bool operator!=(const queue_elem& other) const {
-                        return !(*this == other);
-                    }
+                // Dijkstra over the product states.
+                using solverW = solver_weight<W,trace_type>;
+                struct search_node {
+                    typename W::type weight = solverW::max();
+                    uint32_t label = std::numeric_limits<uint32_t>::max();
+                    size_t stack_index = 0;
+                    size_t back_pointer = std::numeric_limits<size_t>::max();
                 };
-                struct queue_elem_comp {
-                    bool operator()(const queue_elem &lhs, const queue_elem &rhs){
-                        return solver_weight<W,trace_type>::less(rhs.weight, lhs.weight); // Used in a max-heap, so swap arguments to make it a min-heap.
-                    }
-                };
-                std::priority_queue<queue_elem, std::vector<queue_elem>, queue_elem_comp> search_queue;
-                std::vector<queue_elem> visited;
-                std::vector<std::unique_ptr<queue_elem>> pointers;
+                std::vector<search_node> nodes(_product.states().size());
+                shortest_queue<W,trace_type> search_queue;
                 for (size_t i = 0; i < _pda_size; ++i) { // Iterate over _product._initial ([i]->_id)
-                    search_queue.emplace(W::zero(), i, std::numeric_limits<uint32_t>::max(), 0); // No label going into initial state.
+                    nodes[i].weight = W::zero(); // No label going into initial state.
+                    search_queue.push(i, W::zero());
                 }
                 while(!search_queue.empty()) {
-                    auto current = search_queue.top();
-                    search_queue.pop();
-
-                    if (_product.states()[current.state]->_accepting) {
-                        std::vector<path_state<abstraction>> path(current.stack_index + 1);
-                        std::vector<uint32_t> label_stack(current.stack_index);
-                        const queue_elem* p = &current;
-                        while (p->stack_index > 0) {
-                            path[p->stack_index] = get_original_ids(p->state).first;
-                            label_stack[p->stack_index - 1] = p->label;
-                            p = p->back_pointer;
+                    auto current = search_queue.pop().first;
+                    const auto& current_node = nodes[current];
+
+                    if (_product.states()[current]->_accepting) {
+                        std::vector<path_state<abstraction>> path(current_node.stack_index + 1);
+                        std::vector<uint32_t> label_stack(current_node.stack_index);
+                        auto p = current;
+                        while (nodes[p].stack_index > 0) {
+                            path[nodes[p].stack_index] = get_original_ids(p).first;
+                            label_stack[nodes[p].stack_index - 1] = nodes[p].label;
+                            p = nodes[p].back_pointer;
                         }
                         if constexpr (abstraction) {
-                            path[p->stack_index] = get_original_ids(p->state).to_pair();
+                            path[0] = get_original_ids(p).to_pair();
                         } else {
-                            path[p->stack_index] = get_original_ids(p->state).first;
+                            path[0] = get_original_ids(p).first;
                         }
-                        return std::make_tuple(path, label_stack, current.weight);
+                        return std::make_tuple(path, label_stack, current_node.weight);
                     }
 
-                    auto lb = std::lower_bound(visited.begin(), visited.end(), current);
-                    if (lb != std::end(visited) && *lb == current) {
-                        if (solver_weight<W,trace_type>::less(current.weight, lb->weight)) {
-                            *lb = current;
-                        } else {
-                            continue;
-                        }
-                    } else {
-                        lb = visited.insert(lb, current); // TODO: Consider using std::unordered_map instead...
-                    }
-                    auto u_pointer = std::make_unique<queue_elem>(*lb);
-                    auto pointer = u_pointer.get();
-                    pointers.push_back(std::move(u_pointer));
-                    for (const auto& [to,labels] : _product.states()[current.state]->_edges) {
-                        if (!labels.empty()) {
-                            auto label = std::min_element(labels.begin(), labels.end(), [](const auto& a, const auto& b){ return solver_weight<W,trace_type>::less(a.second.second, b.second.second); });
-                            search_queue.emplace(solver_weight<W,trace_type>::add(current.weight, label->second.second), to, label->first, current.stack_index + 1, pointer);
+                    _product.with_edges([&](const auto& edges) {
+                        for (const auto& [to,labels] : edges(current)) {
+                            if (!labels.empty()) {
+                                auto label = std::min_element(labels.begin(), labels.end(), [](const auto& a, const auto& b){ return solverW::less(a.second.second, b.second.second); });
+                                auto weight = solverW::add(nodes[current].weight, label->second.second);
+                                if (solverW::less(weight, nodes[to].weight)) {
+                                    nodes[to] = search_node{weight, label->first, nodes[current].stack_index + 1, current};
+                                    search_queue.push(to, weight);
+                                }
+                            }
                         }
-                    }
+                    });
                 }
                 return std::make_tuple(std::vector<path_state<abstraction>>(), std::vector<uint32_t>(), solver_weight<W,trace_type>::max());
             } else {
-                // DFS search.
-                std::vector<path_state<abstraction>> path;
-                std::vector<uint32_t> label_stack;
-
-                std::vector<std::tuple<size_t,size_t,uint32_t>> waiting; // state_id, stack_index, last_label (if stack_index > 0)
-                waiting.reserve(_pda_size);
-                for (size_t i = 0; i < _pda_size; ++i) {
-                    if (_product.states()[i]->_accepting) { // Initial accepting state
+                return _product.with_edges([&](const auto& edges) {
+                    // DFS search.
+                    std::vector<path_state<abstraction>> path;
+                    std::vector<uint32_t> label_stack;
+
+                    std::vector<std::tuple<size_t,size_t,uint32_t>> waiting; // state_id, stack_index, last_label (if stack_index > 0)
+                    waiting.reserve(_pda_size);
+                    for (size_t i = 0; i < _pda_size; ++i) {
+                        if (_product.states()[i]->_accepting) { // Initial accepting state
+                            if constexpr (abstraction) {
+                                path.emplace_back(i,i);
+                            } else {
+                                path.push_back(i);
+                            }
+                            return std::make_tuple(path, label_stack);
+                        }
+                        waiting.emplace_back(i, 0, std::numeric_limits<uint32_t>::max()); // Add all initial states in _product.
+                    }
+                    std::unordered_set<size_t> seen;
+
+                    while (!waiting.empty()) {
+                        auto [current, stack_index, last_label] = waiting.back();
+                        waiting.pop_back();
+                        path.resize(stack_index + 2);
+                        label_stack.resize(stack_index + 1);
                         if constexpr (abstraction) {
-                            path.emplace_back(i,i);
+                            path[stack_index] = get_original_ids(current).to_pair();
                         } else {
-                            path.push_back(i);
+                            path[stack_index] = get_original_ids(current).first;
+                        }
+                        if (stack_index > 0) {
+                            label_stack[stack_index - 1] = last_label;
+                        }
+                        for (const auto &[to,labels] : edges(current)) {
+                            if (!labels.empty() && seen.emplace(to).second) {
+                                uint32_t label = labels[0].first;
+                                if (_product.states()[to]->_accepting) {
+                                    if constexpr (abstraction) {
+                                        path[stack_index + 1] = get_original_ids(to).to_pair();
+                                    } else {
+                                        path[stack_index + 1] = get_original_ids(to).first;
+                                    }
+                                    label_stack[stack_index] = label;
+                                    return std::make_tuple(path, label_stack);
+                                }
+                                waiting.emplace_back(to, stack_index + 1, label);
+                            }
                         }
-                        return std::make_tuple(path, label_stack);
                     }
-                    waiting.emplace_back(i, 0, std::numeric_limits<uint32_t>::max()); // Add all initial states in _product.
+                    return std::make_tuple(std::vector<path_state<abstraction>>(), std::vector<uint32_t>());
+                });
+            }
+        }
+
+        // Shortest path in the product of a weighted dual search, where the initial automaton is saturated by post* and the final automaton by pre*.
+        // The weight of an edge is the sum of the weights of the corresponding edges in the two automata (an epsilon edge is only in one of them),
+        // so the weight of a path is the weight of a trace from the initial automaton via the configuration of the path to the final automaton.
+        template<typename WW = W, typename = std::enable_if_t<is_weighted<WW>>>
+        [[nodiscard]] std::tuple<std::vector<std::pair<size_t,size_t>>, std::vector<uint32_t>, typename W::type> find_dual_path() const {
+            if (_emptiness_only) {
+                assert(false);
+                throw std::runtime_error("PAutomatonProduct: Cannot find a path, since the product was only checked for emptiness.");
+            }
+            using solverW = solver_weight<W,Trace_Type::Shortest>;
+            struct search_node {
+                typename W::type weight = solverW::max();
+                uint32_t label = std::numeric_limits<uint32_t>::max();
+                size_t stack_index = 0;
+                size_t back_pointer = std::numeric_limits<size_t>::max();
+            };
+            auto edge_weight = [this](const pair_size_t& from, uint32_t label, const pair_size_t& to) {
+                if (label != epsilon) {
+                    return solverW::add(_initial.get_edge_weight(from.first, label, to.first), _final.get_edge_weight(from.second, label, to.second));
                 }
-                std::unordered_set<size_t> seen;
-
-                while (!waiting.empty()) {
-                    auto [current, stack_index, last_label] = waiting.back();
-                    waiting.pop_back();
-                    path.resize(stack_index + 2);
-                    label_stack.resize(stack_index + 1);
-                    if constexpr (abstraction) {
-                        path[stack_index] = get_original_ids(current).to_pair();
-                    } else {
-                        path[stack_index] = get_original_ids(current).first;
-                    }
-                    if (stack_index > 0) {
-                        label_stack[stack_index - 1] = last_label;
+                return from.first != to.first ? _initial.get_edge_weight(from.first, label, to.first) : _final.get_edge_weight(from.second, label, to.second);
+            };
+            std::vector<search_node> nodes(_product.states().size());
+            shortest_queue<W> search_queue;
+            for (size_t i = 0; i < _pda_size; ++i) {
+                nodes[i].weight = W::zero();
+                search_queue.push(i, W::zero());
+            }
+            while (!search_queue.empty()) {
+                auto current = search_queue.pop().first;
+                const auto& current_node = nodes[current];
+                if (_product.states()[current]->_accepting) {
+                    std::vector<std::pair<size_t,size_t>> path(current_node.stack_index + 1);
+                    std::vector<uint32_t> label_stack(current_node.stack_index);
+                    auto p = current;
+                    while (nodes[p].stack_index > 0) {
+                        path[nodes[p].stack_index] = get_original_ids(p).to_pair();
+                        label_stack[nodes[p].stack_index - 1] = nodes[p].label;
+                        p = nodes[p].back_pointer;
                     }
-                    for (const auto &[to,labels] : _product.states()[current]->_edges) {
-                        if (!labels.empty() && seen.emplace(to).second) {
-                            uint32_t label = labels[0].first;
-                            if (_product.states()[to]->_accepting) {
-                                if constexpr (abstraction) {
-                                    path[stack_index + 1] = get_original_ids(to).to_pair();
-                                } else {
-                                    path[stack_index + 1] = get_original_ids(to).first;
-                                }
-                                label_stack[stack_index] = label;
-                                return std::make_tuple(path, label_stack);
+                    path[0] = get_original_ids(p).to_pair();
+                    return std::make_tuple(path, label_stack, current_node.weight);
+                }
+                auto current_ids = get_original_ids(current);
+                _product.with_edges([&](const auto& edges) {
+                    for (const auto& [to,labels] : edges(current)) {
+                        auto to_ids = get_original_ids(to);
+                        for (const auto& [label,_] : labels) {
+                            auto weight = solverW::add(nodes[current].weight, edge_weight(current_ids, label, to_ids));
+                            if (solverW::less(weight, nodes[to].weight)) {
+                                nodes[to] = search_node{weight, label, nodes[current].stack_index + 1, current};
+                                search_queue.push(to, weight);
                             }
-                            waiting.emplace_back(to, stack_index + 1, label);
                         }
                     }
-                }
-                return std::make_tuple(std::vector<path_state<abstraction>>(), std::vector<uint32_t>());
+                });
             }
+            return std::make_tuple(std::vector<std::pair<size_t,size_t>>(), std::vector<uint32_t>(), solverW::max());
         }
 
     private:
@@ -256,102 +329,353 @@ namespace pdaaal {
         bool add_edge(size_t from, uint32_t label, size_t to, trace_ptr<W> trace,
                       const automaton_t& first, const automaton_t& second) { // States in first and second automaton corresponds to respectively first and second component of the states in product automaton.
             static_assert(edge_in_first || needs_back_lookup, "If you insert edge in the second automaton, then you must also enable using _id_fast_lookup_back to keep the relevant information.");
-            const auto& fast_lookup = constexpr_ternary<edge_in_first>(_id_fast_lookup, _id_fast_lookup_back);
-            std::vector<std::pair<size_t,size_t>> from_states;
-            if (from < fast_lookup.size()) { // Avoid out-of-bounds.
-                from_states = fast_lookup[from]; // Copy here, since loop-body might alter fast_lookup[from].
-            }
-            if (from < _pda_size) {
-                from_states.emplace_back(from, from); // Initial states are not stored in _id_fast_lookup.
+            if (_emptiness_only) {
+                return add_edge_pairs<edge_in_first,needs_back_lookup>(from, label, to, first, second);
             }
+            const auto& fast_lookup = constexpr_ternary<edge_in_first>(_id_fast_lookup, _id_fast_lookup_back);
             const auto& current = constexpr_ternary<edge_in_first>(first, second);
             const auto& other = constexpr_ternary<edge_in_first>(second, first);
             auto current_to = current.states()[to].get();
-            std::vector<size_t> waiting;
-            for (auto [other_from, product_from] : from_states) { // Iterate through reachable 'from-states'.
-                std::vector<size_t> other_tos;
-                if (label == epsilon) {
-                    other_tos.emplace_back(other_from);
-                } else {
-                    for (const auto& [other_to,other_labels] : other.states()[other_from]->_edges) {
-                        if (other_labels.contains(label)) {
-                            other_tos.emplace_back(other_to);
-                        }
-                    }
-                }
-                for (auto other_to : other_tos) {
+            _waiting.clear();
+            auto add_product_edges = [&](size_t other_from, size_t product_from) -> bool { // Returns whether an accepting state was reached.
+                return for_each_matching_edge<!needs_back_lookup>(other, other_from, label, [&](size_t other_to, uint32_t edge_label) -> bool {
                     auto [fresh, product_to] = get_product_state<needs_back_lookup>(swap_if<!edge_in_first>(current_to, other.states()[other_to].get()));
-                    if (label == epsilon) {
+                    if (edge_label == epsilon) {
                         _product.add_epsilon_edge(product_from, product_to, trace);
                     } else {
-                        _product.add_edge(product_from, product_to, label, trace);
+                        _product.add_edge(product_from, product_to, edge_label, trace);
                     }
                     if (_product.has_accepting_state()) {
                         return true; // Early termination
                     }
                     if (fresh) {
-                        waiting.push_back(product_to); // If the 'to-state' is new (was not previously reachable), we need to continue constructing from there.
+                        _waiting.push_back(product_to); // If the 'to-state' is new (was not previously reachable), we need to continue constructing from there.
                     }
-                }
+                    return false;
+                });
+            };
+            // Iterate through reachable 'from-states'. The loop-body may add to fast_lookup[from] (and resize fast_lookup),
+            // so use indices and only visit the states that were reachable before this edge.
+            size_t n_from_states = from < fast_lookup.size() ? fast_lookup[from].size() : 0;
+            for (size_t i = 0; i < n_from_states; ++i) {
+                auto [other_from, product_from] = fast_lookup[from][i];
+                if (add_product_edges(other_from, product_from)) return true;
+            }
+            if (from < _pda_size && add_product_edges(from, from)) { // Initial states are not stored in _id_fast_lookup.
+                return true;
             }
-            return construct_reachable<needs_back_lookup>(waiting, first, second);
+            return construct_reachable<needs_back_lookup>(_waiting, first, second);
         }
 
         // Returns whether an accepting state in the product automaton was reached.
         template<bool needs_back_lookup = false, bool ET = true>
         bool construct_reachable(std::vector<size_t>& waiting, const automaton_t& initial, const automaton_t& final) {
-            while (!waiting.empty()) {
-                size_t top = waiting.back();
-                waiting.pop_back();
-                auto [i_from,f_from] = get_original_ids(top);
-                for (const auto& [i_to,i_labels] : initial.states()[i_from]->_edges) {
-                    if (auto it = i_labels.find(epsilon); it != i_labels.end()) {
-                        auto [fresh, product_to] = get_product_state<needs_back_lookup>(initial.states()[i_to].get(), final.states()[f_from].get());
-                        _product.add_epsilon_edge(top, product_to, it->second);
-                        if constexpr (ET) {
-                            if (_product.has_accepting_state()) {
-                                return true; // Early termination
+            return initial.with_edges([&](const auto& i_edges) {
+                return final.with_edges([&](const auto& f_edges) {
+                    while (!waiting.empty()) {
+                        size_t top = waiting.back();
+                        waiting.pop_back();
+                        auto [i_from,f_from] = get_original_ids(top);
+                        for (const auto& [i_to,i_labels] : i_edges(i_from)) {
+                            if (auto it = i_labels.find(epsilon); it != i_labels.end()) {
+                                auto [fresh, product_to] = get_product_state<needs_back_lookup>(initial.states()[i_to].get(), final.states()[f_from].get());
+                                _product.add_epsilon_edge(top, product_to, it->second);
+                                if constexpr (ET) {
+                                    if (_product.has_accepting_state()) {
+                                        return true; // Early termination
+                                    }
+                                }
+                                if (fresh) {
+                                    waiting.push_back(product_to);
+                                }
                             }
-                        }
-                        if (fresh) {
-                            waiting.push_back(product_to);
-                        }
-                    }
-                    for (const auto& [f_to,f_labels] : final.states()[f_from]->_edges) {
-                        if (auto it = f_labels.find(epsilon); it != f_labels.end()) {
-                            auto [fresh, product_to] = get_product_state<needs_back_lookup>(initial.states()[i_from].get(), final.states()[f_to].get());
-                            _product.add_epsilon_edge(top, product_to, it->second);
-                            if constexpr (ET) {
-                                if (_product.has_accepting_state()) {
-                                    return true; // Early termination
+                            for (const auto& [f_to,f_labels] : f_edges(f_from)) {
+                                if (auto it = f_labels.find(epsilon); it != f_labels.end()) {
+                                    auto [fresh, product_to] = get_product_state<needs_back_lookup>(initial.states()[i_from].get(), final.states()[f_to].get());
+                                    _product.add_epsilon_edge(top, product_to, it->second);
+                                    if constexpr (ET) {
+                                        if (_product.has_accepting_state()) {
+                                            return true; // Early termination
+                                        }
+                                    }
+                                    if (fresh) {
+                                        waiting.push_back(product_to);
+                                    }
+                                }
+                                auto& labels = _labels_scratch;
+                                intersect_labels(i_labels, f_labels, labels);
+                                if (!labels.empty() && labels.size() > (labels.back().first == epsilon ? 1 : 0)) {
+                                    auto [fresh, to_id] = get_product_state<needs_back_lookup>(initial.states()[i_to].get(), final.states()[f_to].get());
+                                    for (const auto& [label, trace] : labels) {
+                                        if (label != epsilon) {
+                                            _product.add_edge(top, to_id, label, trace);
+                                        }
+                                    }
+                                    if constexpr (ET) {
+                                        if (_product.has_accepting_state()) {
+                                            return true; // Early termination
+                                        }
+                                    }
+                                    if (fresh) {
+                                        waiting.push_back(to_id);
+                                    }
                                 }
                             }
-                            if (fresh) {
-                                waiting.push_back(product_to);
+                        }
+                    }
+                    return _product.has_accepting_state();
+                });
+            });
+        }
+
+        // ***
+        // Emptiness-only mode. Same search as add_edge and construct_reachable, but on pairs of states (first, second) without making a product automaton.
+        // The pairs (p,p) of PDA states are reachable from the start and are not stored.
+        // ***
+        template<bool needs_back_lookup, bool ET>
+        bool initialize_pairs(const automaton_t& first, const automaton_t& second) {
+            _accepting_pair = _product.has_accepting_state(); // The product automaton only has the states (p,p) of PDA states.
+            if (ET && _accepting_pair) {
+                return true;
+            }
+            std::vector<std::pair<size_t,size_t>> waiting;
+            waiting.reserve(_pda_size);
+            for (size_t i = 0; i < _pda_size; ++i) {
+                waiting.emplace_back(i, i);
+            }
+            return construct_reachable_pairs<needs_back_lookup,ET>(waiting, first, second);
+        }
+
+        template<bool edge_in_first, bool needs_back_lookup>
+        bool add_edge_pairs(size_t from, uint32_t label, size_t to, const automaton_t& first, const automaton_t& second) {
+            const auto& fast_lookup = constexpr_ternary<edge_in_first>(_pairs_fast_lookup, _pairs_fast_lookup_back);
+            const auto& other = constexpr_ternary<edge_in_first>(second, first);
+            _waiting_pairs.clear();
+            auto reach = [&](size_t other_to, uint32_t) -> bool { // Returns whether an accepting pair was reached.
+                auto [first_to, second_to] = swap_if<!edge_in_first>(to, other_to);
+                if (add_pair<needs_back_lookup>(first, second, first_to, second_to)) {
+                    _waiting_pairs.emplace_back(first_to, second_to);
+                }
+                return _accepting_pair;
+            };
+            auto reach_from = [&](size_t other_from) -> bool {
+                if (label == wildcard) { // The labels are not recorded, so there is no need to expand the wildcard.
+                    return other.with_edges([&](const auto& edges) {
+                        for (const auto& [other_to,other_labels] : edges(other_from)) {
+                            if (has_label(other_labels) && reach(other_to, label)) return true;
+                        }
+                        return false;
+                    });
+                }
+                return for_each_matching_edge<!needs_back_lookup>(other, other_from, label, reach);
+            };
+            size_t n_from_states = from < fast_lookup.size() ? fast_lookup[from].size() : 0; // The loop-body may add to fast_lookup[from].
+            for (size_t i = 0; i < n_from_states; ++i) {
+                if (reach_from(fast_lookup[from][i])) return true; // Early termination
+            }
+            if (from < _pda_size && reach_from(from)) {
+                return true;
+            }
+            return construct_reachable_pairs<needs_back_lookup,true>(_waiting_pairs, first, second);
+        }
+
+        template<bool needs_back_lookup, bool ET>
+        bool construct_reachable_pairs(std::vector<std::pair<size_t,size_t>>& waiting, const automaton_t& first, const automaton_t& second) {
+            return first.with_edges([&](const auto& first_edges) {
+                return second.with_edges([&](const auto& second_edges) {
+                    auto reach = [&](size_t first_to, size_t second_to) -> bool { // Returns whether to terminate early.
+                        if (add_pair<needs_back_lookup>(first, second, first_to, second_to)) {
+                            waiting.emplace_back(first_to, second_to);
+                        }
+                        return ET && _accepting_pair;
+                    };
+                    while (!waiting.empty()) {
+                        auto [first_from, second_from] = waiting.back();
+                        waiting.pop_back();
+                        for (const auto& [second_to,second_labels] : second_edges(second_from)) {
+                            if (second_labels.contains(epsilon) && reach(first_from, second_to)) {
+                                return true;
                             }
                         }
-                        std::vector<typename decltype(i_labels)::value_type> labels;
-                        std::set_intersection(i_labels.begin(), i_labels.end(), f_labels.begin(), f_labels.end(), std::back_inserter(labels));
-                        if (!labels.empty() && labels.size() > (labels.back() == epsilon ? 1 : 0)) {
-                            auto [fresh, to_id] = get_product_state<needs_back_lookup>(initial.states()[i_to].get(), final.states()[f_to].get());
-                            for (const auto& [label, trace] : labels) {
-                                if (label != epsilon) {
-                                    _product.add_edge(top, to_id, label, trace);
-                                }
+                        for (const auto& [first_to,first_labels] : first_edges(first_from)) {
+                            if (first_labels.contains(epsilon) && reach(first_to, second_from)) {
+                                return true;
                             }
-                            if constexpr (ET) {
-                                if (_product.has_accepting_state()) {
-                                    return true; // Early termination
+                            for (const auto& [second_to,second_labels] : second_edges(second_from)) {
+                                if (labels_intersect(first_labels, second_labels) && reach(first_to, second_to)) {
+                                    return true;
                                 }
                             }
-                            if (fresh) {
-                                waiting.push_back(to_id);
+                        }
+                    }
+                    return _accepting_pair;
+                });
+            });
+        }
+
+        // Returns whether the pair is new.
+        template<bool needs_back_lookup>
+        bool add_pair(const automaton_t& first, const automaton_t& second, size_t first_state, size_t second_state) {
+            if (first_state == second_state && first_state < _pda_size) {
+                return false;
+            }
+            if (!_pairs.insert((uint64_t(first_state) << 32) | second_state).second) { // State ids fit in 32 bits, see PAutomaton::add_state.
+                return false;
+            }
+            if (first_state >= _pairs_fast_lookup.size()) {
+                _pairs_fast_lookup.resize(first_state + 1);
+            }
+            _pairs_fast_lookup[first_state].push_back(second_state);
+            if constexpr(needs_back_lookup) {
+                if (second_state >= _pairs_fast_lookup_back.size()) {
+                    _pairs_fast_lookup_back.resize(second_state + 1);
+                }
+                _pairs_fast_lookup_back[second_state].push_back(first_state);
+            }
+            if (first.states()[first_state]->_accepting && second.states()[second_state]->_accepting) {
+                _accepting_pair = true;
+            }
+            return true;
+        }
+
+        // Whether an edge has a non-epsilon label (where a wildcard label is all labels).
+        template<typename labels_map_t>
+        bool has_label(const labels_map_t& labels) const {
+            for (const auto& [l, _] : labels) {
+                if (l != epsilon && (l != wildcard || _pda.number_of_labels() > 0)) return true;
+            }
+            return false;
+        }
+        // Whether two edges have a common non-epsilon label. Same as !intersect_labels(...) being empty (ignoring epsilon), but without making the vector.
+        template<typename labels_map1_t, typename labels_map2_t>
+        bool labels_intersect(const labels_map1_t& labels1, const labels_map2_t& labels2) const {
+            if (labels1.contains(wildcard)) {
+                return has_label(labels2);
+            }
+            if (labels2.contains(wildcard)) {
+                return has_label(labels1);
+            }
+            auto it1 = labels1.begin();
+            auto it2 = labels2.begin();
+            while (it1 != labels1.end() && it2 != labels2.end()) { // Labels are sorted with epsilon last.
+                auto l1 = (*it1).first;
+                auto l2 = (*it2).first;
+                if (l1 == epsilon || l2 == epsilon) return false;
+                if (l1 < l2) {
+                    ++it1;
+                } else if (l2 < l1) {
+                    ++it2;
+                } else {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Calls fn(other_to, edge_label) for each edge from other_from in other that matches label, in the order of the edges in other.
+        // A wildcard label gives one call per label of the matching edge, since the product only has concrete labels.
+        // Stops and returns true, when fn returns true.
+        // With use_index, edges with a concrete label are found through the successor index of other, which must not change between calls.
+        template<bool use_index, typename Fn>
+        bool for_each_matching_edge(const automaton_t& other, size_t other_from, uint32_t label, Fn&& fn) {
+            if (label == epsilon) {
+                return fn(other_from, epsilon);
+            }
+            if constexpr (use_index) {
+                if (label != wildcard) {
+                    auto [begin, end] = successors(other, other_from);
+                    auto label_less = [](const successor_t& a, const successor_t& b) { return a._label < b._label; };
+                    auto [label_it, label_end] = std::equal_range(begin, end, successor_t{label, 0, 0}, label_less);
+                    auto wildcard_it = std::lower_bound(label_end, end, successor_t{wildcard, 0, 0}, label_less); // Only wildcard labels are left.
+                    // Merge the edges with the label and the wildcard edges to keep the order of the edges in other.
+                    while (label_it != label_end || wildcard_it != end) {
+                        bool take_label = wildcard_it == end || (label_it != label_end && label_it->_position < wildcard_it->_position);
+                        auto to = take_label ? (label_it++)->_to : (wildcard_it++)->_to;
+                        if (fn(to, label)) return true;
+                    }
+                    return false;
+                }
+            }
+            return other.with_edges([&](const auto& edges) {
+                for (const auto& [other_to,other_labels] : edges(other_from)) {
+                    if (label == wildcard) {
+                        bool stop = false;
+                        for_each_label(other_labels, [&stop, &fn, other_to = other_to](uint32_t l){ stop = stop || fn(other_to, l); });
+                        if (stop) return true;
+                    } else if (product_automaton_t::labels_match(other_labels, label) && fn(other_to, label)) {
+                        return true;
+                    }
+                }
+                return false;
+            });
+        }
+        // The outgoing edges of state in automaton as (label, position, to) sorted by label and then position (the order of the edges in automaton).
+        // An edge with a wildcard label is only indexed by the wildcard, so each edge is found at most once for a given label.
+        // The index is built lazily for each state, so the cost is proportional to the part of automaton that the product reaches.
+        auto successors(const automaton_t& automaton, size_t state) {
+            if (_indexed_automaton != &automaton) {
+                _successor_ranges.clear();
+                _successors.clear();
+                _indexed_automaton = &automaton;
+            }
+            if (state >= _successor_ranges.size()) {
+                _successor_ranges.resize(automaton.states().size(), std::make_pair(not_indexed, not_indexed));
+            }
+            assert(state < _successor_ranges.size());
+            auto& range = _successor_ranges[state];
+            if (range.first == not_indexed) {
+                range.first = _successors.size();
+                automaton.with_edges([this, state](const auto& edges) {
+                    uint32_t position = 0;
+                    for (const auto& [to,labels] : edges(state)) {
+                        if (labels.contains(wildcard)) {
+                            _successors.push_back(successor_t{wildcard, position, static_cast<uint32_t>(to)});
+                        } else {
+                            for (const auto& [l, _] : labels) {
+                                if (l != epsilon) _successors.push_back(successor_t{l, position, static_cast<uint32_t>(to)});
                             }
                         }
+                        ++position;
                     }
+                });
+                range.second = _successors.size();
+                std::sort(_successors.begin() + range.first, _successors.end(), [](const successor_t& a, const successor_t& b) {
+                    return std::tie(a._label, a._position) < std::tie(b._label, b._position);
+                });
+            }
+            return std::make_pair(_successors.cbegin() + range.first, _successors.cbegin() + range.second);
+        }
+
+        // Calls fn(label) for each non-epsilon label of an edge, expanding a wildcard edge to all labels.
+        template<typename labels_map_t, typename Fn>
+        void for_each_label(const labels_map_t& labels, Fn&& fn) const {
+            if (labels.contains(wildcard)) {
+                for (uint32_t l = 0; l < _pda.number_of_labels(); ++l) {
+                    fn(l);
+                }
+            } else {
+                for (const auto& [l, _] : labels) {
+                    if (l != epsilon) fn(l);
                 }
             }
-            return _product.has_accepting_state();
+        }
+        // The common labels (with trace from the first argument) of two edges, where a wildcard label matches all labels.
+        // The result is written to labels, so the caller can reuse the buffer.
+        template<typename labels_map1_t, typename labels_map2_t, typename elem_t>
+        void intersect_labels(const labels_map1_t& labels1, const labels_map2_t& labels2, std::vector<elem_t>& labels) const {
+            labels.clear();
+            auto wildcard1 = labels1.get(wildcard);
+            bool wildcard2 = labels2.contains(wildcard);
+            if (wildcard1 == nullptr && !wildcard2) {
+                std::set_intersection(labels1.begin(), labels1.end(), labels2.begin(), labels2.end(), std::back_inserter(labels));
+            } else if (wildcard1 == nullptr) {
+                std::copy_if(labels1.begin(), labels1.end(), std::back_inserter(labels), [](const auto& elem){ return elem.first != epsilon; });
+            } else {
+                for_each_label(labels2, [&labels, &labels1, wildcard1](uint32_t l) {
+                    auto trace = labels1.get(l);
+                    labels.emplace_back(l, trace != nullptr ? *trace : *wildcard1);
+                });
+            }
         }
 
         static std::vector<size_t> get_initial_accepting(const automaton_t& a1, const automaton_t& a2) {
@@ -453,6 +777,26 @@ namespace pdaaal {
         ptrie::set_stable<pair_size_t> _id_map;
         std::vector<std::vector<std::pair<size_t,size_t>>> _id_fast_lookup; // maps initial_state -> (final_state, product_state)
         std::vector<std::vector<std::pair<size_t,size_t>>> _id_fast_lookup_back; // maps final_state -> (initial_state, product_state)  Only used in dual_search
+        // Successor index of the automaton that is only read during saturation, see build_successor_index.
+        struct successor_t {
+            uint32_t _label;
+            uint32_t _position;
+            uint32_t _to;
+        };
+        static constexpr size_t not_indexed = std::numeric_limits<size_t>::max();
+        const automaton_t* _indexed_automaton = nullptr;
+        std::vector<std::pair<size_t,size_t>> _successor_ranges; // Range in _successors of each state, or not_indexed.
+        std::vector<successor_t> _successors;
+        // Buffers reused between calls to add_edge and construct_reachable.
+        std::vector<size_t> _waiting;
+        std::vector<std::pair<size_t,size_t>> _waiting_pairs;
+        std::vector<typename fut::vector_map<uint32_t,trace_ptr<W>>::value_type> _labels_scratch;
+        // Emptiness-only mode:
+        bool _emptiness_only = false;
+        bool _accepting_pair = false;
+        std::unordered_set<uint64_t, absl::Hash<uint64_t>> _pairs; // Reachable (initial_state, final_state) pairs, packed into 64 bits.
+        std::vector<std::vector<uint32_t>> _pairs_fast_lookup;      // maps initial_state -> final_states
+        std::vector<std::vector<uint32_t>> _pairs_fast_lookup_back; // maps final_state -> initial_states  Only used in dual_search
     };
 
     template<typename label_t, typename W, typename state_t, bool skip_state_mapping, bool indirect>
@@ -30,22 +30,103 @@
 
 namespace pdaaal {
 
+    namespace {
+        // Word-wise kernels on bitsets. They are written as plain loops over words, so the compiler can vectorize them.
+        bool any_and_words(const uint64_t* a, const uint64_t* b, size_t n) {
+            uint64_t acc = 0;
+            for (size_t i = 0; i < n; ++i) {
+                acc |= a[i] & b[i];
+            }
+            return acc != 0;
+        }
+        void or_words(uint64_t* __restrict dst, const uint64_t* __restrict src, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                dst[i] |= src[i];
+            }
+        }
+        void bits_to_labels(const std::vector<uint64_t>& bits, std::vector<uint32_t>& labels) {
+            labels.clear();
+            for (size_t w = 0; w < bits.size(); ++w) {
+                for (auto word = bits[w]; word != 0; word &= word - 1) {
+                    labels.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+                }
+            }
+        }
+    }
+
+    void labels_t::update_bitset() {
+        if (!use_bitset()) {
+            _bits.clear();
+            return;
+        }
+        _bits.assign(_labels.back() / 64 + 1, 0);
+        for (auto label : _labels) {
+            _bits[label / 64] |= uint64_t(1) << (label % 64);
+        }
+    }
+
+    bool labels_t::intersects(const std::vector<uint32_t>& other) const {
+        if (_wildcard) return !other.empty();
+        if (!_bits.empty()) {
+            return std::any_of(other.begin(), other.end(), [this](uint32_t label){ return contains(label); });
+        }
+        assert(std::is_sorted(other.begin(), other.end()));
+        auto it = _labels.begin();
+        for (auto label : other) {
+            while (it != _labels.end() && *it < label) ++it;
+            if (it == _labels.end()) return false;
+            if (*it == label) return true;
+        }
+        return false;
+    }
+
+    bool labels_t::intersects(const labels_t& other) const {
+        if (_wildcard) return !other.empty();
+        if (other._wildcard) return !empty();
+        if (!_bits.empty() && !other._bits.empty()) {
+            return any_and_words(_bits.data(), other._bits.data(), std::min(_bits.size(), other._bits.size()));
+        }
+        if (!other._bits.empty()) {
+            return other.intersects(_labels);
+        }
+        return intersects(other._labels);
+    }
+
     void labels_t::merge(bool wildcard, const std::vector<uint32_t>& other) {
         if (_wildcard) return;
         if (wildcard) {
             _wildcard = true;
             _labels.clear();
+            _bits.clear();
             return;
         }
 
         assert(std::is_sorted(_labels.begin(), _labels.end()));
         assert(std::is_sorted(other.begin(), other.end()));
+        if (!_bits.empty() && std::all_of(other.begin(), other.end(), [this](uint32_t label){ return contains(label); })) {
+            return; // Common case when rules are added one pre-label at a time.
+        }
         std::vector<uint32_t> temp_labels;
         temp_labels.swap(_labels);
         std::set_union(temp_labels.begin(), temp_labels.end(),
                        other.begin(), other.end(),
                        std::back_inserter(_labels));
         assert(std::is_sorted(_labels.begin(), _labels.end()));
+        update_bitset();
+    }
+
+    void labels_t::merge(const labels_t& other) {
+        if (_wildcard) return;
+        if (other._wildcard || _bits.empty() || other._bits.empty()) {
+            merge(other._wildcard, other._labels);
+            return;
+        }
+        if (_bits.size() < other._bits.size()) {
+            _bits.resize(other._bits.size(), 0);
+        }
+        or_words(_bits.data(), other._bits.data(), other._bits.size());
+        bits_to_labels(_bits, _labels);
+        assert(use_bitset());
     }
 
     bool labels_t::intersect(const std::vector<uint32_t>& other, size_t all_labels) {
@@ -61,6 +142,12 @@ namespace pdaaal {
                 _wildcard = false;
             }
         }
+        else if (!_bits.empty()) {
+            std::vector<uint32_t> result;
+            std::copy_if(other.begin(), other.end(), std::back_inserter(result), [this](uint32_t label){ return contains(label); });
+            _labels.swap(result);
+            assert(_labels.size() != all_labels);
+        }
         else {
             auto fit = other.begin();
             size_t bit = 0;
@@ -75,6 +162,7 @@ namespace pdaaal {
             _labels.resize(bit);
             assert(_labels.size() != all_labels);
         }
+        update_bitset();
         return !empty();
     }
 
@@ -82,6 +170,7 @@ namespace pdaaal {
         if (_wildcard) {
             _labels.insert(_labels.begin(), usefull.begin(), usefull.end());
             _wildcard = false;
+            update_bitset();
             return true;
         }
         else {
@@ -101,6 +190,7 @@ namespace pdaaal {
             }
             if (wit != it) {
                 _labels.resize(wit - _labels.begin());
+                update_bitset();
                 return true;
             }
         }
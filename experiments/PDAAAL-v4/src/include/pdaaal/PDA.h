@@ -32,6 +32,9 @@
 #include <pdaaal/utils/fut_set.h>
 
 #include <cinttypes>
+#include <cassert>
+#include <memory>
+#include <tuple>
 #include <vector>
 #include <unordered_set>
 #include <set>
@@ -41,12 +44,18 @@
 
 namespace pdaaal {
 
+    // Set of pre-labels of a rule. The labels are stored as a sorted vector. When the set is large and dense enough,
+    // a bitset over the labels is kept alongside, which gives constant-time contains and word-wise union and intersection.
     struct labels_t {
     private:
         bool _wildcard = false;
         std::vector<uint32_t> _labels;
+        std::vector<uint64_t> _bits; // Empty unless use_bitset() holds for _labels.
 
     public:
+        // A bitset is used for sets of at least this many labels, if the bitset uses at most one word per label in the set.
+        static constexpr size_t bitset_min_size = 16;
+
         labels_t() = default;
 
         [[nodiscard]] bool wildcard() const {
@@ -61,22 +70,44 @@ namespace pdaaal {
             return !_wildcard && _labels.empty();
         }
 
+        [[nodiscard]] bool has_bitset() const {
+            return !_bits.empty();
+        }
+
         [[nodiscard]] bool contains(uint32_t label) const {
             if (_wildcard) return true;
+            if (!_bits.empty()) {
+                auto word = label / 64;
+                return word < _bits.size() && ((_bits[word] >> (label % 64)) & 1);
+            }
             auto lb = std::lower_bound(_labels.begin(), _labels.end(), label);
             return lb != std::end(_labels) && *lb == label;
         }
 
+        // Is the intersection with a sorted vector of labels non-empty.
+        [[nodiscard]] bool intersects(const std::vector<uint32_t>& other) const;
+        // Is the intersection with another label set non-empty.
+        [[nodiscard]] bool intersects(const labels_t& other) const;
+
         void clear() {
             _wildcard = false;
             _labels.clear();
+            _bits.clear();
         }
 
         void merge(bool wildcard, const std::vector<uint32_t>& other);
 
+        void merge(const labels_t& other);
+
         bool intersect(const std::vector<uint32_t> &tos, size_t all_labels);
 
         bool noop_pre_filter(const std::set<uint32_t> &usefull);
+
+    private:
+        [[nodiscard]] bool use_bitset() const {
+            return !_wildcard && _labels.size() >= bitset_min_size && _labels.back() / 64 < _labels.size();
+        }
+        void update_bitset();
     };
 
     enum op_t {
@@ -138,6 +169,200 @@ namespace pdaaal::details {
             return H::combine(std::move(h), rule._to, rule._operation, rule._weight, rule._op_label);
         }
     };
+
+    // Precomputed index of the rules of a PDA, so the saturation algorithms only visit rules that can fire.
+    // Forward (used by post*): (from-state, pre-label) -> rule ids. Wildcard rules are kept in a separate list per state.
+    // Reverse (used by pre*): (to-state, op-label) -> (from-state, rule id) for SWAP and PUSH rules,
+    // and (to-state, pre-label) -> (from-state, rule id) for NOOP rules, with wildcard NOOP rules in a separate list.
+    // POP rules are only used when initializing pre*, so they are not in the reverse index.
+    // The index is stored CSR-style, i.e. a flat vector of entries sorted by (state, label) and an offset per state.
+    class rule_index {
+    public:
+        struct post_entry_t {
+            uint32_t _label;
+            uint32_t _rule_id;
+            bool operator<(const post_entry_t& other) const {
+                return std::tie(_label, _rule_id) < std::tie(other._label, other._rule_id);
+            }
+        };
+        struct pre_entry_t {
+            uint32_t _label;
+            uint32_t _rule_id;
+            size_t _from;
+            bool operator<(const pre_entry_t& other) const {
+                return std::tie(_label, _from, _rule_id) < std::tie(other._label, other._from, other._rule_id);
+            }
+        };
+        template <typename T>
+        class range_t {
+            const T* _begin;
+            const T* _end;
+        public:
+            range_t(const T* begin, const T* end) : _begin(begin), _end(end) {};
+            [[nodiscard]] const T* begin() const { return _begin; }
+            [[nodiscard]] const T* end() const { return _end; }
+            [[nodiscard]] bool empty() const { return _begin == _end; }
+            [[nodiscard]] size_t size() const { return _end - _begin; }
+        };
+
+        template <typename state_t>
+        explicit rule_index(const std::vector<state_t>& states) {
+            _post_offsets.reserve(states.size() + 1);
+            _post_wildcard_offsets.reserve(states.size() + 1);
+            for (const auto& state : states) {
+                _post_offsets.push_back(_post_entries.size());
+                _post_wildcard_offsets.push_back(_post_wildcard.size());
+                uint32_t rule_id = 0;
+                for (const auto& [rule, labels] : state._rules) {
+                    if (labels.wildcard()) {
+                        _post_wildcard.push_back(rule_id);
+                    } else {
+                        for (auto label : labels.labels()) {
+                            _post_entries.push_back(post_entry_t{label, rule_id});
+                        }
+                    }
+                    ++rule_id;
+                }
+                std::sort(_post_entries.begin() + _post_offsets.back(), _post_entries.end());
+            }
+            _post_offsets.push_back(_post_entries.size());
+            _post_wildcard_offsets.push_back(_post_wildcard.size());
+            build_pre_index(states);
+        }
+
+        // Rules from state 'from' that has 'label' explicitly in their pre-labels (i.e. not including wildcard rules).
+        [[nodiscard]] range_t<post_entry_t> post_rules(size_t from, uint32_t label) const {
+            assert(from + 1 < _post_offsets.size());
+            auto [lb, ub] = std::equal_range(_post_entries.data() + _post_offsets[from], _post_entries.data() + _post_offsets[from + 1],
+                                             post_entry_t{label, 0}, [](const auto& a, const auto& b){ return a._label < b._label; });
+            return {lb, ub};
+        }
+        // Rules from state 'from' with wildcard pre-label.
+        [[nodiscard]] range_t<uint32_t> post_wildcard_rules(size_t from) const {
+            assert(from + 1 < _post_wildcard_offsets.size());
+            return {_post_wildcard.data() + _post_wildcard_offsets[from], _post_wildcard.data() + _post_wildcard_offsets[from + 1]};
+        }
+        // Calls fn(rule_id) for each rule from state 'from' that can fire on 'label'.
+        template <typename Fn>
+        void for_each_post_rule(size_t from, uint32_t label, Fn&& fn) const {
+            for (const auto& entry : post_rules(from, label)) {
+                fn(entry._rule_id);
+            }
+            for (auto rule_id : post_wildcard_rules(from)) {
+                fn(rule_id);
+            }
+        }
+
+        // SWAP and PUSH rules into state 'to' with op-label 'label'.
+        [[nodiscard]] range_t<pre_entry_t> pre_rules(size_t to, uint32_t label) const {
+            return equal_label_range(_pre_offsets, _pre_entries, to, label);
+        }
+        // NOOP rules into state 'to' that has 'label' explicitly in their pre-labels.
+        [[nodiscard]] range_t<pre_entry_t> pre_noop_rules(size_t to, uint32_t label) const {
+            return equal_label_range(_pre_noop_offsets, _pre_noop_entries, to, label);
+        }
+        // All SWAP and PUSH rules into state 'to'.
+        [[nodiscard]] range_t<pre_entry_t> pre_rules(size_t to) const {
+            assert(to + 1 < _pre_offsets.size());
+            return {_pre_entries.data() + _pre_offsets[to], _pre_entries.data() + _pre_offsets[to + 1]};
+        }
+        // All (NOOP rule, explicit pre-label) pairs into state 'to'.
+        [[nodiscard]] range_t<pre_entry_t> pre_noop_rules(size_t to) const {
+            assert(to + 1 < _pre_noop_offsets.size());
+            return {_pre_noop_entries.data() + _pre_noop_offsets[to], _pre_noop_entries.data() + _pre_noop_offsets[to + 1]};
+        }
+        // NOOP rules into state 'to' with wildcard pre-label. The _label of these entries is not used.
+        [[nodiscard]] range_t<pre_entry_t> pre_noop_wildcard_rules(size_t to) const {
+            assert(to + 1 < _pre_noop_wildcard_offsets.size());
+            return {_pre_noop_wildcard.data() + _pre_noop_wildcard_offsets[to], _pre_noop_wildcard.data() + _pre_noop_wildcard_offsets[to + 1]};
+        }
+
+    private:
+        std::vector<size_t> _post_offsets;
+        std::vector<post_entry_t> _post_entries;
+        std::vector<size_t> _post_wildcard_offsets;
+        std::vector<uint32_t> _post_wildcard;
+
+        std::vector<size_t> _pre_offsets;
+        std::vector<pre_entry_t> _pre_entries;
+        std::vector<size_t> _pre_noop_offsets;
+        std::vector<pre_entry_t> _pre_noop_entries;
+        std::vector<size_t> _pre_noop_wildcard_offsets;
+        std::vector<pre_entry_t> _pre_noop_wildcard;
+
+        static range_t<pre_entry_t> equal_label_range(const std::vector<size_t>& offsets, const std::vector<pre_entry_t>& entries, size_t to, uint32_t label) {
+            assert(to + 1 < offsets.size());
+            auto [lb, ub] = std::equal_range(entries.data() + offsets[to], entries.data() + offsets[to + 1],
+                                             pre_entry_t{label, 0, 0}, [](const auto& a, const auto& b){ return a._label < b._label; });
+            return {lb, ub};
+        }
+
+        template <typename state_t>
+        void build_pre_index(const std::vector<state_t>& states) {
+            // Count entries per to-state, then fill in place (counting sort on to-state), then sort each segment by label.
+            auto n = states.size();
+            _pre_offsets.assign(n + 1, 0);
+            _pre_noop_offsets.assign(n + 1, 0);
+            _pre_noop_wildcard_offsets.assign(n + 1, 0);
+            for (const auto& state : states) {
+                for (const auto& [rule, labels] : state._rules) {
+                    switch (rule._operation) {
+                        case SWAP:
+                        case PUSH:
+                            ++_pre_offsets[rule._to + 1];
+                            break;
+                        case NOOP:
+                            if (labels.wildcard()) {
+                                ++_pre_noop_wildcard_offsets[rule._to + 1];
+                            } else {
+                                _pre_noop_offsets[rule._to + 1] += labels.labels().size();
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+            for (size_t i = 0; i < n; ++i) {
+                _pre_offsets[i + 1] += _pre_offsets[i];
+                _pre_noop_offsets[i + 1] += _pre_noop_offsets[i];
+                _pre_noop_wildcard_offsets[i + 1] += _pre_noop_wildcard_offsets[i];
+            }
+            _pre_entries.resize(_pre_offsets[n]);
+            _pre_noop_entries.resize(_pre_noop_offsets[n]);
+            _pre_noop_wildcard.resize(_pre_noop_wildcard_offsets[n]);
+            std::vector<size_t> pre_next(_pre_offsets.begin(), _pre_offsets.end() - 1);
+            std::vector<size_t> noop_next(_pre_noop_offsets.begin(), _pre_noop_offsets.end() - 1);
+            std::vector<size_t> wildcard_next(_pre_noop_wildcard_offsets.begin(), _pre_noop_wildcard_offsets.end() - 1);
+            for (size_t from = 0; from < n; ++from) {
+                uint32_t rule_id = 0;
+                for (const auto& [rule, labels] : states[from]._rules) {
+                    switch (rule._operation) {
+                        case SWAP:
+                        case PUSH:
+                            _pre_entries[pre_next[rule._to]++] = pre_entry_t{rule._op_label, rule_id, from};
+                            break;
+                        case NOOP:
+                            if (labels.wildcard()) {
+                                _pre_noop_wildcard[wildcard_next[rule._to]++] = pre_entry_t{0, rule_id, from};
+                            } else {
+                                for (auto label : labels.labels()) {
+                                    _pre_noop_entries[noop_next[rule._to]++] = pre_entry_t{label, rule_id, from};
+                                }
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                    ++rule_id;
+                }
+            }
+            for (size_t to = 0; to < n; ++to) {
+                std::sort(_pre_entries.begin() + _pre_offsets[to], _pre_entries.begin() + _pre_offsets[to + 1]);
+                std::sort(_pre_noop_entries.begin() + _pre_noop_offsets[to], _pre_noop_entries.begin() + _pre_noop_offsets[to + 1]);
+            }
+        }
+    };
 }
 
 namespace pdaaal {
@@ -221,9 +446,19 @@ namespace pdaaal {
             return _states;
         }
         std::vector<state_t>& states_mutable() {
+            _rule_index.reset();
             return _states;
         }
+        // The rule index is built on first use, and discarded when the rules are changed.
+        const details::rule_index& rule_index() const {
+            static_assert(Container == fut::type::vector, "Rule ids are only defined for the vector container.");
+            if (!_rule_index) {
+                _rule_index = std::make_shared<const details::rule_index>(_states);
+            }
+            return *_rule_index;
+        }
         void clear_state(size_t s) {
+            _rule_index.reset();
             _states[s]._rules.clear();
             for (auto& p : _states[s]._pre_states) {
                 auto rit = _states[p]._rules.begin();
@@ -252,6 +487,7 @@ namespace pdaaal {
         // Derived classes may want to add empty states.
         void add_state(size_t s) {
             if (s >= _states.size()) {
+                _rule_index.reset();
                 _states.resize(s + 1);
             }
         }
@@ -262,6 +498,7 @@ namespace pdaaal {
             add_untyped_rule_<W>(std::forward<Args>(args)...);
         }
         void add_untyped_rule_impl(size_t from, rule_t r, bool wildcard, const std::vector<uint32_t>& pre_labels) {
+            _rule_index.reset();
             add_state(std::max(from, r._to));
             _states[from]._rules.emplace(r, labels_t()).first->second.merge(wildcard, pre_labels);
             _states[r._to]._pre_states.emplace(from);
@@ -278,6 +515,7 @@ namespace pdaaal {
         }
 
         std::vector<state_t> _states;
+        mutable std::shared_ptr<const details::rule_index> _rule_index;
     };
 
 }
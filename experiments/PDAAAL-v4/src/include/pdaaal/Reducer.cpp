@@ -88,19 +88,7 @@ namespace pdaaal {
         if (labels.wildcard()) {
             return true;
         }
-        auto rit = labels.labels().begin();
-        bool match = false;
-        for (auto& s : prev._tos) {
-            while (rit != std::end(labels.labels()) && *rit < s) ++rit;
-            if (rit == std::end(labels.labels())) {
-                break;
-            }
-            if (*rit == s) {
-                match = true;
-                break;
-            }
-        }
-        return match;
+        return labels.intersects(prev._tos);
     }
 
     std::pair<bool, bool>
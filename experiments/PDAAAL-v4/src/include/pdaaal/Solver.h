@@ -28,51 +28,79 @@
 #define PDAAAL_SOLVER_H
 
 #include <pdaaal/utils/workset.h>
+#include <pdaaal/utils/edge_set.h>
+#include <pdaaal/utils/work_queue.h>
+#include <pdaaal/utils/budget.h>
+#include <pdaaal/utils/dual_scheduler.h>
+#include <pdaaal/utils/scc_fixed_point.h>
 #include <pdaaal/AutomatonPath.h>
 #include <pdaaal/PAutomaton.h>
 #include <pdaaal/TypedPDA.h>
 #include <pdaaal/SolverInstance.h>
 #include <absl/hash/hash.h>
+#include <optional>
+#include <tuple>
 
 namespace pdaaal {
 
     namespace details {
         constexpr auto epsilon = std::numeric_limits<uint32_t>::max();
 
-        struct temp_edge_t {
-            size_t _from = std::numeric_limits<size_t>::max();
-            size_t _to = std::numeric_limits<size_t>::max();
+        // The PAutomaton numbers its states by size_t, but the saturation procedures store state ids as state_id_t
+        // (a template parameter, uint32_t by default) in their worksets and relations, which halves the size of these.
+        // The max value of state_id_t is reserved, and check_state_ids throws if the automaton has too many states.
+        template <typename state_id_t>
+        inline void check_state_ids(size_t n_automaton_states) {
+            if (n_automaton_states >= std::numeric_limits<state_id_t>::max()) {
+                throw std::runtime_error("Too many automaton states (" + std::to_string(n_automaton_states) + ") for the state id type of the solver.");
+            }
+        }
+
+        template <typename state_id_t>
+        struct basic_temp_edge_t {
+            state_id_t _from = std::numeric_limits<state_id_t>::max();
+            state_id_t _to = std::numeric_limits<state_id_t>::max();
             uint32_t _label = std::numeric_limits<uint32_t>::max();
 
-            temp_edge_t() = default;
+            constexpr basic_temp_edge_t() = default;
 
-            temp_edge_t(size_t from, uint32_t label, size_t to)
-                    : _from(from), _to(to), _label(label) {};
+            basic_temp_edge_t(size_t from, uint32_t label, size_t to)
+                    : _from(static_cast<state_id_t>(from)), _to(static_cast<state_id_t>(to)), _label(label) {
+                assert(from < std::numeric_limits<state_id_t>::max() && to < std::numeric_limits<state_id_t>::max());
+            };
 
-            bool operator<(const temp_edge_t& other) const {
+            bool operator<(const basic_temp_edge_t& other) const {
                 return std::tie(_from, _label, _to) < std::tie(other._from, other._label, other._to);
             }
-            bool operator==(const temp_edge_t& other) const {
+            bool operator==(const basic_temp_edge_t& other) const {
                 return _from == other._from && _to == other._to && _label == other._label;
             }
-            bool operator!=(const temp_edge_t& other) const { return !(*this == other); }
+            bool operator!=(const basic_temp_edge_t& other) const { return !(*this == other); }
 
             template <typename H>
-            friend H AbslHashValue(H h, const temp_edge_t& e) {
+            friend H AbslHashValue(H h, const basic_temp_edge_t& e) {
                 return H::combine(std::move(h), e._from, e._to, e._label);
             }
         };
+        using temp_edge_t = basic_temp_edge_t<uint32_t>; // With the default state id type of the saturation procedures.
 
         template <typename W>
         using early_termination_fn = std::function<bool(size_t,uint32_t,size_t,trace_ptr<W>)>;
 
-        template <typename W, bool ET=false>
+        template <typename W, bool ET=false, typename EdgeSet = packed_edge_set, typename state_id_t = uint32_t,
+                  typename Workset = lifo_workset<basic_temp_edge_t<state_id_t>>>
         class PreStarSaturation {
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
+            static constexpr auto wildcard = PAutomaton<W>::wildcard;
+            static_assert(wildcard == details::edge_set_wildcard);
         public:
-            explicit PreStarSaturation(PAutomaton<W> &automaton, const early_termination_fn<W>& early_termination = [](size_t f, uint32_t l, size_t t, trace_ptr<W> trace) -> bool { return false; })
+            explicit PreStarSaturation(PAutomaton<W> &automaton, const early_termination_fn<W>& early_termination = [](size_t f, uint32_t l, size_t t, trace_ptr<W> trace) -> bool { return false; },
+                                       Workset workset = Workset())
                     : _automaton(automaton), _early_termination(early_termination), _pda_states(_automaton.pda().states()),
+                      _rule_index(_automaton.pda().rule_index()),
                       _n_pda_states(_pda_states.size()), _n_automaton_states(_automaton.states().size()),
-                      _n_pda_labels(_automaton.number_of_labels()), _rel(_n_automaton_states), _delta_prime(_n_automaton_states) {
+                      _n_pda_labels(_automaton.number_of_labels()), _edges(_n_automaton_states, _n_pda_labels),
+                      _workset(std::move(workset)), _rel(_n_automaton_states), _delta_prime(_n_automaton_states) {
                 initialize();
             };
 
@@ -84,21 +112,24 @@ namespace pdaaal {
             PAutomaton<W>& _automaton;
             const early_termination_fn<W>& _early_termination;
             const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
             const size_t _n_pda_states;
             const size_t _n_automaton_states;
             const size_t _n_pda_labels;
-            std::unordered_set<temp_edge_t, absl::Hash<temp_edge_t>> _edges;
-            std::stack<temp_edge_t> _workset;
-            std::vector<std::vector<std::pair<size_t,uint32_t>>> _rel;
-            std::vector<std::vector<std::pair<size_t, size_t>>> _delta_prime;
+            EdgeSet _edges;
+            Workset _workset;
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _rel;
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _delta_prime;
             bool _found = false;
 
             void initialize() {
+                _automaton.thaw(); // Saturation adds edges, so it works on the normal (not frozen) representation.
+                check_state_ids<state_id_t>(_n_automaton_states);
                 // workset := ->_0  (line 1)
                 for (const auto &from : _automaton.states()) {
-                    for (const auto &[to,labels] : from->_edges) {
+                    for (const auto &[to,labels] : from->edges()) {
                         for (const auto &[label,_] : labels) {
-                            insert_edge(from->_id, label, to, nullptr);
+                            insert_edge(from->_id, label, to, trace_handle());
                         }
                     }
                 }
@@ -114,35 +145,48 @@ namespace pdaaal {
                     }
                 }
             }
-            void insert_edge(size_t from, uint32_t label, size_t to, const trace_t *trace) {
+            void insert_edge(size_t from, uint32_t label, size_t to, trace_handle trace) {
+                if (label != wildcard && _edges.contains(from, wildcard, to)) return; // Already covered by a wildcard edge.
                 auto res = _edges.emplace(from, label, to);
                 if (res.second) { // New edge is not already in edges (rel U workset).
-                    _workset.emplace(from, label, to);
-                    if (trace != nullptr) { // Don't add existing edges
-                        _automaton.add_edge(from, to, label, trace_ptr_from<W>(trace));
+                    _workset.push(temp_edge_t{from, label, to});
+                    if (!trace.is_null()) { // Don't add existing edges
+                        if (label == wildcard) {
+                            _automaton.add_wildcard_edge(from, to, trace_ptr_from<W>(trace));
+                        } else {
+                            _automaton.add_edge(from, to, label, trace_ptr_from<W>(trace));
+                        }
                         if constexpr (ET) {
                             _found = _found || _early_termination(from, label, to, trace_ptr_from<W>(trace));
                         }
                     }
                 }
             };
-            void insert_edge_bulk(size_t from, const labels_t &precondition, size_t to, const trace_t *trace) {
+            void insert_edge_bulk(size_t from, const labels_t &precondition, size_t to, trace_handle trace) {
                 if (precondition.wildcard()) {
-                    for (uint32_t i = 0; i < _n_pda_labels; i++) {
-                        insert_edge(from, i, to, trace);
-                    }
+                    insert_edge(from, wildcard, to, trace);
                 } else {
                     for (auto &label : precondition.labels()) {
                         insert_edge(from, label, to, trace);
                     }
                 }
             };
+            // Insert edges (from, l, to) for the labels l in precondition that match label (which may be wildcard).
+            void insert_edge_matching(size_t from, const labels_t &precondition, uint32_t label, size_t to, trace_handle trace) {
+                if (label == wildcard) {
+                    insert_edge_bulk(from, precondition, to, trace);
+                } else {
+                    insert_edge(from, label, to, trace);
+                }
+            }
+            [[nodiscard]] static bool matches(const labels_t &precondition, uint32_t label) {
+                return label == wildcard || precondition.contains(label);
+            }
 
         public:
             void step() {
                 // pop t = (q, y, q') from workset (line 4)
-                auto t = _workset.top();
-                _workset.pop();
+                auto t = _workset.pop();
                 // rel = rel U {t} (line 6)   (membership test on line 5 is done in insert_edge).
                 _rel[t._from].emplace_back(t._to, t._label);
 
@@ -150,65 +194,330 @@ namespace pdaaal {
                 for (auto pair : _delta_prime[t._from]) { // Loop over delta_prime (that match with t->from)
                     auto state = pair.first;
                     auto rule_id = pair.second;
-                    if (_pda_states[state]._rules[rule_id].second.contains(t._label)) {
-                        insert_edge(state, t._label, t._to, _automaton.new_pre_trace(rule_id, t._from));
+                    const auto &labels = _pda_states[state]._rules[rule_id].second;
+                    if (matches(labels, t._label)) {
+                        insert_edge_matching(state, labels, t._label, t._to, _automaton.new_pre_trace(rule_id, t._from));
                     }
                 }
-                // Loop over \Delta (filter rules going into q) (line 7 and 9)
+                // Loop over \Delta (rules going into q that can fire on t._label, found via the reverse rule index) (line 7 and 9)
+                // A wildcard edge matches all rules into q.
                 if (t._from >= _n_pda_states) { return; }
-                for (auto pre_state : _pda_states[t._from]._pre_states) {
-                    const auto &rules = _pda_states[pre_state]._rules;
-                    auto lb = rules.lower_bound(details::rule_t<W>{t._from});
-                    while (lb != rules.end() && lb->first._to == t._from) {
-                        const auto &[rule, labels] = *lb;
-                        size_t rule_id = lb - rules.begin();
-                        ++lb;
-                        switch (rule._operation) {
-                            case POP:
-                                break;
-                            case SWAP: // (line 7-8 for \Delta)
-                                if (rule._op_label == t._label) {
-                                    insert_edge_bulk(pre_state, labels, t._to, _automaton.new_pre_trace(rule_id));
-                                }
-                                break;
-                            case NOOP: // (line 7-8 for \Delta)
-                                if (labels.contains(t._label)) {
-                                    insert_edge(pre_state, t._label, t._to, _automaton.new_pre_trace(rule_id));
+                for (const auto& entry : t._label == wildcard ? _rule_index.pre_rules(t._from) : _rule_index.pre_rules(t._from, t._label)) {
+                    auto pre_state = entry._from;
+                    auto rule_id = entry._rule_id;
+                    const auto &[rule, labels] = _pda_states[pre_state]._rules[rule_id];
+                    assert(rule._to == t._from && (t._label == wildcard || rule._op_label == t._label));
+                    switch (rule._operation) {
+                        case SWAP: // (line 7-8 for \Delta)
+                            insert_edge_bulk(pre_state, labels, t._to, _automaton.new_pre_trace(rule_id));
+                            break;
+                        case PUSH: { // (line 9)
+                            // (line 10)
+                            _delta_prime[t._to].emplace_back(pre_state, rule_id);
+                            trace_handle trace;
+                            for (auto rel_rule : _rel[t._to]) { // (line 11-12)
+                                if (matches(labels, rel_rule.second)) {
+                                    trace = trace.is_null() ? _automaton.new_pre_trace(rule_id, t._to) : trace;
+                                    insert_edge_matching(pre_state, labels, rel_rule.second, rel_rule.first, trace);
                                 }
-                                break;
-                            case PUSH: // (line 9)
-                                if (rule._op_label == t._label) {
-                                    // (line 10)
-                                    _delta_prime[t._to].emplace_back(pre_state, rule_id);
-                                    const trace_t *trace = nullptr;
-                                    for (auto rel_rule : _rel[t._to]) { // (line 11-12)
-                                        if (labels.contains(rel_rule.second)) {
-                                            trace = trace == nullptr ? _automaton.new_pre_trace(rule_id, t._to) : trace;
-                                            insert_edge(pre_state, rel_rule.second, rel_rule.first, trace);
-                                        }
-                                    }
-                                }
-                                break;
-                            default:
-                                assert(false);
+                            }
+                            break;
                         }
+                        default:
+                            assert(false);
                     }
                 }
+                // (line 7-8 for \Delta, NOOP rules)
+                for (const auto& entry : t._label == wildcard ? _rule_index.pre_noop_rules(t._from) : _rule_index.pre_noop_rules(t._from, t._label)) {
+                    insert_edge(entry._from, entry._label, t._to, _automaton.new_pre_trace(entry._rule_id));
+                }
+                for (const auto& entry : _rule_index.pre_noop_wildcard_rules(t._from)) {
+                    insert_edge(entry._from, t._label, t._to, _automaton.new_pre_trace(entry._rule_id));
+                }
             }
             [[nodiscard]] bool workset_empty() const {
                 return _workset.empty();
             }
+            [[nodiscard]] size_t workset_size() const {
+                return _workset.size();
+            }
+            // Number of edges found so far (rel U workset).
+            [[nodiscard]] size_t number_of_edges() const {
+                return _edges.size();
+            }
             [[nodiscard]] bool found() const {
                 return _found;
             }
+            // Approximate number of bytes used by the edge set and trace information.
+            [[nodiscard]] size_t memory_usage() const {
+                return _edges.memory_usage() + _automaton.trace_memory_usage();
+            }
         };
 
-        template <typename W, bool ET=false>
+        // Multi-threaded version of PreStarSaturation. Gives the same saturated automaton (with valid, but possibly different, traces).
+        //  - The edge relation (used to deduplicate edges) is sharded by source state, each shard with its own lock.
+        //  - Each worker has its own worklist and steals work from other workers when it runs out, or sleeps if there is nothing to steal.
+        //  - _rel[q] and _delta_prime[q] are append-only, and appending is protected by a striped lock on q. Adding to one of them and
+        //    reading the size of the other happens in the same critical section, so each (edge, delta_prime) pair is seen by at least
+        //    one of the workers. The elements up to that size are then read without the lock.
+        //  - With early termination, adding edges (and traces) to the automaton and calling early_termination is done under one lock,
+        //    since neither PAutomaton nor the product construction (used by early termination) is thread-safe.
+        //    The lock can be given by the caller, so it is shared with the post* saturation in parallel dual*.
+        //    Without early termination, each worker collects its new edges, and they are added to the automaton when the workers are done.
+        template <typename W, bool ET=false, typename EdgeSet = packed_edge_set, typename state_id_t = uint32_t>
+        class ParallelPreStarSaturation {
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
+            static constexpr auto wildcard = PAutomaton<W>::wildcard;
+            static constexpr size_t shards_per_worker = 16;
+            struct shard_t {
+                std::mutex _mutex;
+                EdgeSet _edges;
+            };
+            struct alignas(64) memory_counter_t { // Separate cache lines to avoid false sharing between workers.
+                std::atomic<size_t> _bytes{0};
+            };
+        public:
+            ParallelPreStarSaturation(PAutomaton<W> &automaton, size_t n_workers, const early_termination_fn<W>& early_termination = [](size_t f, uint32_t l, size_t t, trace_ptr<W> trace) -> bool { return false; },
+                                      std::mutex* automaton_mutex = nullptr)
+                    : _automaton(automaton), _early_termination(early_termination), _pda_states(_automaton.pda().states()),
+                      _rule_index(_automaton.pda().rule_index()), // Build the rule index before starting workers.
+                      _n_pda_states(_pda_states.size()), _n_automaton_states(_automaton.states().size()),
+                      _n_pda_labels(_automaton.number_of_labels()), _shards(std::max<size_t>(n_workers, 1) * shards_per_worker),
+                      _state_locks(std::max<size_t>(n_workers, 1) * shards_per_worker),
+                      _rel(_n_automaton_states), _delta_prime(_n_automaton_states), _workset(std::max<size_t>(n_workers, 1)),
+                      _new_edges(_workset.workers()), _memory(_workset.workers()), _automaton_mutex(automaton_mutex != nullptr ? *automaton_mutex : _own_automaton_mutex) {
+                for (auto& shard : _shards) {
+                    shard._edges = EdgeSet(_n_automaton_states, _n_pda_labels);
+                }
+                initialize_memory();
+                initialize();
+            };
+
+            // Runs the saturation to completion, or until early termination or the budget is exceeded.
+            void run(const budget& limits = budget()) {
+                if (_found) return;
+                run_workers(_workset.workers(), [this,&limits](size_t worker){ work(worker, limits); });
+                add_new_edges();
+            }
+            [[nodiscard]] bool found() const {
+                return _found;
+            }
+            // Makes the workers (of a current or later call to run) stop after their current step. Can be called from any thread.
+            void stop() {
+                _workset.close();
+            }
+
+        private:
+            PAutomaton<W>& _automaton;
+            const early_termination_fn<W>& _early_termination;
+            const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
+            const size_t _n_pda_states;
+            const size_t _n_automaton_states;
+            const size_t _n_pda_labels;
+            std::vector<shard_t> _shards;
+            std::vector<std::mutex> _state_locks;
+            std::vector<append_only_vector<std::pair<state_id_t,uint32_t>>> _rel;
+            std::vector<append_only_vector<std::pair<state_id_t,uint32_t>>> _delta_prime;
+            work_stealing_queues<temp_edge_t> _workset;
+            std::vector<std::vector<std::tuple<state_id_t,uint32_t,state_id_t,trace_t>>> _new_edges; // Per worker, only used without ET.
+            std::vector<memory_counter_t> _memory; // Bytes added by each worker (approximately), only written by that worker.
+            size_t _initial_memory = 0;
+            std::mutex _own_automaton_mutex;
+            std::mutex& _automaton_mutex; // Shared with the saturation in the other direction in parallel dual*.
+            std::atomic<bool> _found{false};
+
+            // Called by all workers, so it sums the per-worker counters instead of locking the shards and the automaton.
+            [[nodiscard]] size_t memory_usage() const {
+                size_t bytes = _initial_memory;
+                for (const auto& counter : _memory) {
+                    bytes += counter._bytes.load(std::memory_order_relaxed);
+                }
+                return bytes;
+            }
+            void count_memory(size_t worker, size_t bytes) {
+                _memory[worker]._bytes.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            void initialize_memory() {
+                _initial_memory = _automaton.trace_memory_usage();
+                for (const auto& shard : _shards) {
+                    _initial_memory += shard._edges.memory_usage();
+                }
+            }
+
+            void initialize() {
+                _automaton.thaw();
+                check_state_ids<state_id_t>(_n_automaton_states);
+                size_t worker = 0;
+                auto next_worker = [&worker, this]() { return worker++ % _workset.workers(); }; // Spread the initial edges.
+                for (const auto &from : _automaton.states()) {
+                    for (const auto &[to,labels] : from->edges()) {
+                        for (const auto &[label,_] : labels) {
+                            insert_edge(next_worker(), from->_id, label, to, trace_t());
+                        }
+                    }
+                }
+                for (size_t state = 0; state < _n_pda_states; ++state) {
+                    size_t rule_id = 0;
+                    for (const auto&[rule,labels] : _pda_states[state]._rules) {
+                        if (rule._operation == POP) {
+                            insert_edge_bulk(next_worker(), state, labels, rule._to, trace_t(rule_id, trace_t::no_state));
+                        }
+                        ++rule_id;
+                    }
+                }
+            }
+
+            void work(size_t worker, const budget& limits) {
+                temp_edge_t t;
+                size_t steps = 0;
+                while (_workset.pop(worker, t)) {
+                    if (++steps == budget::check_interval) { // Count steps in batches to avoid contention on the budget.
+                        steps = 0;
+                        if (!limits.allow_steps(budget::check_interval, [this](){ return memory_usage(); })) {
+                            stop();
+                            _workset.finish();
+                            break;
+                        }
+                    }
+                    step(worker, t);
+                    _workset.finish();
+                }
+            }
+
+            // A null trace means that the edge is already in the automaton.
+            void insert_edge(size_t worker, size_t from, uint32_t label, size_t to, const trace_t& trace) {
+                {
+                    auto& shard = _shards[from % _shards.size()];
+                    std::lock_guard lock(shard._mutex);
+                    if (label != wildcard && shard._edges.contains(from, wildcard, to)) return; // Already covered by a wildcard edge.
+                    auto edges_bytes = shard._edges.memory_usage();
+                    if (!shard._edges.emplace(from, label, to).second) return;
+                    count_memory(worker, shard._edges.memory_usage() - edges_bytes);
+                }
+                if (!trace.is_null()) {
+                    if constexpr (ET) {
+                        std::lock_guard lock(_automaton_mutex);
+                        auto trace_bytes = _automaton.trace_memory_usage();
+                        auto trace_ptr = add_automaton_edge(from, label, to, trace);
+                        count_memory(worker, _automaton.trace_memory_usage() - trace_bytes);
+                        if (!_found && _early_termination(from, label, to, trace_ptr_from<W>(trace_ptr))) {
+                            _found = true;
+                            _workset.close();
+                        }
+                    } else {
+                        _new_edges[worker].emplace_back(from, label, to, trace);
+                        count_memory(worker, sizeof(typename decltype(_new_edges)::value_type::value_type));
+                    }
+                }
+                _workset.push(worker, temp_edge_t{from, label, to});
+            }
+            trace_handle add_automaton_edge(size_t from, uint32_t label, size_t to, const trace_t& trace) {
+                auto trace_ptr = _automaton.new_trace(trace);
+                if (label == wildcard) {
+                    _automaton.add_wildcard_edge(from, to, trace_ptr_from<W>(trace_ptr));
+                } else {
+                    _automaton.add_edge(from, to, label, trace_ptr_from<W>(trace_ptr));
+                }
+                return trace_ptr;
+            }
+            // Called when the workers are done.
+            void add_new_edges() {
+                for (auto& edges : _new_edges) {
+                    for (const auto& [from, label, to, trace] : edges) {
+                        add_automaton_edge(from, label, to, trace);
+                    }
+                    edges = {};
+                }
+            }
+            void insert_edge_bulk(size_t worker, size_t from, const labels_t &precondition, size_t to, const trace_t& trace) {
+                if (precondition.wildcard()) {
+                    insert_edge(worker, from, wildcard, to, trace);
+                } else {
+                    for (auto &label : precondition.labels()) {
+                        insert_edge(worker, from, label, to, trace);
+                    }
+                }
+            }
+            void insert_edge_matching(size_t worker, size_t from, const labels_t &precondition, uint32_t label, size_t to, const trace_t& trace) {
+                if (label == wildcard) {
+                    insert_edge_bulk(worker, from, precondition, to, trace);
+                } else {
+                    insert_edge(worker, from, label, to, trace);
+                }
+            }
+            [[nodiscard]] static bool matches(const labels_t &precondition, uint32_t label) {
+                return label == wildcard || precondition.contains(label);
+            }
+            std::mutex& state_lock(size_t state) {
+                return _state_locks[state % _state_locks.size()];
+            }
+
+            void step(size_t worker, const temp_edge_t& t) {
+                size_t n_delta_prime;
+                {
+                    std::lock_guard lock(state_lock(t._from));
+                    _rel[t._from].emplace_back(t._to, t._label);
+                    n_delta_prime = _delta_prime[t._from].size();
+                }
+                _delta_prime[t._from].for_each(n_delta_prime, [&](const auto& delta_prime) {
+                    auto [state, rule_id] = delta_prime;
+                    const auto &labels = _pda_states[state]._rules[rule_id].second;
+                    if (matches(labels, t._label)) {
+                        insert_edge_matching(worker, state, labels, t._label, t._to, trace_t(rule_id, t._from));
+                    }
+                });
+                if (t._from >= _n_pda_states) { return; }
+                for (const auto& entry : t._label == wildcard ? _rule_index.pre_rules(t._from) : _rule_index.pre_rules(t._from, t._label)) {
+                    auto pre_state = entry._from;
+                    auto rule_id = entry._rule_id;
+                    const auto &[rule, labels] = _pda_states[pre_state]._rules[rule_id];
+                    switch (rule._operation) {
+                        case SWAP:
+                            insert_edge_bulk(worker, pre_state, labels, t._to, trace_t(rule_id, trace_t::no_state));
+                            break;
+                        case PUSH: {
+                            size_t n_rel;
+                            {
+                                std::lock_guard lock(state_lock(t._to));
+                                _delta_prime[t._to].emplace_back(pre_state, rule_id);
+                                n_rel = _rel[t._to].size();
+                            }
+                            _rel[t._to].for_each(n_rel, [&](const auto& rel) {
+                                auto [rel_to, rel_label] = rel;
+                                if (matches(labels, rel_label)) {
+                                    insert_edge_matching(worker, pre_state, labels, rel_label, rel_to, trace_t(rule_id, t._to));
+                                }
+                            });
+                            break;
+                        }
+                        default:
+                            assert(false);
+                    }
+                }
+                for (const auto& entry : t._label == wildcard ? _rule_index.pre_noop_rules(t._from) : _rule_index.pre_noop_rules(t._from, t._label)) {
+                    insert_edge(worker, entry._from, entry._label, t._to, trace_t(entry._rule_id, trace_t::no_state));
+                }
+                for (const auto& entry : _rule_index.pre_noop_wildcard_rules(t._from)) {
+                    insert_edge(worker, entry._from, t._label, t._to, trace_t(entry._rule_id, trace_t::no_state));
+                }
+            }
+        };
+
+        // Without trace_info, for queries that only need a yes/no answer (Trace_Type::None), no trace_t objects are created,
+        // and the relation is kept in the solver-side _rel1 and _rel2 only. Edges are then written to the PAutomaton (without traces)
+        // when materialize() is called, or eagerly when ET is enabled, since the early termination function may inspect the automaton
+        // (e.g. PAutomatonProduct).
+        template <typename W, bool ET=false, typename EdgeSet = packed_edge_set, typename state_id_t = uint32_t,
+                  typename Workset = fifo_workset<basic_temp_edge_t<state_id_t>>, bool trace_info = true>
         class PostStarSaturation {
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
         public:
-            explicit PostStarSaturation(PAutomaton<W> &automaton, const early_termination_fn<W>& early_termination = [](size_t f, uint32_t l, size_t t, trace_ptr<W> trace) -> bool { return false; })
+            explicit PostStarSaturation(PAutomaton<W> &automaton, const early_termination_fn<W>& early_termination = [](size_t f, uint32_t l, size_t t, trace_ptr<W> trace) -> bool { return false; },
+                                        Workset workset = Workset())
                     : _automaton(automaton), _early_termination(early_termination), _pda_states(_automaton.pda().states()),
-                      _n_pda_states(_pda_states.size()), _n_Q(_automaton.states().size()) {
+                      _rule_index(_automaton.pda().rule_index()), _n_pda_states(_pda_states.size()), _n_Q(_automaton.states().size()),
+                      _workset(std::move(workset)) {
                 initialize();
             };
 
@@ -220,19 +529,22 @@ namespace pdaaal {
             PAutomaton<W>& _automaton;
             const early_termination_fn<W>& _early_termination;
             const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
             const size_t _n_pda_states;
             const size_t _n_Q;
             std::unordered_map<std::pair<size_t, uint32_t>, size_t, absl::Hash<std::pair<size_t, uint32_t>>> _q_prime{};
 
             size_t _n_automaton_states{};
-            std::unordered_set<temp_edge_t, absl::Hash<temp_edge_t>> _edges;
-            std::queue<temp_edge_t> _workset;
-            std::vector<std::vector<std::pair<size_t,uint32_t>>> _rel1; // faster access for lookup _from -> (_to, _label)
-            std::vector<std::vector<size_t>> _rel2; // faster access for lookup _to -> _from  (when _label is uint32_t::max)
+            EdgeSet _edges;
+            Workset _workset;
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _rel1; // faster access for lookup _from -> (_to, _label)
+            std::vector<std::vector<state_id_t>> _rel2; // faster access for lookup _to -> _from  (when _label is uint32_t::max)
 
             bool _found = false;
+            bool _materialized = false;
 
             void initialize() {
+                _automaton.thaw();
                 // for <p, y> -> <p', y1 y2> do  (line 3)
                 //   Q' U= {q_p'y1}              (line 4)
                 for (auto &state : _pda_states) {
@@ -246,21 +558,23 @@ namespace pdaaal {
                     }
                 }
                 _n_automaton_states = _automaton.states().size();
+                check_state_ids<state_id_t>(_n_automaton_states);
+                _edges = EdgeSet(_n_automaton_states, _automaton.number_of_labels());
                 _rel1.resize(_n_automaton_states);
                 _rel2.resize(_n_automaton_states - _n_Q);
 
                 // workset := ->_0 intersect (P x Gamma x Q)  (line 1)
                 // rel := ->_0 \ workset (line 2)
                 for (const auto& from : _automaton.states()) {
-                    for (const auto& [to,labels] : from->_edges) {
+                    for (const auto& [to,labels] : from->edges()) {
                         assert(!labels.contains(epsilon)); // PostStar algorithm assumes no epsilon transitions in the NFA.
                         for (const auto& [label,_] : labels) {
-                            insert_edge(from->_id, label, to, nullptr, from->_id >= _n_pda_states);
+                            insert_edge(from->_id, label, to, trace_handle(), from->_id >= _n_pda_states);
                         }
                     }
                 }
             }
-            void insert_edge(size_t from, uint32_t label, size_t to, const trace_t *trace, bool direct_to_rel = false) {
+            void insert_edge(size_t from, uint32_t label, size_t to, trace_handle trace, bool direct_to_rel = false) {
                 auto res = _edges.emplace(from, label, to);
                 if (res.second) { // New edge is not already in edges (rel U workset).
                     if (direct_to_rel) {
@@ -269,27 +583,45 @@ namespace pdaaal {
                             _rel2[to - _n_Q].push_back(from);
                         }
                     } else {
-                        _workset.emplace(from, label, to);
+                        _workset.push(temp_edge_t{from, label, to});
                     }
-                    if (trace != nullptr) { // Don't add existing edges
-                        if (label == epsilon) {
-                            _automaton.add_epsilon_edge(from, to, trace_ptr_from<W>(trace));
-                        } else {
-                            _automaton.add_edge(from, to, label, trace_ptr_from<W>(trace));
-                        }
+                    if (!trace.is_null() && (trace_info || ET)) { // Don't add existing edges
+                        add_automaton_edge(from, label, to, trace);
                     }
                     if constexpr (ET) {
-                        _found = _found || _early_termination(from, label, to, trace_ptr_from<W>(trace));
+                        _found = _found || _early_termination(from, label, to, trace_info ? trace_ptr_from<W>(trace) : default_trace_ptr<W>());
                     }
                 }
             };
+            // Without trace_info, the handle only tells whether the edge is new, so any non-null handle will do.
+            template <typename... Args>
+            trace_handle new_trace(Args... args) {
+                if constexpr (trace_info) {
+                    return _automaton.new_post_trace(args...);
+                } else {
+                    return trace_handle(uint32_t{0});
+                }
+            }
+            void add_automaton_edge(size_t from, uint32_t label, size_t to, trace_handle trace) {
+                if constexpr (trace_info) {
+                    if (label == epsilon) {
+                        _automaton.add_epsilon_edge(from, to, trace_ptr_from<W>(trace));
+                    } else {
+                        _automaton.add_edge(from, to, label, trace_ptr_from<W>(trace));
+                    }
+                } else {
+                    if (label == epsilon) {
+                        _automaton.add_epsilon_edge(from, to);
+                    } else {
+                        _automaton.add_edge(from, to, label);
+                    }
+                }
+            }
 
         public:
             void step() {
                 // pop t = (q, y, q') from workset (line 6)
-                temp_edge_t t;
-                t = _workset.front();
-                _workset.pop();
+                temp_edge_t t = _workset.pop();
                 // rel = rel U {t} (line 8)   (membership test on line 7 is done in insert_edge).
                 _rel1[t._from].emplace_back(t._to, t._label);
                 if (t._label == epsilon && t._to >= _n_Q) {
@@ -299,10 +631,9 @@ namespace pdaaal {
                 // if y != epsilon (line 9)
                 if (t._label != epsilon) {
                     const auto &rules = _pda_states[t._from]._rules;
-                    for (size_t rule_id = 0; rule_id < rules.size(); ++rule_id) {
-                        const auto &[rule,labels] = rules[rule_id];
-                        if (!labels.contains(t._label)) { continue; }
-                        auto trace = _automaton.new_post_trace(t._from, rule_id, t._label);
+                    _rule_index.for_each_post_rule(t._from, t._label, [&](size_t rule_id) {
+                        const auto &rule = rules[rule_id].first;
+                        auto trace = new_trace(t._from, rule_id, t._label);
                         switch (rule._operation) {
                             case POP: // (line 10-11)
                                 insert_edge(rule._to, epsilon, t._to, trace, false);
@@ -319,17 +650,17 @@ namespace pdaaal {
                                 insert_edge(rule._to, rule._op_label, q_new, trace, false); // (line 15)
                                 insert_edge(q_new, t._label, t._to, trace, true); // (line 16)
                                 if (!_rel2[q_new - _n_Q].empty()) {
-                                    auto trace_q_new = _automaton.new_post_trace(q_new);
+                                    auto trace_q_new = new_trace(q_new);
                                     for (auto f : _rel2[q_new - _n_Q]) { // (line 17)
                                         insert_edge(f, t._label, t._to, trace_q_new, false); // (line 18)
                                     }
                                 }
                                 break;
                         }
-                    }
+                    });
                 } else {
                     if (!_rel1[t._to].empty()) {
-                        auto trace = _automaton.new_post_trace(t._to);
+                        auto trace = new_trace(t._to);
                         for (auto e : _rel1[t._to]) { // (line 20)
                             insert_edge(t._from, e.second, e.first, trace, false); // (line 21)
                         }
@@ -339,32 +670,347 @@ namespace pdaaal {
             [[nodiscard]] bool workset_empty() const {
                 return _workset.empty();
             }
+            [[nodiscard]] size_t workset_size() const {
+                return _workset.size();
+            }
+            // Number of edges found so far (rel U workset).
+            [[nodiscard]] size_t number_of_edges() const {
+                return _edges.size();
+            }
             [[nodiscard]] bool found() const {
                 return _found;
             }
+            // Approximate number of bytes used by the edge set and trace information.
+            [[nodiscard]] size_t memory_usage() const {
+                return _edges.memory_usage() + _automaton.trace_memory_usage();
+            }
+
+            // Write the saturated relation into the PAutomaton. Without trace_info, only the edges are added, there is no trace information.
+            void materialize() {
+                assert(workset_empty());
+                if constexpr (!trace_info && !ET) {
+                    if (_materialized) return;
+                    for (size_t from = 0; from < _rel1.size(); ++from) {
+                        for (const auto& [to, label] : _rel1[from]) {
+                            add_automaton_edge(from, label, to, trace_handle()); // Existing edges are not changed by this.
+                        }
+                    }
+                    _materialized = true;
+                }
+            }
+
+            // Check acceptance directly on the solver-side relation, i.e. without materializing the PAutomaton.
+            [[nodiscard]] bool accepts(size_t state, const std::vector<uint32_t> &stack) const {
+                assert(workset_empty());
+                if (stack.empty()) {
+                    return _automaton.states()[state]->_accepting;
+                }
+                // DFS search. Epsilon edges only go from PDA states to other states, so the search terminates.
+                std::stack<std::pair<size_t, size_t>> search_stack;
+                search_stack.emplace(state, 0);
+                while (!search_stack.empty()) {
+                    auto [current_state, stack_index] = search_stack.top();
+                    search_stack.pop();
+                    for (const auto& [to, label] : _rel1[current_state]) {
+                        if (label == epsilon) {
+                            search_stack.emplace(to, stack_index);
+                        } else if (label == stack[stack_index]) {
+                            if (stack_index + 1 < stack.size()) {
+                                search_stack.emplace(to, stack_index + 1);
+                            } else if (_automaton.states()[to]->_accepting) {
+                                return true;
+                            }
+                        }
+                    }
+                }
+                return false;
+            }
         };
+        template <typename W, bool ET=false, typename EdgeSet = packed_edge_set, typename state_id_t = uint32_t,
+                  typename Workset = fifo_workset<basic_temp_edge_t<state_id_t>>>
+        using PostStarNoTraceSaturation = PostStarSaturation<W, ET, EdgeSet, state_id_t, Workset, false>;
+
+        // Multi-threaded version of PostStarSaturation. Gives the same saturated automaton (with valid, but possibly different, traces).
+        // The mid-states Q' are added in initialize() before any workers start, so the state space is fixed during saturation.
+        //  - Edges are partitioned by source state: An edge (p, y, q) is queued for worker p % n_workers,
+        //    and idle workers steal from the other queues, or sleep if there is nothing to steal.
+        //  - The edge relation (used to deduplicate edges) is sharded by source state, each shard with its own lock.
+        //  - _rel1[q] and _rel2[q] are append-only, and appending is protected by a striped lock on q. Adding to one of them and reading
+        //    the size of the other happens in the same critical section, so each (epsilon edge, edge from mid-state) pair is combined
+        //    by at least one worker. The elements up to that size are then read without the lock.
+        //  - With early termination, adding edges (and traces) to the automaton and calling early_termination is done under one lock,
+        //    since neither PAutomaton nor the product construction (used by early termination) is thread-safe.
+        //    The lock can be given by the caller, so it is shared with the pre* saturation in parallel dual*.
+        //    Without early termination, each worker collects its new edges, and they are added to the automaton when the workers are done.
+        template <typename W, bool ET=false, typename EdgeSet = packed_edge_set, typename state_id_t = uint32_t>
+        class ParallelPostStarSaturation {
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
+            static constexpr size_t shards_per_worker = 16;
+            struct shard_t {
+                std::mutex _mutex;
+                EdgeSet _edges;
+            };
+            struct alignas(64) memory_counter_t { // Separate cache lines to avoid false sharing between workers.
+                std::atomic<size_t> _bytes{0};
+            };
+        public:
+            ParallelPostStarSaturation(PAutomaton<W> &automaton, size_t n_workers, const early_termination_fn<W>& early_termination = [](size_t f, uint32_t l, size_t t, trace_ptr<W> trace) -> bool { return false; },
+                                       std::mutex* automaton_mutex = nullptr)
+                    : _automaton(automaton), _early_termination(early_termination), _pda_states(_automaton.pda().states()),
+                      _rule_index(_automaton.pda().rule_index()), // Build the rule index before starting workers.
+                      _n_pda_states(_pda_states.size()), _n_Q(_automaton.states().size()),
+                      _shards(std::max<size_t>(n_workers, 1) * shards_per_worker), _state_locks(std::max<size_t>(n_workers, 1) * shards_per_worker),
+                      _workset(std::max<size_t>(n_workers, 1)), _new_edges(_workset.workers()), _memory(_workset.workers()),
+                      _automaton_mutex(automaton_mutex != nullptr ? *automaton_mutex : _own_automaton_mutex) {
+                initialize();
+            };
 
-        template<typename W, bool Enable, bool ET, typename = std::enable_if_t<Enable>>
+            // Runs the saturation to completion, or until early termination or the budget is exceeded.
+            void run(const budget& limits = budget()) {
+                if (_found) return;
+                run_workers(_workset.workers(), [this,&limits](size_t worker){ work(worker, limits); });
+                add_new_edges();
+            }
+            [[nodiscard]] bool found() const {
+                return _found;
+            }
+            // Makes the workers (of a current or later call to run) stop after their current step. Can be called from any thread.
+            void stop() {
+                _workset.close();
+            }
+
+        private:
+            PAutomaton<W>& _automaton;
+            const early_termination_fn<W>& _early_termination;
+            const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
+            const size_t _n_pda_states;
+            const size_t _n_Q;
+            std::unordered_map<std::pair<size_t, uint32_t>, size_t, absl::Hash<std::pair<size_t, uint32_t>>> _q_prime{}; // Read-only after initialize().
+
+            size_t _n_automaton_states{};
+            std::vector<shard_t> _shards;
+            std::vector<std::mutex> _state_locks;
+            std::vector<append_only_vector<std::pair<state_id_t,uint32_t>>> _rel1; // faster access for lookup _from -> (_to, _label)
+            std::vector<append_only_vector<state_id_t>> _rel2; // faster access for lookup _to -> _from  (when _label is uint32_t::max)
+            work_stealing_queues<temp_edge_t> _workset;
+            std::vector<std::vector<std::tuple<state_id_t,uint32_t,state_id_t,trace_t>>> _new_edges; // Per worker, only used without ET.
+            std::vector<memory_counter_t> _memory; // Bytes added by each worker (approximately), only written by that worker.
+            size_t _initial_memory = 0;
+            std::mutex _own_automaton_mutex;
+            std::mutex& _automaton_mutex; // Shared with the saturation in the other direction in parallel dual*.
+            std::atomic<bool> _found{false};
+
+            // Called by all workers, so it sums the per-worker counters instead of locking the shards and the automaton.
+            [[nodiscard]] size_t memory_usage() const {
+                size_t bytes = _initial_memory;
+                for (const auto& counter : _memory) {
+                    bytes += counter._bytes.load(std::memory_order_relaxed);
+                }
+                return bytes;
+            }
+            void count_memory(size_t worker, size_t bytes) {
+                _memory[worker]._bytes.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            void initialize_memory() {
+                _initial_memory = _automaton.trace_memory_usage();
+                for (const auto& shard : _shards) {
+                    _initial_memory += shard._edges.memory_usage();
+                }
+            }
+
+            void initialize() {
+                _automaton.thaw();
+                // Q' U= {q_p'y1} for each <p, y> -> <p', y1 y2>  (line 3-4)
+                for (auto &state : _pda_states) {
+                    for (auto &[rule, labels] : state._rules) {
+                        if (rule._operation == PUSH) {
+                            auto res = _q_prime.emplace(std::make_pair(rule._to, rule._op_label), _automaton.next_state_id());
+                            if (res.second) {
+                                _automaton.add_state(false, false);
+                            }
+                        }
+                    }
+                }
+                _n_automaton_states = _automaton.states().size();
+                check_state_ids<state_id_t>(_n_automaton_states);
+                for (auto& shard : _shards) {
+                    shard._edges = EdgeSet(_n_automaton_states, _automaton.number_of_labels());
+                }
+                initialize_memory();
+                _rel1 = std::vector<append_only_vector<std::pair<state_id_t,uint32_t>>>(_n_automaton_states);
+                _rel2 = std::vector<append_only_vector<state_id_t>>(_n_automaton_states - _n_Q);
+
+                // workset := ->_0 intersect (P x Gamma x Q), rel := ->_0 \ workset  (line 1-2)
+                for (const auto& from : _automaton.states()) {
+                    for (const auto& [to,labels] : from->edges()) {
+                        assert(!labels.contains(epsilon)); // PostStar algorithm assumes no epsilon transitions in the NFA.
+                        for (const auto& [label,_] : labels) {
+                            bool direct_to_rel = from->_id >= _n_pda_states;
+                            if (insert_edge(0, from->_id, label, to, trace_t(), direct_to_rel) && direct_to_rel) {
+                                _rel1[from->_id].emplace_back(to, label);
+                            }
+                        }
+                    }
+                }
+            }
+
+            void work(size_t worker, const budget& limits) {
+                temp_edge_t t;
+                size_t steps = 0;
+                while (_workset.pop(worker, t)) {
+                    if (++steps == budget::check_interval) { // Count steps in batches to avoid contention on the budget.
+                        steps = 0;
+                        if (!limits.allow_steps(budget::check_interval, [this](){ return memory_usage(); })) {
+                            stop();
+                            _workset.finish();
+                            break;
+                        }
+                    }
+                    step(worker, t);
+                    _workset.finish();
+                }
+            }
+
+            // A null trace means that the edge is already in the automaton.
+            // Returns true if the edge is new. If direct_to_rel, the caller must add it to _rel1 instead of it being queued.
+            bool insert_edge(size_t worker, size_t from, uint32_t label, size_t to, const trace_t& trace, bool direct_to_rel = false) {
+                {
+                    auto& shard = _shards[from % _shards.size()];
+                    std::lock_guard lock(shard._mutex);
+                    auto edges_bytes = shard._edges.memory_usage();
+                    if (!shard._edges.emplace(from, label, to).second) return false;
+                    count_memory(worker, shard._edges.memory_usage() - edges_bytes);
+                }
+                if constexpr (ET) {
+                    std::lock_guard lock(_automaton_mutex);
+                    trace_handle trace_ptr;
+                    if (!trace.is_null()) {
+                        auto trace_bytes = _automaton.trace_memory_usage();
+                        trace_ptr = add_automaton_edge(from, label, to, trace);
+                        count_memory(worker, _automaton.trace_memory_usage() - trace_bytes);
+                    }
+                    if (!_found && _early_termination(from, label, to, trace_ptr_from<W>(trace_ptr))) {
+                        _found = true;
+                        _workset.close();
+                    }
+                } else if (!trace.is_null()) {
+                    _new_edges[worker].emplace_back(from, label, to, trace);
+                    count_memory(worker, sizeof(typename decltype(_new_edges)::value_type::value_type));
+                }
+                if (!direct_to_rel) { // Queue the edge after it is recorded, since edges derived from it may refer to it in their traces.
+                    _workset.push(from % _workset.workers(), temp_edge_t{from, label, to});
+                }
+                return true;
+            }
+            trace_handle add_automaton_edge(size_t from, uint32_t label, size_t to, const trace_t& trace) {
+                auto trace_ptr = _automaton.new_trace(trace);
+                if (label == epsilon) {
+                    _automaton.add_epsilon_edge(from, to, trace_ptr_from<W>(trace_ptr));
+                } else {
+                    _automaton.add_edge(from, to, label, trace_ptr_from<W>(trace_ptr));
+                }
+                return trace_ptr;
+            }
+            // Called when the workers are done.
+            void add_new_edges() {
+                for (auto& edges : _new_edges) {
+                    for (const auto& [from, label, to, trace] : edges) {
+                        add_automaton_edge(from, label, to, trace);
+                    }
+                    edges = {};
+                }
+            }
+            std::mutex& state_lock(size_t state) {
+                return _state_locks[state % _state_locks.size()];
+            }
+
+            void step(size_t worker, const temp_edge_t& t) {
+                // rel = rel U {t} (line 8)
+                {
+                    std::lock_guard lock(state_lock(t._from));
+                    _rel1[t._from].emplace_back(t._to, t._label);
+                }
+                size_t n_rel1_to = 0;
+                if (t._label == epsilon) {
+                    std::lock_guard lock(state_lock(t._to));
+                    if (t._to >= _n_Q) {
+                        _rel2[t._to - _n_Q].emplace_back(t._from);
+                    }
+                    n_rel1_to = _rel1[t._to].size();
+                }
+
+                // if y != epsilon (line 9)
+                if (t._label != epsilon) {
+                    const auto &rules = _pda_states[t._from]._rules;
+                    _rule_index.for_each_post_rule(t._from, t._label, [&](size_t rule_id) {
+                        const auto &rule = rules[rule_id].first;
+                        trace_t trace(t._from, rule_id, t._label);
+                        switch (rule._operation) {
+                            case POP: // (line 10-11)
+                                insert_edge(worker, rule._to, epsilon, t._to, trace);
+                                break;
+                            case SWAP: // (line 12-13)
+                                insert_edge(worker, rule._to, rule._op_label, t._to, trace);
+                                break;
+                            case NOOP:
+                                insert_edge(worker, rule._to, t._label, t._to, trace);
+                                break;
+                            case PUSH: { // (line 14)
+                                auto it = _q_prime.find(std::make_pair(rule._to, rule._op_label));
+                                assert(it != std::end(_q_prime));
+                                size_t q_new = it->second;
+                                insert_edge(worker, rule._to, rule._op_label, q_new, trace); // (line 15)
+                                if (insert_edge(worker, q_new, t._label, t._to, trace, true)) { // (line 16)
+                                    size_t n_rel2;
+                                    {
+                                        std::lock_guard lock(state_lock(q_new));
+                                        _rel1[q_new].emplace_back(t._to, t._label);
+                                        n_rel2 = _rel2[q_new - _n_Q].size();
+                                    }
+                                    _rel2[q_new - _n_Q].for_each(n_rel2, [&](auto f) { // (line 17)
+                                        insert_edge(worker, f, t._label, t._to, trace_t(q_new)); // (line 18)
+                                    });
+                                }
+                                break;
+                            }
+                        }
+                    });
+                } else {
+                    _rel1[t._to].for_each(n_rel1_to, [&](const auto& e) { // (line 20)
+                        insert_edge(worker, t._from, e.second, e.first, trace_t(t._to)); // (line 21)
+                    });
+                }
+            }
+        };
+
+        // Edges from mid-states (q_p'y1 -y2-> q) are kept in _rel3 and normally added to the automaton (and given to early termination) in finalize().
+        // With eager_mid_states, they are added when found, and their weight in the automaton is lowered when a lighter one is found.
+        // Then the automaton has every configuration whose weight is below last_weight(), which dual* needs to stop before either side is saturated.
+        // Single direction post* does not use this, since early termination on a mid-state edge could report a path before a lighter one is settled.
+        template<typename W, bool Enable, bool ET, bool eager_mid_states = false, template<typename> class EdgeMap = packed_edge_map, typename state_id_t = uint32_t,
+                 typename = std::enable_if_t<Enable>>
         class PostStarShortestSaturation {
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
             static_assert(W::is_weight);
-            using solver_weight = min_weight<typename W::type>;
+            using solver_weight = pdaaal::solver_weight<W,Trace_Type::Shortest>;
 
-            struct weight_edge_trace {
+            static constexpr uint32_t no_workset_id = std::numeric_limits<uint32_t>::max();
+            struct edge_weights_t {
                 typename W::type _weight;
-                temp_edge_t _edge;
-                const trace_t* _trace = nullptr;
-                weight_edge_trace(typename W::type weight, temp_edge_t edge, const trace_t* trace) : _weight(weight), _edge(edge), _trace(trace) {};
-                weight_edge_trace() = default;
+                typename W::type _workset_weight; // Smallest weight with which the edge was added to the workset.
+                uint32_t _workset_id = no_workset_id; // Id of the edge in the workset queue.
+                edge_weights_t() = default;
+                edge_weights_t(typename W::type weight, typename W::type workset_weight) : _weight(weight), _workset_weight(workset_weight) {};
             };
-            struct weight_edge_trace_comp{
-                bool operator()(const weight_edge_trace &lhs, const weight_edge_trace &rhs){
-                    return solver_weight::less(rhs._weight, lhs._weight); // Used in a max-heap, so swap arguments to make it a min-heap.
-                }
+            struct workset_entry {
+                temp_edge_t _edge;
+                trace_handle _trace;
             };
             struct rel3_elem {
                 uint32_t _label;
-                size_t _to;
-                const trace_t *_trace;
+                state_id_t _to;
+                trace_handle _trace;
                 typename W::type _weight;
 
                 bool operator<(const rel3_elem &other) const {
@@ -382,7 +1028,8 @@ namespace pdaaal {
         public:
             PostStarShortestSaturation(PAutomaton<W> &automaton, const early_termination_fn<W>& early_termination)
             : _automaton(automaton), _early_termination(early_termination), _pda_states(_automaton.pda().states()),
-              _n_pda_states(_pda_states.size()), _n_Q(_automaton.states().size()) {
+              _rule_index(_automaton.pda().rule_index()), _n_pda_states(_pda_states.size()), _n_Q(_automaton.states().size()) {
+                _automaton.thaw();
                 assert(!has_negative_weight());
                 if (has_negative_weight()) {
                     throw std::runtime_error("Priority-queue based shortest trace post* algorithm does not work with negative weights.");
@@ -394,6 +1041,7 @@ namespace pdaaal {
             PAutomaton<W>& _automaton;
             const early_termination_fn<W>& _early_termination;
             const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
             const size_t _n_pda_states;
             const size_t _n_Q;
             std::unordered_map<std::pair<size_t, uint32_t>, size_t, absl::Hash<std::pair<size_t, uint32_t>>> _q_prime{};
@@ -401,11 +1049,14 @@ namespace pdaaal {
             size_t _n_automaton_states{};
             std::vector<typename W::type> _minpath;
 
-            std::unordered_map<temp_edge_t, std::pair<typename W::type, typename W::type>, absl::Hash<temp_edge_t>> _edge_weights;
-            std::priority_queue<weight_edge_trace, std::vector<weight_edge_trace>, weight_edge_trace_comp> _workset;
-            std::vector<std::vector<std::pair<size_t,uint32_t>>> _rel1; // faster access for lookup _from -> (_to, _label)
-            std::vector<std::vector<size_t>> _rel2; // faster access for lookup _to -> _from  (when _label is uint32_t::max)
+            EdgeMap<edge_weights_t> _edge_weights;
+            // The workset is a priority queue with decrease-key over edges. The edges get an id when they are first added.
+            shortest_queue<W> _workset;
+            std::vector<workset_entry> _workset_entries;
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _rel1; // faster access for lookup _from -> (_to, _label)
+            std::vector<std::vector<state_id_t>> _rel2; // faster access for lookup _to -> _from  (when _label is uint32_t::max)
             std::vector<std::vector<rel3_elem>> _rel3;
+            typename W::type _last_weight = W::zero();
 
             bool _found = false;
 
@@ -419,7 +1070,7 @@ namespace pdaaal {
                         }
                     }
                     for (const auto& from : _automaton.states()) {
-                        for (const auto& [to,labels] : from->_edges) {
+                        for (const auto& [to,labels] : from->edges()) {
                             for (const auto& [label,trace] : labels) {
                                 if (solver_weight::less(trace.second, W::zero())) {
                                     return true;
@@ -432,6 +1083,7 @@ namespace pdaaal {
             }
 
             void initialize() {
+                _automaton.thaw();
                 // for <p, y> -> <p', y1 y2> do
                 //   Q' U= {q_p'y1}
                 for (const auto &state : _pda_states) {
@@ -445,6 +1097,8 @@ namespace pdaaal {
                     }
                 }
                 _n_automaton_states = _automaton.states().size();
+                check_state_ids<state_id_t>(_n_automaton_states);
+                _edge_weights = EdgeMap<edge_weights_t>(_n_automaton_states, _automaton.number_of_labels());
                 _minpath.resize(_n_automaton_states - _n_Q);
                 for (size_t i = 0; i < _minpath.size(); ++i) {
                     _minpath[i] = solver_weight::max();
@@ -457,13 +1111,13 @@ namespace pdaaal {
                 // workset := ->_0 intersect (P x Gamma x Q)
                 // rel := ->_0 \ workset
                 for (const auto& from : _automaton.states()) {
-                    for (const auto& [to,labels] : from->_edges) {
+                    for (const auto& [to,labels] : from->edges()) {
                         assert(!labels.contains(epsilon)); // PostStar algorithm assumes no epsilon transitions in the NFA.
                         for (const auto& [label,trace] : labels) {
                             temp_edge_t temp_edge{from->_id, label, to};
-                            _edge_weights.emplace(temp_edge, std::make_pair(W::zero(), W::zero()));
+                            _edge_weights.emplace(from->_id, label, to, edge_weights_t(W::zero(), W::zero()));
                             if (from->_id < _n_pda_states) {
-                                _workset.emplace(W::zero(), temp_edge, nullptr);
+                                push_workset(W::zero(), temp_edge, trace_handle());
                             } else {
                                 insert_rel(from->_id, label, to);
                                 if constexpr (ET) {
@@ -476,29 +1130,41 @@ namespace pdaaal {
             }
 
             std::pair<bool,bool> update_edge_(size_t from, uint32_t label, size_t to, typename W::type edge_weight, typename W::type workset_weight) {
-                auto res = _edge_weights.emplace(temp_edge_t{from, label, to}, std::make_pair(edge_weight, workset_weight));
+                auto res = _edge_weights.emplace(from, label, to, edge_weights_t(edge_weight, workset_weight));
                 if (!res.second) {
                     auto result = std::make_pair(false, false);
-                    if (solver_weight::less(edge_weight, (*res.first).second.first)) {
-                        (*res.first).second.first = edge_weight;
+                    if (solver_weight::less(edge_weight, res.first->_weight)) {
+                        res.first->_weight = edge_weight;
                         result.first = true;
                     }
-                    if (solver_weight::less(workset_weight, (*res.first).second.second)) {
-                        (*res.first).second.second = workset_weight;
+                    if (solver_weight::less(workset_weight, res.first->_workset_weight)) {
+                        res.first->_workset_weight = workset_weight;
                         result.second = true;
                     }
                     return result;
                 }
                 return std::make_pair(res.second, res.second);
             }
-            void update_edge(size_t from, uint32_t label, size_t to, typename W::type edge_weight, const trace_t* trace) {
+            void update_edge(size_t from, uint32_t label, size_t to, typename W::type edge_weight, trace_handle trace) {
                 auto workset_weight = to < _n_Q ? edge_weight : solver_weight::add(_minpath[to - _n_Q], edge_weight);
                 if (update_edge_(from, label, to, edge_weight, workset_weight).second) {
-                    _workset.emplace(workset_weight, temp_edge_t{from, label, to}, trace);
+                    push_workset(workset_weight, temp_edge_t{from, label, to}, trace);
+                }
+            }
+            // Adds the edge to the workset, or lowers its weight in the workset.
+            void push_workset(typename W::type weight, temp_edge_t edge, trace_handle trace) {
+                auto& id = _edge_weights.find(edge._from, edge._label, edge._to)->_workset_id;
+                if (id == no_workset_id) {
+                    assert(_workset_entries.size() < no_workset_id);
+                    id = static_cast<uint32_t>(_workset_entries.size());
+                    _workset_entries.push_back(workset_entry{edge, trace});
+                    _workset.push(id, weight);
+                } else if (_workset.push(id, weight)) {
+                    _workset_entries[id]._trace = trace;
                 }
             }
             typename W::type get_weight(size_t from, uint32_t label, size_t to) const {
-                return (*_edge_weights.find(temp_edge_t{from, label, to})).second.first;
+                return _edge_weights.find(from, label, to)->_weight;
             }
             void insert_rel(size_t from, uint32_t label, size_t to) { // Adds to rel.
                 _rel1[from].emplace_back(to, label);
@@ -510,14 +1176,16 @@ namespace pdaaal {
         public:
             void step() {
                 // pop t = (q, y, q') from workset
-                auto elem = _workset.top();
-                _workset.pop();
+                auto popped = _workset.pop();
+                auto workset_weight = popped.second;
+                _last_weight = workset_weight;
+                auto elem = _workset_entries[popped.first];
                 auto t = elem._edge;
-                auto weights = (*_edge_weights.find(t)).second;
-                if (solver_weight::less(weights.second, elem._weight)) {
+                const auto& weights = *_edge_weights.find(t._from, t._label, t._to);
+                if (solver_weight::less(weights._workset_weight, workset_weight)) {
                     return; // Same edge with a smaller weight was already processed.
                 }
-                auto t_weight = weights.first;
+                auto t_weight = weights._weight;
 
                 // rel = rel U {t}
                 insert_rel(t._from, t._label, t._to);
@@ -533,11 +1201,10 @@ namespace pdaaal {
                 // if y != epsilon
                 if (t._label != epsilon) {
                     const auto &rules = _pda_states[t._from]._rules;
-                    for (size_t rule_id = 0; rule_id < rules.size(); ++rule_id) {
-                        const auto &[rule,labels] = rules[rule_id];
-                        if (!labels.contains(t._label)) { continue; }
+                    _rule_index.for_each_post_rule(t._from, t._label, [&](size_t rule_id) {
+                        const auto &rule = rules[rule_id].first;
                         auto trace = _automaton.new_post_trace(t._from, rule_id, t._label);
-                        auto wd = solver_weight::add(elem._weight, rule._weight);
+                        auto wd = solver_weight::add(workset_weight, rule._weight);
                         auto wb = solver_weight::add(t_weight, rule._weight);
                         if (rule._operation != PUSH) {
                             uint32_t label = 0;
@@ -567,14 +1234,23 @@ namespace pdaaal {
                                 auto lb = std::lower_bound(relq.begin(), relq.end(), new_elem);
                                 if (lb == std::end(relq) || *lb != new_elem) {
                                     relq.insert(lb, new_elem);
+                                    if constexpr (eager_mid_states) {
+                                        _automaton.add_edge(q_new, t._to, t._label, std::make_pair(trace, wb));
+                                        if constexpr (ET) {
+                                            _found |= _early_termination(q_new, t._label, t._to, std::make_pair(trace, wb));
+                                        }
+                                    }
                                 } else if (solver_weight::less(wb, lb->_weight)) {
                                     *lb = new_elem;
+                                    if constexpr (eager_mid_states) {
+                                        _automaton.update_edge(q_new, t._to, t._label, std::make_pair(trace, wb));
+                                    }
                                 }
                             }
                             if (solver_weight::less(wd, _minpath[q_new - _n_Q])) {
                                 _minpath[q_new - _n_Q] = wd;
                                 if (add_to_workset) {
-                                    _workset.emplace(wd, temp_edge_t{rule._to, rule._op_label, q_new}, trace);
+                                    push_workset(wd, temp_edge_t{rule._to, rule._op_label, q_new}, trace);
                                 }
                             } else if (was_updated) {
                                 if (!_rel2[q_new - _n_Q].empty()) {
@@ -585,7 +1261,7 @@ namespace pdaaal {
                                 }
                             }
                         }
-                    }
+                    });
                 } else {
                     if (t._to < _n_Q) {
                         if (!_rel1[t._to].empty()) {
@@ -606,6 +1282,7 @@ namespace pdaaal {
                 }
             }
             void finalize() {
+                if constexpr (eager_mid_states) return; // Already in the automaton.
                 for (size_t i = _n_Q; i < _n_automaton_states; ++i) {
                     for (auto &e : _rel3[i - _n_Q]) {
                         assert(e._label != epsilon);
@@ -616,170 +1293,536 @@ namespace pdaaal {
                     }
                 }
             }
-            [[nodiscard]] bool workset_empty() const {
-                return _workset.empty();
+            [[nodiscard]] bool workset_empty() const {
+                return _workset.empty();
+            }
+            [[nodiscard]] size_t workset_size() const {
+                return _workset.size();
+            }
+            // Number of edges found so far (settled or in the workset).
+            [[nodiscard]] size_t number_of_edges() const {
+                return _edge_weights.size();
+            }
+            // Workset weight of the last popped edge. The edges left in the workset have at least this weight.
+            // For an edge to a mid-state, this is the edge weight plus the smallest weight of a continuation from the mid-state (_minpath),
+            // i.e. the weight of the lightest configuration that uses the edge.
+            [[nodiscard]] const typename W::type& last_weight() const {
+                return _last_weight;
+            }
+            [[nodiscard]] bool found() const {
+                return _found;
+            }
+            // Approximate number of bytes used by the edge set and trace information.
+            [[nodiscard]] size_t memory_usage() const {
+                return _edge_weights.memory_usage() + _automaton.trace_memory_usage();
+            }
+        };
+
+        // Weighted pre* for shortest traces: The Dijkstra-ordered counterpart of PostStarShortestSaturation.
+        // Each edge keeps the smallest weight found so far, and edges are settled (added to rel and to the automaton) in weight order,
+        // so an edge is added with its final weight and the trace of a minimal derivation. This requires non-negative weights.
+        // Wildcard pre-labels of rules are expanded to all labels (as in PreStarFixedPointSaturation), since an edge has a single weight.
+        template<typename W, bool ET, template<typename> class EdgeMap = packed_edge_map, typename state_id_t = uint32_t>
+        class PreStarShortestSaturation {
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
+            static_assert(W::is_weight);
+            using weight_t = typename W::type;
+            using solver_weight = pdaaal::solver_weight<W,Trace_Type::Shortest>;
+
+            static constexpr uint32_t no_workset_id = std::numeric_limits<uint32_t>::max();
+            struct edge_weights_t {
+                weight_t _weight;
+                uint32_t _workset_id = no_workset_id; // Id of the edge in the workset queue.
+                bool _settled = false;
+                edge_weights_t() = default;
+                explicit edge_weights_t(weight_t weight) : _weight(weight) {};
+            };
+            struct workset_entry {
+                temp_edge_t _edge;
+                trace_handle _trace;
+            };
+            struct delta_prime_elem {
+                state_id_t _state;
+                uint32_t _rule_id;
+                weight_t _weight; // Weight of the rule plus the weight of the (settled) edge of its first pushed label.
+            };
+
+        public:
+            PreStarShortestSaturation(PAutomaton<W> &automaton, const early_termination_fn<W>& early_termination)
+            : _automaton(automaton), _early_termination(early_termination), _pda_states(_automaton.pda().states()),
+              _rule_index(_automaton.pda().rule_index()), _n_pda_states(_pda_states.size()),
+              _n_automaton_states(_automaton.states().size()), _n_pda_labels(_automaton.number_of_labels()),
+              _edge_weights(_n_automaton_states, _n_pda_labels), _rel(_n_automaton_states), _delta_prime(_n_automaton_states) {
+                assert(!has_negative_weight());
+                if (has_negative_weight()) {
+                    throw std::runtime_error("Priority-queue based shortest trace pre* algorithm does not work with negative weights.");
+                }
+                initialize();
+            };
+
+        private:
+            PAutomaton<W>& _automaton;
+            const early_termination_fn<W>& _early_termination;
+            const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
+            const size_t _n_pda_states;
+            const size_t _n_automaton_states;
+            const size_t _n_pda_labels;
+
+            EdgeMap<edge_weights_t> _edge_weights;
+            // The workset is a priority queue with decrease-key over edges. The edges get an id when they are first added.
+            shortest_queue<W> _workset;
+            std::vector<workset_entry> _workset_entries;
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _rel; // Settled edges, by _from.
+            std::vector<std::vector<delta_prime_elem>> _delta_prime;
+            weight_t _last_weight = W::zero();
+
+            bool _found = false;
+
+            bool has_negative_weight() const {
+                if constexpr (W::is_signed) {
+                    for (const auto& state : _pda_states) {
+                        for (const auto& [rule,labels] : state._rules) {
+                            if (solver_weight::less(rule._weight, W::zero())) {
+                                return true;
+                            }
+                        }
+                    }
+                }
+                return false;
+            }
+
+            void initialize() {
+                _automaton.thaw();
+                check_state_ids<state_id_t>(_n_automaton_states);
+                for (const auto& from : _automaton.states()) {
+                    for (const auto& [to,labels] : from->edges()) {
+                        for (const auto& [label,_] : labels) {
+                            update_edge(from->_id, label, to, W::zero(), trace_handle()); // Existing edges have a null trace, and are not added again.
+                        }
+                    }
+                }
+                // for all <p, y> --> <p', epsilon> : workset U= (p, y, p')
+                for (size_t state = 0; state < _n_pda_states; ++state) {
+                    size_t rule_id = 0;
+                    for (const auto& [rule,labels] : _pda_states[state]._rules) {
+                        if (rule._operation == POP) {
+                            update_edge_bulk(state, labels, rule._to, rule._weight, _automaton.new_pre_trace(rule_id));
+                        }
+                        ++rule_id;
+                    }
+                }
+            }
+
+            // Adds the edge to the workset, or lowers its weight in the workset. Settled edges already have their smallest weight.
+            void update_edge(size_t from, uint32_t label, size_t to, weight_t weight, trace_handle trace) {
+                auto [edge, fresh] = _edge_weights.emplace(from, label, to, edge_weights_t(weight));
+                if (fresh) {
+                    assert(_workset_entries.size() < no_workset_id);
+                    edge->_workset_id = static_cast<uint32_t>(_workset_entries.size());
+                    _workset_entries.push_back(workset_entry{temp_edge_t{from, label, to}, trace});
+                    _workset.push(edge->_workset_id, weight);
+                } else if (!edge->_settled && _workset.push(edge->_workset_id, weight)) {
+                    edge->_weight = weight;
+                    _workset_entries[edge->_workset_id]._trace = trace;
+                }
+            }
+            void update_edge_bulk(size_t from, const labels_t &precondition, size_t to, weight_t weight, trace_handle trace) {
+                if (precondition.wildcard()) {
+                    for (uint32_t i = 0; i < _n_pda_labels; i++) {
+                        update_edge(from, i, to, weight, trace);
+                    }
+                } else {
+                    for (auto &label : precondition.labels()) {
+                        update_edge(from, label, to, weight, trace);
+                    }
+                }
+            }
+            weight_t get_weight(size_t from, uint32_t label, size_t to) const {
+                return _edge_weights.find(from, label, to)->_weight;
+            }
+
+        public:
+            void step() {
+                // pop t = (q, y, q') with the smallest weight from workset
+                auto [id, w] = _workset.pop();
+                auto elem = _workset_entries[id];
+                auto t = elem._edge;
+                _last_weight = w;
+                _edge_weights.find(t._from, t._label, t._to)->_settled = true;
+
+                // rel = rel U {t}
+                _rel[t._from].emplace_back(t._to, t._label);
+                if (!elem._trace.is_null()) { // Don't add existing edges
+                    _automaton.add_edge(t._from, t._to, t._label, std::make_pair(elem._trace, w));
+                    if constexpr (ET) {
+                        _found = _found || _early_termination(t._from, t._label, t._to, std::make_pair(elem._trace, w));
+                    }
+                }
+
+                // Delta'
+                for (const auto& dp : _delta_prime[t._from]) {
+                    const auto& labels = _pda_states[dp._state]._rules[dp._rule_id].second;
+                    if (labels.contains(t._label)) {
+                        update_edge(dp._state, t._label, t._to, solver_weight::add(dp._weight, w), _automaton.new_pre_trace(dp._rule_id, t._from));
+                    }
+                }
+
+                if (t._from >= _n_pda_states) { return; }
+                for (const auto& entry : _rule_index.pre_rules(t._from, t._label)) {
+                    auto pre_state = entry._from;
+                    auto rule_id = entry._rule_id;
+                    const auto &[rule, labels] = _pda_states[pre_state]._rules[rule_id];
+                    assert(rule._to == t._from && rule._op_label == t._label);
+                    auto w_rule = solver_weight::add(rule._weight, w);
+                    switch (rule._operation) {
+                        case SWAP:
+                            update_edge_bulk(pre_state, labels, t._to, w_rule, _automaton.new_pre_trace(rule_id));
+                            break;
+                        case PUSH: {
+                            _delta_prime[t._to].push_back(delta_prime_elem{static_cast<state_id_t>(pre_state), static_cast<uint32_t>(rule_id), w_rule});
+                            trace_handle trace;
+                            for (const auto& [rel_to, rel_label] : _rel[t._to]) {
+                                if (labels.contains(rel_label)) {
+                                    trace = trace.is_null() ? _automaton.new_pre_trace(rule_id, t._to) : trace;
+                                    update_edge(pre_state, rel_label, rel_to, solver_weight::add(w_rule, get_weight(t._to, rel_label, rel_to)), trace);
+                                }
+                            }
+                            break;
+                        }
+                        default:
+                            assert(false);
+                    }
+                }
+                // NOOP rules
+                auto update_noop = [&](const details::rule_index::pre_entry_t& entry) {
+                    const auto& rule = _pda_states[entry._from]._rules[entry._rule_id].first;
+                    update_edge(entry._from, t._label, t._to, solver_weight::add(rule._weight, w), _automaton.new_pre_trace(entry._rule_id));
+                };
+                for (const auto& entry : _rule_index.pre_noop_rules(t._from, t._label)) {
+                    update_noop(entry);
+                }
+                for (const auto& entry : _rule_index.pre_noop_wildcard_rules(t._from)) {
+                    update_noop(entry);
+                }
+            }
+            [[nodiscard]] bool workset_empty() const {
+                return _workset.empty();
+            }
+            [[nodiscard]] size_t workset_size() const {
+                return _workset.size();
+            }
+            // Number of edges found so far (settled or in the workset).
+            [[nodiscard]] size_t number_of_edges() const {
+                return _edge_weights.size();
+            }
+            // Weight of the last settled edge. The edges left in the workset have at least this weight.
+            [[nodiscard]] const weight_t& last_weight() const {
+                return _last_weight;
+            }
+            [[nodiscard]] bool found() const {
+                return _found;
+            }
+            // Approximate number of bytes used by the edge map and trace information.
+            [[nodiscard]] size_t memory_usage() const {
+                return _edge_weights.memory_usage() + _workset_entries.capacity() * sizeof(workset_entry) + _automaton.trace_memory_usage();
+            }
+        };
+
+        // Common part of the fixed-point pre* and post* saturations, which allow negative weights (with Trace_Type::ShortestFixedPoint)
+        // and longest traces (with Trace_Type::Longest). The saturation first finds the edges of the saturated automaton without weights,
+        // together with the derivations of each edge (the weight of the rule, its trace and the edges it combines).
+        // Then scc_fixed_point solves the weights of the edges per SCC of the derivations, where unbounded weights become solver_weight::bottom()
+        // (infinite for Longest and -infinite for ShortestFixedPoint). Finally, the edges are added to the automaton with their weights
+        // and the trace of their best derivation.
+        template<typename Derived, typename W, bool indirect_trace_info, Trace_Type trace_type, typename state_id_t>
+        class FixedPointSaturation {
+        protected:
+            using temp_edge_t = basic_temp_edge_t<state_id_t>;
+            static_assert(is_weighted<W>);
+            using weight_t = typename W::type;
+            using solverW = solver_weight<W,trace_type>;
+            using fixed_point_t = scc_fixed_point<solverW, trace_<indirect_trace_info>>;
+            static constexpr uint32_t no_edge = fixed_point_t::no_node;
+
+            explicit FixedPointSaturation(PAutomaton<W,indirect_trace_info>& automaton) : _automaton(automaton) {
+                _automaton.thaw();
+            };
+
+            // The edges of the automaton are derived with weight zero and without trace.
+            void initialize_automaton_edges() {
+                for (const auto& from : _automaton.states()) {
+                    for (const auto& [to,labels] : from->edges()) {
+                        for (const auto& [label,tw] : labels) {
+                            assert(tw == std::make_pair(default_trace_<indirect_trace_info>(), W::zero()));
+                            add_derivation(from->_id, label, to, W::zero(), default_trace_<indirect_trace_info>());
+                        }
+                    }
+                }
+                _n_automaton_edges = _edges.size();
+            }
+            [[nodiscard]] bool has_edge(size_t from, uint32_t label, size_t to) const {
+                return _edge_ids.find(temp_edge_t{from, label, to}) != _edge_ids.end();
+            }
+            [[nodiscard]] uint32_t find_edge(size_t from, uint32_t label, size_t to) const {
+                assert(has_edge(from, label, to));
+                return _edge_ids.find(temp_edge_t{from, label, to})->second;
+            }
+            // Adds a derivation of the edge from the premises (ids of edges). The first derivation of an edge adds it to the workset.
+            void add_derivation(size_t from, uint32_t label, size_t to, const weight_t& weight, trace_<indirect_trace_info> trace,
+                                uint32_t premise1 = no_edge, uint32_t premise2 = no_edge) {
+                auto [it, fresh] = _edge_ids.emplace(temp_edge_t{from, label, to}, _fixed_point.size());
+                if (fresh) {
+                    _fixed_point.add_node();
+                    _edges.emplace_back(from, label, to);
+                    _workset.push_back(it->second);
+                }
+                _fixed_point.add_derivation(it->second, weight, trace, premise1, premise2);
+            }
+            [[nodiscard]] const temp_edge_t& edge(uint32_t id) const {
+                return _edges[id];
+            }
+
+            PAutomaton<W,indirect_trace_info>& _automaton;
+
+        public:
+            // Stops early (without changing the automaton) if the budget is exceeded.
+            void run(const budget& limits = budget()) {
+                while (!_workset.empty()) {
+                    if (!limits.allow_step([this](){ return memory_usage(); })) return;
+                    auto id = _workset.back();
+                    _workset.pop_back();
+                    static_cast<Derived*>(this)->step_with(id);
+                }
+                if (!_fixed_point.run(limits, [this](){ return memory_usage(); })) return;
+                for (uint32_t id = 0; id < _edges.size(); ++id) {
+                    assert(_fixed_point.reached(id)); // All edges found by the saturation have a derivation.
+                    const auto& e = _edges[id];
+                    auto trace_weight = std::make_pair(_fixed_point.payload(id), _fixed_point.weight(id));
+                    if (id < _n_automaton_edges) {
+                        _automaton.update_edge(e._from, e._to, e._label, trace_weight);
+                    } else if (e._label == epsilon) {
+                        _automaton.add_epsilon_edge(e._from, e._to, trace_weight);
+                    } else {
+                        _automaton.add_edge(e._from, e._to, e._label, trace_weight);
+                    }
+                }
+            }
+            [[nodiscard]] size_t number_of_edges() const {
+                return _edges.size();
             }
-            [[nodiscard]] bool found() const {
-                return _found;
+            // Approximate number of bytes used by the edges, derivations and trace information.
+            [[nodiscard]] size_t memory_usage() const {
+                return _edge_ids.bucket_count() * sizeof(void*) + _edge_ids.size() * (sizeof(std::pair<const temp_edge_t, uint32_t>) + sizeof(void*))
+                     + _edges.capacity() * sizeof(temp_edge_t) + _workset.capacity() * sizeof(uint32_t)
+                     + _fixed_point.memory_usage() + _automaton.trace_memory_usage();
             }
+
+        private:
+            std::unordered_map<temp_edge_t, uint32_t, absl::Hash<temp_edge_t>> _edge_ids;
+            std::vector<temp_edge_t> _edges; // By id.
+            std::vector<uint32_t> _workset;
+            size_t _n_automaton_edges = 0; // The edges with smaller ids were in the automaton before saturation.
+            fixed_point_t _fixed_point;
         };
 
-        template<typename W, bool indirect_trace_info, Trace_Type trace_type>
-        class PreStarFixedPointSaturation : public fixed_point_workset<PreStarFixedPointSaturation<W,indirect_trace_info,trace_type>, temp_edge_t> {
-            using parent_t = fixed_point_workset<PreStarFixedPointSaturation<W,indirect_trace_info,trace_type>, temp_edge_t>;
-            static_assert(is_weighted<W>);
-            using weight_t = typename W::type;
-            using solverW = solver_weight<W,trace_type>;
+        // Fixed-point pre*, see FixedPointSaturation. Wildcard pre-labels of rules are expanded to all labels, since an edge has a single weight.
+        template<typename W, bool indirect_trace_info, Trace_Type trace_type, typename state_id_t = uint32_t>
+        class PreStarFixedPointSaturation : public FixedPointSaturation<PreStarFixedPointSaturation<W,indirect_trace_info,trace_type,state_id_t>, W, indirect_trace_info, trace_type, state_id_t> {
+            using parent_t = FixedPointSaturation<PreStarFixedPointSaturation<W,indirect_trace_info,trace_type,state_id_t>, W, indirect_trace_info, trace_type, state_id_t>;
+            friend parent_t;
+            using typename parent_t::weight_t;
+            using parent_t::no_edge;
 
-            template<bool change_is_bottom = false>
-            void update_edge(size_t from, uint32_t label, size_t to, const weight_t& edge_weight, trace_<indirect_trace_info> trace) {
-                auto [it, fresh] = _edges.emplace(temp_edge_t{from, label, to}, edge_weight);
-                bool is_changed = false;
-                if (fresh) {
-                    if constexpr(change_is_bottom) {
-                        assert(false); // We should add all fresh edges during the first pass of rounds.
-                    }
-                    _rel[from].emplace_back(to, label); // Allow fast iteration over _edges matching specific from.
-                    if (!trace_is_null<indirect_trace_info>(trace)) {
-                        _automaton.add_edge(from, to, label, std::make_pair(trace, edge_weight));
-                    }
-                    is_changed = true;
-                } else {
-                    if (solverW::less(edge_weight, it->second)) {
-                        if constexpr(change_is_bottom) {
-                            it->second = solverW::bottom();
-                            _automaton.update_edge(from, to, label, std::make_pair(trace, solverW::bottom()));
-                        } else {
-                            it->second = edge_weight;
-                            _automaton.update_edge(from, to, label, std::make_pair(trace, edge_weight));
-                        }
-                        is_changed = true;
-                    }
-                }
-                if (is_changed) {
-                    parent_t::emplace(from, label, to);
-                }
-            }
-            template<bool change_is_bottom = false>
-            void update_edge_bulk(size_t from, const labels_t &precondition, size_t to, const weight_t& weight, trace_<indirect_trace_info> trace) {
+            void add_derivation_bulk(size_t from, const labels_t &precondition, size_t to, const weight_t& weight, trace_<indirect_trace_info> trace, uint32_t premise = no_edge) {
                 if (precondition.wildcard()) {
                     for (uint32_t i = 0; i < _n_pda_labels; i++) {
-                        update_edge<change_is_bottom>(from, i, to, weight, trace);
+                        parent_t::add_derivation(from, i, to, weight, trace, premise);
                     }
                 } else {
                     for (auto &label : precondition.labels()) {
-                        update_edge<change_is_bottom>(from, label, to, weight, trace);
+                        parent_t::add_derivation(from, label, to, weight, trace, premise);
                     }
                 }
             }
         public:
             explicit PreStarFixedPointSaturation(PAutomaton<W,indirect_trace_info>& automaton)
-            : parent_t(std::pow(automaton.states().size(), 2) * automaton.number_of_labels()),
-              _automaton(automaton), _pda_states(_automaton.pda().states()), _n_automaton_states(_automaton.states().size()),
-              _n_pda_states(_pda_states.size()), _n_pda_labels(_automaton.number_of_labels()),
-              _rel(_n_automaton_states), _delta_prime(_n_automaton_states) {
-                initialize();
-            };
-            PreStarFixedPointSaturation(PAutomaton<W,indirect_trace_info>& automaton, size_t round_limit)
-            : parent_t(round_limit),
-              _automaton(automaton), _pda_states(_automaton.pda().states()), _n_automaton_states(_automaton.states().size()),
-              _n_pda_states(_pda_states.size()), _n_pda_labels(_automaton.number_of_labels()),
+            : parent_t(automaton), _pda_states(automaton.pda().states()), _rule_index(automaton.pda().rule_index()),
+              _n_automaton_states(automaton.states().size()),
+              _n_pda_states(_pda_states.size()), _n_pda_labels(automaton.number_of_labels()),
               _rel(_n_automaton_states), _delta_prime(_n_automaton_states) {
                 initialize();
             };
-            static constexpr temp_edge_t next_round_elem = temp_edge_t();
         private:
-            PAutomaton<W,indirect_trace_info>& _automaton;
             const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
             const size_t _n_automaton_states;
             const size_t _n_pda_states;
             const size_t _n_pda_labels;
 
-            std::unordered_map<temp_edge_t, weight_t, absl::Hash<temp_edge_t>> _edges;
-            std::vector<std::vector<std::pair<size_t,uint32_t>>> _rel; // Fast access to _edges based on _from.
-            std::vector<std::vector<std::tuple<size_t, size_t>>> _delta_prime;
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _rel; // The edges taken from the workset, by _from.
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _delta_prime;
 
             void initialize() {
-                for (const auto& from : _automaton.states()) {
-                    for (const auto& [to,labels] : from->_edges) {
-                        for (const auto& [label,tw] : labels) {
-                            assert(tw == std::make_pair(default_trace_<indirect_trace_info>(), W::zero()));
-                            update_edge(from->_id, label, to, W::zero(), default_trace_<indirect_trace_info>());
-                        }
-                    }
-                }
+                check_state_ids<state_id_t>(_n_automaton_states);
+                parent_t::initialize_automaton_edges();
                 // for all <p, y> --> <p', epsilon> : workset U= (p, y, p') (line 2)
                 for (size_t state = 0; state < _n_pda_states; ++state) {
                     size_t rule_id = 0;
                     for (const auto& [rule,labels] : _pda_states[state]._rules) {
                         if (rule._operation == POP) {
-                            update_edge_bulk(state, labels, rule._to, rule._weight, _automaton.new_pre_trace(rule_id));
+                            add_derivation_bulk(state, labels, rule._to, rule._weight, this->_automaton.new_pre_trace(rule_id));
                         }
                         ++rule_id;
                     }
                 }
             }
 
-        public:
-            template<bool change_is_bottom = false>
-            bool step_with(temp_edge_t&& t) {
-                assert(_edges.find(t) != _edges.end());
-                auto w = _edges.find(t)->second;
+            // Each combination of two edges is derived once: By the edge taken last from the workset, since _rel and _delta_prime only contain edges taken before.
+            void step_with(uint32_t id) {
+                auto t = parent_t::edge(id);
 
                 // (line 7-8 for \Delta')
                 for (const auto& [state, rule_id] : _delta_prime[t._from]) { // Loop over delta_prime (that match with t->from)
                     const auto& [rule, labels] = _pda_states[state]._rules[rule_id];
                     if (labels.contains(t._label)) {
-                        assert(_edges.find(temp_edge_t{rule._to, rule._op_label, t._from}) != _edges.end());
-                        update_edge<change_is_bottom>(state, t._label, t._to,
-                                                      solverW::add(solverW::add(rule._weight, _edges.find(temp_edge_t{rule._to, rule._op_label, t._from})->second), w),
-                                                      _automaton.new_pre_trace(rule_id, t._from));
+                        parent_t::add_derivation(state, t._label, t._to, rule._weight, this->_automaton.new_pre_trace(rule_id, t._from),
+                                                 parent_t::find_edge(rule._to, rule._op_label, t._from), id);
                     }
                 }
+                _rel[t._from].emplace_back(t._to, t._label);
 
-                if (t._from >= _n_pda_states) { return true; }
-                for (auto pre_state : _pda_states[t._from]._pre_states) {
-                    const auto &rules = _pda_states[pre_state]._rules;
-                    auto lb = rules.lower_bound(details::rule_t<W>{t._from});
-                    while (lb != rules.end() && lb->first._to == t._from) {
-                        const auto &[rule, labels] = *lb;
-                        size_t rule_id = lb - rules.begin();
-                        ++lb;
-                        switch (rule._operation) {
-                            case POP:
-                                break;
-                            case SWAP: // (line 7-8 for \Delta)
-                                if (rule._op_label == t._label) {
-                                    update_edge_bulk<change_is_bottom>(pre_state, labels, t._to, solverW::add(rule._weight, w), _automaton.new_pre_trace(rule_id));
-                                }
-                                break;
-                            case NOOP: // (line 7-8 for \Delta)
-                                if (labels.contains(t._label)) {
-                                    update_edge<change_is_bottom>(pre_state, t._label, t._to, solverW::add(rule._weight, w), _automaton.new_pre_trace(rule_id));
-                                }
-                                break;
-                            case PUSH: // (line 9)
-                                if (rule._op_label == t._label) {
-                                    auto w_temp = solverW::add(rule._weight, w);
-                                    // (line 10)
-                                    _delta_prime[t._to].emplace_back(pre_state, rule_id); // TODO: Check existence before adding(?)
-                                    auto trace = default_trace_<indirect_trace_info>();
-                                    for (const auto& [rel_to, rel_label] : _rel[t._to]) { // (line 11-12)
-                                        if (labels.contains(rel_label)) {
-                                            trace = trace_is_null<indirect_trace_info>(trace) ? _automaton.new_pre_trace(rule_id, t._to) : trace;
-                                            auto it = _edges.find(temp_edge_t{t._to, rel_label, rel_to});
-                                            assert(it != _edges.end());
-                                            update_edge<change_is_bottom>(pre_state, rel_label, rel_to, solverW::add(w_temp, it->second), trace);
-                                        }
-                                    }
+                if (t._from >= _n_pda_states) { return; }
+                for (const auto& entry : _rule_index.pre_rules(t._from, t._label)) {
+                    auto pre_state = entry._from;
+                    auto rule_id = entry._rule_id;
+                    const auto &[rule, labels] = _pda_states[pre_state]._rules[rule_id];
+                    assert(rule._to == t._from && rule._op_label == t._label);
+                    switch (rule._operation) {
+                        case SWAP: // (line 7-8 for \Delta)
+                            add_derivation_bulk(pre_state, labels, t._to, rule._weight, this->_automaton.new_pre_trace(rule_id), id);
+                            break;
+                        case PUSH: { // (line 9)
+                            // (line 10)
+                            _delta_prime[t._to].emplace_back(pre_state, rule_id);
+                            auto trace = default_trace_<indirect_trace_info>();
+                            for (const auto& [rel_to, rel_label] : _rel[t._to]) { // (line 11-12)
+                                if (labels.contains(rel_label)) {
+                                    trace = trace_is_null<indirect_trace_info>(trace) ? this->_automaton.new_pre_trace(rule_id, t._to) : trace;
+                                    parent_t::add_derivation(pre_state, rel_label, rel_to, rule._weight, trace, id, parent_t::find_edge(t._to, rel_label, rel_to));
                                 }
-                                break;
-                            default:
-                                assert(false);
+                            }
+                            break;
                         }
+                        default:
+                            assert(false);
                     }
                 }
-                return true;
+                // (line 7-8 for \Delta, NOOP rules)
+                auto derive_noop = [&](const details::rule_index::pre_entry_t& entry) {
+                    const auto& rule = _pda_states[entry._from]._rules[entry._rule_id].first;
+                    parent_t::add_derivation(entry._from, t._label, t._to, rule._weight, this->_automaton.new_pre_trace(entry._rule_id), id);
+                };
+                for (const auto& entry : _rule_index.pre_noop_rules(t._from, t._label)) {
+                    derive_noop(entry);
+                }
+                for (const auto& entry : _rule_index.pre_noop_wildcard_rules(t._from)) {
+                    derive_noop(entry);
+                }
+            }
+        };
+
+        // Fixed-point post*, see FixedPointSaturation.
+        // As in the other post* saturations, the initial automaton must not have epsilon edges or edges into PDA states.
+        template<typename W, bool indirect_trace_info, Trace_Type trace_type, typename state_id_t = uint32_t>
+        class PostStarFixedPointSaturation : public FixedPointSaturation<PostStarFixedPointSaturation<W,indirect_trace_info,trace_type,state_id_t>, W, indirect_trace_info, trace_type, state_id_t> {
+            using parent_t = FixedPointSaturation<PostStarFixedPointSaturation<W,indirect_trace_info,trace_type,state_id_t>, W, indirect_trace_info, trace_type, state_id_t>;
+            friend parent_t;
+        public:
+            explicit PostStarFixedPointSaturation(PAutomaton<W,indirect_trace_info>& automaton)
+            : parent_t(automaton), _pda_states(automaton.pda().states()), _rule_index(automaton.pda().rule_index()),
+              _n_pda_states(_pda_states.size()) {
+                initialize();
+            };
+        private:
+            const std::vector<typename PDA<W>::state_t>& _pda_states;
+            const details::rule_index& _rule_index;
+            const size_t _n_pda_states;
+            std::unordered_map<std::pair<size_t, uint32_t>, size_t, absl::Hash<std::pair<size_t, uint32_t>>> _q_prime{};
+
+            std::vector<std::vector<std::pair<state_id_t,uint32_t>>> _rel; // The non-epsilon edges taken from the workset, by _from.
+            std::vector<std::vector<state_id_t>> _epsilon_into; // From-states of the epsilon edges taken from the workset, by _to.
+
+            void initialize() {
+                auto& automaton = this->_automaton;
+                // for <p, y> -> <p', y1 y2> do
+                //   Q' U= {q_p'y1}
+                for (const auto &state : _pda_states) {
+                    for (const auto &[rule,labels] : state._rules) {
+                        if (rule._operation == PUSH) {
+                            auto res = _q_prime.emplace(std::make_pair(rule._to, rule._op_label), automaton.next_state_id());
+                            if (res.second) {
+                                automaton.add_state(false, false);
+                            }
+                        }
+                    }
+                }
+                auto n_automaton_states = automaton.states().size();
+                check_state_ids<state_id_t>(n_automaton_states);
+                _rel.resize(n_automaton_states);
+                _epsilon_into.resize(n_automaton_states);
+                parent_t::initialize_automaton_edges();
+            }
+
+            // Each combination of an epsilon edge and another edge is derived once: By the edge taken last from the workset,
+            // since _rel and _epsilon_into only contain edges taken before.
+            void step_with(uint32_t id) {
+                auto t = parent_t::edge(id);
+                auto& automaton = this->_automaton;
+                if (t._label == epsilon) {
+                    _epsilon_into[t._to].push_back(t._from);
+                    // Combine with the edges from t._to.
+                    auto trace = automaton.new_post_trace(t._to);
+                    for (const auto& [to, label] : _rel[t._to]) {
+                        parent_t::add_derivation(t._from, label, to, W::zero(), trace, id, parent_t::find_edge(t._to, label, to));
+                    }
+                    return;
+                }
+                _rel[t._from].emplace_back(t._to, t._label);
+                // Combine with the epsilon edges into t._from.
+                if (!_epsilon_into[t._from].empty()) {
+                    auto trace = automaton.new_post_trace(t._from);
+                    for (auto f : _epsilon_into[t._from]) {
+                        parent_t::add_derivation(f, t._label, t._to, W::zero(), trace, parent_t::find_edge(f, epsilon, t._from), id);
+                    }
+                }
+                if (t._from >= _n_pda_states) { return; }
+                const auto &rules = _pda_states[t._from]._rules;
+                _rule_index.for_each_post_rule(t._from, t._label, [&](size_t rule_id) {
+                    const auto &rule = rules[rule_id].first;
+                    auto trace = automaton.new_post_trace(t._from, rule_id, t._label);
+                    switch (rule._operation) {
+                        case POP:
+                            parent_t::add_derivation(rule._to, epsilon, t._to, rule._weight, trace, id);
+                            break;
+                        case SWAP:
+                            parent_t::add_derivation(rule._to, rule._op_label, t._to, rule._weight, trace, id);
+                            break;
+                        case NOOP:
+                            parent_t::add_derivation(rule._to, t._label, t._to, rule._weight, trace, id);
+                            break;
+                        case PUSH: {
+                            assert(_q_prime.find(std::make_pair(rule._to, rule._op_label)) != std::end(_q_prime));
+                            size_t q_new = _q_prime[std::make_pair(rule._to, rule._op_label)];
+                            // The weight is on the edge below the pushed label, so the first edge has weight zero.
+                            if (!parent_t::has_edge(rule._to, rule._op_label, q_new)) {
+                                parent_t::add_derivation(rule._to, rule._op_label, q_new, W::zero(), trace);
+                            }
+                            parent_t::add_derivation(q_new, t._label, t._to, rule._weight, trace, id);
+                            break;
+                        }
+                    }
+                });
             }
         };
 
@@ -803,12 +1846,7 @@ namespace pdaaal {
                     auto trace_label_temp = _automaton.get_trace_label(from, label, to);
                     if (trace_is_null<indirect_trace_info>(trace_label_temp)) return std::nullopt; // Done
                     _path.pop();
-                    trace_t trace_label;
-                    if constexpr(indirect_trace_info) {
-                        trace_label = *trace_label_temp;
-                    } else {
-                        trace_label = trace_label_temp;
-                    }
+                    trace_t trace_label = _automaton.get_trace(trace_label_temp);
 
                     if (trace_label.is_pre_trace()) {
                         // pre* trace
@@ -848,11 +1886,7 @@ namespace pdaaal {
                                 auto[from2, label2, to2] = _path.front_edge();
                                 _path.pop();
                                 assert(!trace_is_null<indirect_trace_info>(_automaton.get_trace_label(from2, label2, to2)));
-                                if constexpr(indirect_trace_info) {
-                                    trace_label = *_automaton.get_trace_label(from2, label2, to2);
-                                } else {
-                                    trace_label = _automaton.get_trace_label(from2, label2, to2);
-                                }
+                                trace_label = _automaton.get_trace(_automaton.get_trace_label(from2, label2, to2));
                                 _path.emplace(trace_label._state, trace_label._label);
                                 break;
                         }
@@ -863,58 +1897,189 @@ namespace pdaaal {
             }
         };
 
+        // Priority for Workset_Policy::Goal: A lower bound on the number of rules post* must apply from an edge (p, label, q) before
+        // the goal (the final automaton) can read the configuration. This is 0 if the goal has an edge from p with the label
+        // (or an epsilon or wildcard edge), and otherwise 1 + the smallest distance (see Solver::goal_distances) of the target state
+        // of a rule from p that fires on the label. Epsilon edges and edges from non-PDA states get the distance of p and 0, respectively.
+        // The bounds are computed on demand and cached.
+        template <typename W>
+        class goal_bound {
+        public:
+            template <typename automaton_t>
+            goal_bound(const automaton_t& goal, std::vector<uint32_t> distances)
+            : _pda(&goal.pda()), _distances(std::move(distances)), _goal_labels(_distances.size()), _goal_any(_distances.size(), false) {
+                goal.with_edges([&](const auto& edges) {
+                    for (size_t state = 0; state < _goal_labels.size(); ++state) {
+                        auto& state_labels = _goal_labels[state];
+                        for (const auto& [to, labels] : edges(state)) {
+                            for (const auto& label : labels) {
+                                if (label.first == epsilon || label.first == PAutomaton<W>::wildcard) {
+                                    _goal_any[state] = true;
+                                } else {
+                                    state_labels.push_back(label.first);
+                                }
+                            }
+                        }
+                        std::sort(state_labels.begin(), state_labels.end());
+                        state_labels.erase(std::unique(state_labels.begin(), state_labels.end()), state_labels.end());
+                    }
+                });
+            }
+
+            template <typename Elem>
+            uint32_t operator()(const Elem& elem) {
+                size_t from = elem._from;
+                if (from >= _distances.size()) return 0;
+                if (elem._label == epsilon || elem._label == PAutomaton<W>::wildcard) return _distances[from];
+                if (_goal_any[from] || std::binary_search(_goal_labels[from].begin(), _goal_labels[from].end(), elem._label)) return 0;
+                auto [it, fresh] = _bounds.emplace((static_cast<uint64_t>(from) << 32) | elem._label, 0);
+                if (fresh) {
+                    auto bound = static_cast<uint32_t>(_distances.size());
+                    const auto& rules = _pda->states()[from]._rules;
+                    _pda->rule_index().for_each_post_rule(from, elem._label, [&](size_t rule_id) {
+                        bound = std::min(bound, _distances[rules[rule_id].first._to]);
+                    });
+                    it->second = bound + 1;
+                }
+                return it->second;
+            }
+
+        private:
+            const PDA<W>* _pda;
+            std::vector<uint32_t> _distances;
+            std::vector<std::vector<uint32_t>> _goal_labels; // Sorted labels of the goal edges from each PDA state.
+            std::vector<bool> _goal_any;
+            std::unordered_map<uint64_t, uint32_t, absl::Hash<uint64_t>> _bounds;
+        };
+
     }
 
     class Solver {
     public:
         template <Trace_Type trace_type = Trace_Type::Longest, typename pda_t, typename automaton_t, typename W>
-        static bool pre_star_fixed_point_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance) {
+        static bool pre_star_fixed_point_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget()) {
             instance.enable_pre_star();
-            pre_star_fixed_point<trace_type>(instance.automaton());
-            return instance.template initialize_product<false,false>();
+            instance.freeze_input();
+            pre_star_fixed_point<trace_type>(instance.automaton(), limits);
+            return !limits.exceeded() && instance.template initialize_product<false,false>(); // The weights are not final, if the budget is exceeded.
         }
         template <Trace_Type trace_type = Trace_Type::Longest, typename W, bool indirect>
-        static void pre_star_fixed_point(PAutomaton<W,indirect> &automaton) {
+        static void pre_star_fixed_point(PAutomaton<W,indirect> &automaton, const budget& limits = budget()) {
             details::PreStarFixedPointSaturation<W,indirect,trace_type> saturation(automaton);
-            while(!saturation.done()) {
+            saturation.run(limits);
+        }
+
+        // Fixed-point post*. Unlike post_star_accepts<Trace_Type::Shortest>, this supports negative weights and longest traces,
+        // and detects unbounded weights (see details::PostStarFixedPointSaturation). There is no early termination, since weights may still change.
+        template <Trace_Type trace_type = Trace_Type::Longest, typename pda_t, typename automaton_t, typename W>
+        static bool post_star_fixed_point_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget()) {
+            instance.freeze_input();
+            post_star_fixed_point<trace_type>(instance.automaton(), limits);
+            return !limits.exceeded() && instance.template initialize_product<false,false>(); // The weights are not final, if the budget is exceeded.
+        }
+        template <Trace_Type trace_type = Trace_Type::Longest, typename W, bool indirect>
+        static void post_star_fixed_point(PAutomaton<W,indirect> &automaton, const budget& limits = budget()) {
+            details::PostStarFixedPointSaturation<W,indirect,trace_type> saturation(automaton);
+            saturation.run(limits);
+        }
+
+        // With Trace_Type::Shortest, this is a bidirectional shortest trace search, see dual_search_shortest. Use get_trace_dual_search<Trace_Type::Shortest> for the trace.
+        template <Trace_Type trace_type = Trace_Type::Any, typename pda_t, typename automaton_t, typename W>
+        static bool dual_search_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget(),
+                                        Dual_Policy policy = Dual_Policy::Alternate) {
+            static_assert(trace_type == Trace_Type::Any || trace_type == Trace_Type::None || trace_type == Trace_Type::Shortest,
+                          "This dual* supports Trace_Type::Any, Trace_Type::None and Trace_Type::Shortest.");
+            static_assert(is_weighted<W> || trace_type != Trace_Type::Shortest, "Cannot do weighted dual* for PDA without weights.");
+            if (instance.template initialize_product<true>()) {
+                return true; // Only uses edges of weight zero, so this is also a shortest path.
+            }
+            if constexpr (trace_type == Trace_Type::Shortest) {
+                dual_scheduler scheduler(policy);
+                return dual_search_shortest(instance, limits, scheduler);
+            } else {
+                return dual_search<W>(instance.final_automaton(), instance.initial_automaton(),
+                    [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                        return instance.add_final_edge(from, label, to, trace);
+                    },
+                    [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                        return instance.add_initial_edge(from, label, to, trace);
+                    }, limits, policy
+                );
+            }
+        }
+        template <typename W, bool ET=true>
+        static bool dual_search(PAutomaton<W> &pre_star_automaton, PAutomaton<W> &post_star_automaton,
+                                const details::early_termination_fn<W>& pre_star_early_termination,
+                                const details::early_termination_fn<W>& post_star_early_termination,
+                                const budget& limits = budget(), Dual_Policy policy = Dual_Policy::Alternate) {
+            dual_scheduler scheduler(policy);
+            return dual_search<W,ET>(pre_star_automaton, post_star_automaton, pre_star_early_termination, post_star_early_termination, limits, scheduler);
+        }
+        // The scheduler decides which direction does the next step. Afterwards, it has the number of steps and edges of each direction.
+        template <typename W, bool ET=true>
+        static bool dual_search(PAutomaton<W> &pre_star_automaton, PAutomaton<W> &post_star_automaton,
+                                const details::early_termination_fn<W>& pre_star_early_termination,
+                                const details::early_termination_fn<W>& post_star_early_termination,
+                                const budget& limits, dual_scheduler& scheduler) {
+            details::PreStarSaturation<W,ET> pre_star(pre_star_automaton, pre_star_early_termination);
+            details::PostStarSaturation<W,ET> post_star(post_star_automaton, post_star_early_termination);
+            if constexpr (ET) {
+                if (pre_star.found() || post_star.found()) return true;
+            }
+            auto step = [&scheduler](auto& saturation, dual_scheduler::direction_t direction) {
+                auto edges_before = saturation.number_of_edges();
                 saturation.step();
+                scheduler.record(direction, saturation.number_of_edges() - edges_before);
+                return saturation.found();
+            };
+            while(!pre_star.workset_empty() && !post_star.workset_empty() &&
+                  limits.allow_step([&pre_star, &post_star](){ return pre_star.memory_usage() + post_star.memory_usage(); })) {
+                auto direction = scheduler.next(post_star.workset_size(), pre_star.workset_size());
+                bool found = direction == dual_scheduler::post ? step(post_star, direction) : step(pre_star, direction);
+                if (ET && found) return true;
             }
-            saturation.finalize();
+            return pre_star.found() || post_star.found();
         }
 
+        // Parallel dual*: post* and pre* run at the same time on their own automata, and meet in the product.
+        // The threads are split between the two directions, with at least one thread each.
         template <typename pda_t, typename automaton_t, typename W>
-        static bool dual_search_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance) {
+        static bool dual_search_parallel_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, size_t n_threads, const budget& limits = budget()) {
             if (instance.template initialize_product<true>()) {
                 return true;
             }
-            return dual_search<W>(instance.final_automaton(), instance.initial_automaton(),
+            return dual_search_parallel<W>(instance.final_automaton(), instance.initial_automaton(), n_threads,
                 [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
                     return instance.add_final_edge(from, label, to, trace);
                 },
                 [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
                     return instance.add_initial_edge(from, label, to, trace);
-                }
+                }, limits
             );
         }
+        // Both saturations add edges to their automaton and call early termination under one shared lock, since early termination
+        // (e.g. the product construction) reads both automata. When one direction is done (saturated, found or out of budget),
+        // it stops the other, since a saturated automaton in either direction gives the final answer.
         template <typename W, bool ET=true>
-        static bool dual_search(PAutomaton<W> &pre_star_automaton, PAutomaton<W> &post_star_automaton,
-                                const details::early_termination_fn<W>& pre_star_early_termination,
-                                const details::early_termination_fn<W>& post_star_early_termination) {
-            details::PreStarSaturation<W,ET> pre_star(pre_star_automaton, pre_star_early_termination);
-            details::PostStarSaturation<W,ET> post_star(post_star_automaton, post_star_early_termination);
+        static bool dual_search_parallel(PAutomaton<W> &pre_star_automaton, PAutomaton<W> &post_star_automaton, size_t n_threads,
+                                         const details::early_termination_fn<W>& pre_star_early_termination,
+                                         const details::early_termination_fn<W>& post_star_early_termination,
+                                         const budget& limits = budget()) {
+            std::mutex automaton_mutex;
+            auto post_threads = std::max<size_t>((n_threads + 1) / 2, 1);
+            auto pre_threads = std::max<size_t>(n_threads / 2, 1);
+            details::ParallelPreStarSaturation<W,ET> pre_star(pre_star_automaton, pre_threads, pre_star_early_termination, &automaton_mutex);
+            details::ParallelPostStarSaturation<W,ET> post_star(post_star_automaton, post_threads, post_star_early_termination, &automaton_mutex);
             if constexpr (ET) {
                 if (pre_star.found() || post_star.found()) return true;
             }
-            while(!pre_star.workset_empty() && !post_star.workset_empty()) {
-                post_star.step();
-                if constexpr (ET) {
-                    if (post_star.found()) return true;
-                }
-                pre_star.step();
-                if constexpr (ET) {
-                    if (pre_star.found()) return true;
-                }
-            }
+            std::thread post_thread([&pre_star, &post_star, &limits]() {
+                post_star.run(limits);
+                pre_star.stop();
+            });
+            pre_star.run(limits);
+            post_star.stop();
+            post_thread.join();
             return pre_star.found() || post_star.found();
         }
 
@@ -923,27 +2088,46 @@ namespace pdaaal {
             if (stack.size() == 1) {
                 auto s_label = stack[0];
                 return pre_star<W,true>(automaton, [&automaton, state, s_label](size_t from, uint32_t label, size_t to, trace_ptr<W>) -> bool {
-                    return from == state && label == s_label && automaton.states()[to]->_accepting;
+                    return from == state && (label == s_label || label == PAutomaton<W>::wildcard) && automaton.states()[to]->_accepting;
                 });
             } else {
                 return pre_star<W>(automaton) || automaton.accepts(state, stack);
             }
         }
 
-        template <typename pda_t, typename automaton_t, typename W>
-        static bool pre_star_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance) {
+        // The workset policy is used for Trace_Type::Any. Shortest trace uses a priority queue ordered by weight (see details::PreStarShortestSaturation).
+        template <Trace_Type trace_type = Trace_Type::Any, typename pda_t, typename automaton_t, typename W>
+        static bool pre_star_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget(),
+                                     Workset_Policy policy = Workset_Policy::Default) {
+            static_assert(trace_type == Trace_Type::Any || trace_type == Trace_Type::Shortest, "This pre* supports Trace_Type::Any and Trace_Type::Shortest.");
+            static_assert(is_weighted<W> || trace_type == Trace_Type::Any, "Cannot do weighted pre* for PDA without weights.");
             instance.enable_pre_star();
-            return instance.initialize_product() ||
-                   pre_star<W,true>(instance.automaton(), [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
-                       return instance.add_edge_product(from, label, to, trace);
-                   });
+            instance.freeze_input();
+            if (instance.initialize_product()) return true; // Only uses edges of weight zero, so this is also a shortest path.
+            details::early_termination_fn<W> early_termination = [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                return instance.add_edge_product(from, label, to, trace);
+            };
+            if constexpr (trace_type == Trace_Type::Shortest) {
+                // The first path found in the product bounds the weight of the shortest path. Saturation continues until the remaining edges
+                // are at least this heavy, and then the product is completed, since early termination stops adding to it after the first path.
+                auto bound = [&instance]() { return std::get<2>(instance.template find_path<Trace_Type::Shortest>()); };
+                if (!pre_star_shortest<W,true>(instance.automaton(), early_termination, limits, bound)) return false;
+                instance.template initialize_product<false,false>();
+                return true;
+            } else {
+                return with_workset<details::temp_edge_t>(policy, Workset_Policy::LIFO,
+                    [&instance](){ return goal_distances(instance.initial_automaton(), false); },
+                    [&instance](){ return state_distance{goal_distances(instance.initial_automaton(), false)}; }, // Goal is only for post*.
+                    [&](auto workset) { return pre_star<W,true>(instance.automaton(), early_termination, limits, std::move(workset)); });
+            }
         }
 
-        template <typename W, bool ET=false>
+        template <typename W, bool ET=false, typename Workset = lifo_workset<details::temp_edge_t>>
         static bool pre_star(PAutomaton<W> &automaton,
-                             const details::early_termination_fn<W>& early_termination = [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; }) {
-            details::PreStarSaturation<W,ET> saturation(automaton, early_termination);
-            while(!saturation.workset_empty()) {
+                             const details::early_termination_fn<W>& early_termination = [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; },
+                             const budget& limits = budget(), Workset workset = Workset()) {
+            details::PreStarSaturation<W,ET,packed_edge_set,uint32_t,Workset> saturation(automaton, early_termination, std::move(workset));
+            while(!saturation.workset_empty() && limits.allow_step([&saturation](){ return saturation.memory_usage(); })) {
                 if constexpr (ET) {
                     if (saturation.found()) return true;
                 }
@@ -952,48 +2136,165 @@ namespace pdaaal {
             return saturation.found();
         }
 
+        // Multi-threaded pre*. With n_threads <= 1 this runs the saturation on the calling thread only.
+        // The saturated automaton is the same as with pre_star, but the traces are not: get_trace gives a valid trace,
+        // which depends on the order in which the workers add edges, and so may differ from the sequential one and between runs.
+        template <typename pda_t, typename automaton_t, typename W>
+        static bool pre_star_parallel_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, size_t n_threads, const budget& limits = budget()) {
+            instance.enable_pre_star();
+            instance.freeze_input();
+            return instance.initialize_product() ||
+                   pre_star_parallel<W,true>(instance.automaton(), n_threads, [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                       return instance.add_edge_product(from, label, to, trace);
+                   }, limits);
+        }
+
+        template <typename W, bool ET=false>
+        static bool pre_star_parallel(PAutomaton<W> &automaton, size_t n_threads,
+                                      const details::early_termination_fn<W>& early_termination = [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; },
+                                      const budget& limits = budget()) {
+            details::ParallelPreStarSaturation<W,ET> saturation(automaton, n_threads, early_termination);
+            saturation.run(limits);
+            return saturation.found();
+        }
+
+        // Multi-threaded post*. With n_threads <= 1 this runs the saturation on the calling thread only.
+        // The saturated automaton is the same as with post_star, but the traces are not: get_trace gives a valid trace,
+        // which depends on the order in which the workers add edges, and so may differ from the sequential one and between runs.
+        template <typename pda_t, typename automaton_t, typename W>
+        static bool post_star_parallel_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, size_t n_threads, const budget& limits = budget()) {
+            instance.freeze_input();
+            return instance.initialize_product() ||
+                   post_star_parallel<W,true>(instance.automaton(), n_threads, [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                       return instance.add_edge_product(from, label, to, trace);
+                   }, limits);
+        }
+
+        template <typename W, bool ET=false>
+        static bool post_star_parallel(PAutomaton<W> &automaton, size_t n_threads,
+                                       const details::early_termination_fn<W>& early_termination = [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; },
+                                       const budget& limits = budget()) {
+            details::ParallelPostStarSaturation<W,ET> saturation(automaton, n_threads, early_termination);
+            saturation.run(limits);
+            return saturation.found();
+        }
+
+        // As with the PAutomatonProduct overloads, a negative answer is only final if the budget was not exceeded, see budget::result.
         template <Trace_Type trace_type = Trace_Type::Any, typename W>
-        static bool post_star_accepts(PAutomaton<W> &automaton, size_t state, const std::vector<uint32_t> &stack) {
+        static bool post_star_accepts(PAutomaton<W> &automaton, size_t state, const std::vector<uint32_t> &stack, const budget& limits = budget()) {
             if (stack.size() == 1) {
                 auto s_label = stack[0];
                 return post_star<trace_type,W,true>(automaton, [&automaton, state, s_label](size_t from, uint32_t label, size_t to, trace_ptr<W>) -> bool {
                     return from == state && label == s_label && automaton.states()[to]->_accepting;
-                });
+                }, limits);
+            } else if constexpr (trace_type == Trace_Type::None) {
+                // Only the answer is needed, so the saturated relation is not written into the automaton.
+                details::PostStarNoTraceSaturation<W> saturation(automaton);
+                while(!saturation.workset_empty() && limits.allow_step([&saturation](){ return saturation.memory_usage(); })) {
+                    saturation.step();
+                }
+                if (!saturation.workset_empty()) return false; // Stopped.
+                return saturation.accepts(state, stack);
             } else {
-                return post_star<trace_type,W>(automaton) || automaton.accepts(state, stack);
+                return post_star<trace_type,W>(automaton, [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; }, limits) || automaton.accepts(state, stack);
             }
         }
 
+        // The workset policy is used for Trace_Type::Any and Trace_Type::None. Shortest trace uses a priority queue ordered by weight.
+        // Workset_Policy::Goal is an A* search over saturation steps with details::goal_bound as the bound (see goal_workset), which aims at early termination.
         template <Trace_Type trace_type = Trace_Type::Any, typename pda_t, typename automaton_t, typename W>
-        static bool post_star_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance) {
-            return instance.initialize_product() ||
-                   post_star<trace_type,W,true>(instance.automaton(), [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
-                       return instance.add_edge_product(from, label, to, trace);
-                   });
+        static bool post_star_accepts(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget(),
+                                      Workset_Policy policy = Workset_Policy::Default) {
+            instance.freeze_input();
+            if (instance.initialize_product()) return true;
+            details::early_termination_fn<W> early_termination = [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                return instance.add_edge_product(from, label, to, trace);
+            };
+            if constexpr (trace_type == Trace_Type::Any || trace_type == Trace_Type::None) {
+                return with_workset<details::temp_edge_t>(policy, Workset_Policy::FIFO,
+                    [&instance](){ return goal_distances(instance.final_automaton(), true); },
+                    [&instance](){ return details::goal_bound<W>(instance.final_automaton(), goal_distances(instance.final_automaton(), true)); },
+                    [&](auto workset) { return post_star<trace_type,W,true>(instance.automaton(), early_termination, limits, std::move(workset)); });
+            } else {
+                return post_star<trace_type,W,true>(instance.automaton(), early_termination, limits);
+            }
         }
 
-        template <Trace_Type trace_type = Trace_Type::Any, typename W, bool ET = false>
+        template <Trace_Type trace_type = Trace_Type::Any, typename W, bool ET = false, typename Workset = fifo_workset<details::temp_edge_t>>
         static bool post_star(PAutomaton<W> &automaton,
-                              const details::early_termination_fn<W>& early_termination = [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; }) {
-            static_assert(is_weighted<W> || trace_type != Trace_Type::Shortest, "Cannot do shortest-trace post* for PDA without weights."); // TODO: Consider: W=uin32_t, weight==1 as a default weight.
+                              const details::early_termination_fn<W>& early_termination = [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; },
+                              const budget& limits = budget(), Workset workset = Workset()) {
+            static_assert(is_weighted<W> || trace_type == Trace_Type::Any || trace_type == Trace_Type::None, "Cannot do weighted post* for PDA without weights."); // TODO: Consider: W=uin32_t, weight==1 as a default weight.
             if constexpr (is_weighted<W> && trace_type == Trace_Type::Shortest) {
-                return post_star_shortest<W,true,ET>(automaton, early_termination);
+                return post_star_shortest<W,true,ET>(automaton, early_termination, limits);
+            } else if constexpr (is_weighted<W> && (trace_type == Trace_Type::Longest || trace_type == Trace_Type::ShortestFixedPoint)) {
+                static_assert(!ET, "Fixed-point post* does not support early termination.");
+                post_star_fixed_point<trace_type>(automaton, limits);
+                return false;
             } else if constexpr (trace_type == Trace_Type::Any) {
-                return post_star_any<W,ET>(automaton, early_termination);
+                return post_star_any<W,ET>(automaton, early_termination, limits, std::move(workset));
             } else if constexpr (trace_type == Trace_Type::None) {
-                return post_star_any<W,ET>(automaton, early_termination); // TODO: Implement faster no-trace option.
+                return post_star_no_trace<W,ET>(automaton, early_termination, limits, std::move(workset));
+            }
+        }
+
+        // Distances in the control state graph of the PDA (with an edge p -> p' for each rule from p to p') between each PDA state and
+        // the goal, i.e. the PDA states where the goal automaton has an outgoing edge or is accepting.
+        // With to_goal, this is the distance from the state to the goal (for post*, where the goal is the final automaton),
+        // otherwise the distance from the goal to the state (for pre*, where the goal is the initial automaton).
+        // Used by Workset_Policy::Distance and Workset_Policy::Goal. States that cannot reach (or be reached from) the goal get distance pda.states().size().
+        template <typename automaton_t>
+        static std::vector<uint32_t> goal_distances(const automaton_t& goal, bool to_goal) {
+            const auto& pda_states = goal.pda().states();
+            auto n = pda_states.size();
+            // Going backwards to the goal uses the predecessors (_pre_states) that the PDA already keeps.
+            std::vector<std::vector<uint32_t>> successors(to_goal ? 0 : n);
+            if (!to_goal) {
+                for (size_t from = 0; from < n; ++from) {
+                    for (const auto& [rule, labels] : pda_states[from]._rules) {
+                        successors[from].push_back(rule._to);
+                    }
+                }
             }
+            std::vector<uint32_t> distances(n, static_cast<uint32_t>(n));
+            std::vector<uint32_t> waiting;
+            goal.with_edges([&](const auto& edges) {
+                for (size_t state = 0; state < n; ++state) {
+                    const auto& range = edges(state);
+                    if (goal.states()[state]->_accepting || range.begin() != range.end()) {
+                        distances[state] = 0;
+                        waiting.push_back(state);
+                    }
+                }
+            });
+            for (size_t i = 0; i < waiting.size(); ++i) { // BFS
+                auto state = waiting[i];
+                auto visit = [&](size_t next) {
+                    if (distances[next] == n) {
+                        distances[next] = distances[state] + 1;
+                        waiting.push_back(next);
+                    }
+                };
+                if (to_goal) {
+                    for (auto next : pda_states[state]._pre_states) visit(next);
+                } else {
+                    for (auto next : successors[state]) visit(next);
+                }
+            }
+            return distances;
         }
 
         template <typename pda_t, typename automaton_t, typename W>
-        static bool pre_star_accepts_no_ET(PAutomatonProduct<pda_t,automaton_t,W>& instance) {
+        static bool pre_star_accepts_no_ET(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget()) {
             instance.enable_pre_star();
-            pre_star<W,false>(instance.automaton());
+            instance.freeze_input();
+            pre_star<W,false>(instance.automaton(), [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; }, limits);
             return instance.template initialize_product<false,false>();
         }
         template <Trace_Type trace_type = Trace_Type::Any, typename pda_t, typename automaton_t, typename W>
-        static bool post_star_accepts_no_ET(PAutomatonProduct<pda_t,automaton_t,W>& instance) {
-            post_star<trace_type,W,false>(instance.automaton());
+        static bool post_star_accepts_no_ET(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits = budget()) {
+            instance.freeze_input();
+            post_star<trace_type,W,false>(instance.automaton(), [](size_t, uint32_t, size_t, trace_ptr<W>) -> bool { return false; }, limits);
             return instance.template initialize_product<false,false>();
         }
 
@@ -1008,20 +2309,17 @@ namespace pdaaal {
                 return _get_trace(instance.pda(), instance.automaton(), path, stack);
             }
         }
-        template <typename pda_t, typename automaton_t, typename W>
+        // With Trace_Type::Shortest, this returns the trace and its weight.
+        template <Trace_Type trace_type = Trace_Type::Any, typename pda_t, typename automaton_t, typename W>
         static auto get_trace_dual_search(const PAutomatonProduct<pda_t,automaton_t,W>& instance) {
-            auto [paths, stack] = instance.template find_path<Trace_Type::Any, true>();
-            std::vector<size_t> i_path, f_path;
-            for (const auto& [i_state, f_state] : paths) {
-                i_path.emplace_back(i_state);
-                f_path.emplace_back(f_state);
-            }
-            auto trace1 = _get_trace(instance.pda(), instance.initial_automaton(), i_path, stack);
-            auto trace2 = _get_trace(instance.pda(), instance.final_automaton(), f_path, stack);
-            assert(trace1.back()._pdastate == trace2.front()._pdastate);
-            assert(trace1.back()._stack.size() == trace2.front()._stack.size()); // Should also check == for contents of stack, but T might not implement ==.
-            trace1.insert(trace1.end(), trace2.begin() + 1, trace2.end());
-            return trace1;
+            static_assert(trace_type == Trace_Type::Any || trace_type == Trace_Type::Shortest, "Dual* traces are either any or shortest trace.");
+            if constexpr (trace_type == Trace_Type::Shortest) {
+                auto [paths, stack, weight] = instance.find_dual_path();
+                return std::make_pair(_get_trace_dual_search(instance, paths, stack), weight);
+            } else {
+                auto [paths, stack] = instance.template find_path<Trace_Type::Any, true>();
+                return _get_trace_dual_search(instance, paths, stack);
+            }
         }
         template <Trace_Type trace_type = Trace_Type::Any, bool use_dual=false, typename pda_t, typename automaton_t, typename W>
         static auto get_rule_trace_and_paths(const PAutomatonProduct<pda_t,automaton_t,W>& instance) {
@@ -1063,22 +2361,36 @@ namespace pdaaal {
         }
 
     private:
-        template <typename W, bool ET>
-        static bool post_star_any(PAutomaton<W> &automaton, const details::early_termination_fn<W>& early_termination) {
-            details::PostStarSaturation<W,ET> saturation(automaton, early_termination);
-            while(!saturation.workset_empty()) {
+        template <typename W, bool ET, typename Workset>
+        static bool post_star_any(PAutomaton<W> &automaton, const details::early_termination_fn<W>& early_termination, const budget& limits, Workset workset) {
+            details::PostStarSaturation<W,ET,packed_edge_set,uint32_t,Workset> saturation(automaton, early_termination, std::move(workset));
+            while(!saturation.workset_empty() && limits.allow_step([&saturation](){ return saturation.memory_usage(); })) {
+                if constexpr (ET) {
+                    if (saturation.found()) return true;
+                }
+                saturation.step();
+            }
+            return saturation.found();
+        }
+
+        template <typename W, bool ET, typename Workset>
+        static bool post_star_no_trace(PAutomaton<W> &automaton, const details::early_termination_fn<W>& early_termination, const budget& limits, Workset workset) {
+            details::PostStarNoTraceSaturation<W,ET,packed_edge_set,uint32_t,Workset> saturation(automaton, early_termination, std::move(workset));
+            while(!saturation.workset_empty() && limits.allow_step([&saturation](){ return saturation.memory_usage(); })) {
                 if constexpr (ET) {
                     if (saturation.found()) return true;
                 }
                 saturation.step();
             }
+            if (!saturation.workset_empty()) return false; // Stopped.
+            saturation.materialize();
             return saturation.found();
         }
 
         template<typename W, bool Enable, bool ET, typename = std::enable_if_t<Enable>>
-        static bool post_star_shortest(PAutomaton<W> &automaton, const details::early_termination_fn<W>& early_termination) {
+        static bool post_star_shortest(PAutomaton<W> &automaton, const details::early_termination_fn<W>& early_termination, const budget& limits) {
             details::PostStarShortestSaturation<W,Enable,ET> saturation(automaton, early_termination);
-            while(!saturation.workset_empty()) {
+            while(!saturation.workset_empty() && limits.allow_step([&saturation](){ return saturation.memory_usage(); })) {
                 if constexpr (ET) {
                     if (saturation.found()) break;
                 }
@@ -1088,6 +2400,79 @@ namespace pdaaal {
             return saturation.found();
         }
 
+        // With early termination, the saturation continues after the first accepting path was found, until the weight of the next edge is
+        // at least found_bound() (called once). Without found_bound, it stops at the first accepting path.
+        template<typename W, bool ET>
+        static bool pre_star_shortest(PAutomaton<W> &automaton, const details::early_termination_fn<W>& early_termination, const budget& limits,
+                                      const std::function<typename W::type()>& found_bound = nullptr) {
+            details::PreStarShortestSaturation<W,ET> saturation(automaton, early_termination);
+            std::optional<typename W::type> bound;
+            while(!saturation.workset_empty() && limits.allow_step([&saturation](){ return saturation.memory_usage(); })) {
+                if constexpr (ET) {
+                    if (saturation.found()) {
+                        if (!found_bound) break;
+                        if (!bound) bound = found_bound();
+                        if (!solver_weight<W,Trace_Type::Shortest>::less(saturation.last_weight(), *bound)) break;
+                    }
+                }
+                saturation.step();
+            }
+            return saturation.found();
+        }
+
+        // Bidirectional shortest trace search: Dijkstra-ordered post* on the initial automaton and pre* on the final automaton.
+        // Let L_post and L_pre be the workset weights of the last settled edges. Each saturation has settled all configurations lighter than its L
+        // (post* adds its edges from mid-states eagerly for this), so a configuration reached from the initial automaton with weight below L_post
+        // and reaching the final automaton with weight below L_pre is in the product.
+        // On a trace of weight w, the weight so far grows from 0 to w in steps of at most the largest rule weight r, so if L_post + L_pre > w + r
+        // (and both are positive), some configuration on the trace is in the product. After the first meeting, the search therefore continues until
+        // L_post + L_pre exceeds the weight of the best path in the product plus r (or one direction is saturated), and then completes the product,
+        // since early termination stops adding to it after the first meeting.
+        template <typename pda_t, typename automaton_t, typename W>
+        static bool dual_search_shortest(PAutomatonProduct<pda_t,automaton_t,W>& instance, const budget& limits, dual_scheduler& scheduler) {
+            using weight_t = typename W::type;
+            using solverW = solver_weight<W,Trace_Type::Shortest>;
+            details::early_termination_fn<W> pre_star_early_termination = [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                return instance.add_final_edge(from, label, to, trace);
+            };
+            details::early_termination_fn<W> post_star_early_termination = [&instance](size_t from, uint32_t label, size_t to, trace_ptr<W> trace) -> bool {
+                return instance.add_initial_edge(from, label, to, trace);
+            };
+            details::PreStarShortestSaturation<W,true> pre_star(instance.final_automaton(), pre_star_early_termination);
+            details::PostStarShortestSaturation<W,true,true,true> post_star(instance.initial_automaton(), post_star_early_termination);
+            weight_t max_rule_weight = W::zero();
+            for (const auto& state : instance.pda().states()) {
+                for (const auto& [rule, labels] : state._rules) {
+                    if (solverW::less(max_rule_weight, rule._weight)) max_rule_weight = rule._weight;
+                }
+            }
+            auto step = [&scheduler](auto& saturation, dual_scheduler::direction_t direction) {
+                auto edges_before = saturation.number_of_edges();
+                saturation.step();
+                scheduler.record(direction, saturation.number_of_edges() - edges_before);
+            };
+            std::optional<weight_t> bound;
+            while(!pre_star.workset_empty() && !post_star.workset_empty() &&
+                  limits.allow_step([&pre_star, &post_star](){ return pre_star.memory_usage() + post_star.memory_usage(); })) {
+                // The bound relies on weights being sums, so for semiring weights the search continues until one direction is saturated.
+                if (!is_semiring_weight<W> && (pre_star.found() || post_star.found())) {
+                    if (!bound) bound = std::get<2>(instance.find_dual_path());
+                    if (solverW::less(W::zero(), post_star.last_weight()) && solverW::less(W::zero(), pre_star.last_weight()) &&
+                        solverW::less(solverW::add(*bound, max_rule_weight), solverW::add(post_star.last_weight(), pre_star.last_weight()))) break;
+                }
+                auto direction = scheduler.next(post_star.workset_size(), pre_star.workset_size());
+                if (direction == dual_scheduler::post) {
+                    step(post_star, direction);
+                } else {
+                    step(pre_star, direction);
+                }
+            }
+            post_star.finalize();
+            if (!pre_star.found() && !post_star.found()) return false;
+            instance.template initialize_product<true,false>();
+            return true;
+        }
+
         template <typename T, typename W, typename S, bool ssm, bool indirect>
         static std::vector<typename TypedPDA<T,W,fut::type::vector,S,ssm>::tracestate_t>
         _get_trace(const TypedPDA<T,W,fut::type::vector,S,ssm> &pda, const PAutomaton<W,indirect>& automaton,
@@ -1193,22 +2578,53 @@ namespace pdaaal {
             }
             assert(stack.size() + 1 == paths.size());
             // Build up stack of edges in the PAutomaton. Each PDA rule corresponds to changing some of the top edges.
-            AutomatonPath initial_automaton_path(paths.back().first);
-            for (size_t i = stack.size(); i > 0; --i) {
-                initial_automaton_path.emplace(paths[i - 1].first, stack[i - 1]);
-            }
-            auto [trace, initial_stack, initial_path] = _get_trace_stack_path(initial_automaton, std::move(initial_automaton_path));
+            auto [i_path, i_stack] = _dual_path_and_stack<true>(paths, stack);
+            auto [trace, initial_stack, initial_path] = _get_trace_stack_path(initial_automaton, AutomatonPath(i_path, i_stack));
 
-            AutomatonPath final_automaton_path(paths.back().second);
-            for (size_t i = stack.size(); i > 0; --i) {
-                final_automaton_path.emplace(paths[i - 1].second, stack[i - 1]);
-            }
-            auto [trace2, final_stack, final_path] = _get_trace_stack_path(final_automaton, std::move(final_automaton_path));
+            auto [f_path, f_stack] = _dual_path_and_stack<false>(paths, stack);
+            auto [trace2, final_stack, final_path] = _get_trace_stack_path(final_automaton, AutomatonPath(f_path, f_stack));
             // Concat traces
             trace.insert(trace.end(), trace2.begin(), trace2.end());
             return std::make_tuple(trace[0].from(), trace, initial_stack, final_stack, initial_path, final_path);
         }
 
+        template <typename pda_t, typename automaton_t, typename W>
+        static auto _get_trace_dual_search(const PAutomatonProduct<pda_t,automaton_t,W>& instance,
+                                           const std::vector<std::pair<size_t,size_t>>& paths, const std::vector<uint32_t>& stack) {
+            if (paths.empty()) {
+                return _get_trace(instance.pda(), instance.initial_automaton(), std::vector<size_t>(), stack);
+            }
+            auto [i_path, i_stack] = _dual_path_and_stack<true>(paths, stack);
+            auto [f_path, f_stack] = _dual_path_and_stack<false>(paths, stack);
+            auto trace1 = _get_trace(instance.pda(), instance.initial_automaton(), i_path, i_stack);
+            auto trace2 = _get_trace(instance.pda(), instance.final_automaton(), f_path, f_stack);
+            assert(trace1.back()._pdastate == trace2.front()._pdastate);
+            assert(trace1.back()._stack.size() == trace2.front()._stack.size()); // Should also check == for contents of stack, but T might not implement ==.
+            trace1.insert(trace1.end(), trace2.begin() + 1, trace2.end());
+            return trace1;
+        }
+
+        // An epsilon edge in the dual* product comes from one of the two automata, while the other automaton stays in the same state.
+        // Gets the path and stack in the first (initial) or second (final) automaton, leaving out the epsilon edges it did not take.
+        template <bool first>
+        static std::pair<std::vector<size_t>, std::vector<uint32_t>>
+        _dual_path_and_stack(const std::vector<std::pair<size_t,size_t>>& paths, const std::vector<uint32_t>& stack) {
+            assert(stack.size() + 1 == paths.size());
+            auto state = [](const std::pair<size_t,size_t>& p) { return first ? p.first : p.second; };
+            std::vector<size_t> path;
+            std::vector<uint32_t> path_stack;
+            path.reserve(paths.size());
+            path_stack.reserve(stack.size());
+            for (size_t i = 0; i < stack.size(); ++i) {
+                if (stack[i] != std::numeric_limits<uint32_t>::max() || state(paths[i]) != state(paths[i + 1])) {
+                    path.push_back(state(paths[i]));
+                    path_stack.push_back(stack[i]);
+                }
+            }
+            path.push_back(state(paths.back()));
+            return std::make_pair(path, path_stack);
+        }
+
         template <typename W, bool indirect>
         static std::tuple<std::vector<user_rule_t<W>>, std::vector<uint32_t>, std::vector<size_t>>
         _get_trace_stack_path(const PAutomaton<W,indirect>& automaton, AutomatonPath&& automaton_path) {
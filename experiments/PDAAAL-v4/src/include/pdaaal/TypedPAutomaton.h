@@ -214,33 +214,47 @@ namespace pdaaal {
             return details::label_to_string(automaton.get_state(state));
         };
         json j_states;
-        for (const auto& state : automaton.states()) {
-            auto j_state = json::object();
-            if (state->_id < num_pda_states) {
-                j_state["initial"] = true;
-            }
-            if (state->_accepting) {
-                j_state["accepting"] = true;
-            }
-            j_state["edges"] = json::array();
-            for (const auto& [to, labels] : state->_edges) {
-                for (const auto& [label,tw] : labels) {
-                    json edge;
-                    if constexpr (skip_state_mapping) {
-                        edge["to"] = to;
+        automaton.with_edges([&](const auto& edges) {
+            for (const auto& state : automaton.states()) {
+                auto j_state = json::object();
+                if (state->_id < num_pda_states) {
+                    j_state["initial"] = true;
+                }
+                if (state->_accepting) {
+                    j_state["accepting"] = true;
+                }
+                j_state["edges"] = json::array();
+                for (const auto& [to, labels] : edges(state->_id)) {
+                    auto add_edge = [&j_state, &automaton, &state_to_string, to = to](uint32_t label) {
+                        json edge;
+                        if constexpr (skip_state_mapping) {
+                            edge["to"] = to;
+                        } else {
+                            edge["to"] = state_to_string(to);
+                        }
+                        edge["label"] = label == PAutomaton<W,indirect>::epsilon ? "" : details::label_to_string(automaton.typed_pda().get_symbol(label));
+                        j_state["edges"].emplace_back(edge);
+                    };
+                    if (labels.contains(PAutomaton<W,indirect>::wildcard)) { // Write a wildcard edge as one edge per label.
+                        for (uint32_t label = 0; label < automaton.number_of_labels(); ++label) {
+                            add_edge(label);
+                        }
+                        if (labels.contains(PAutomaton<W,indirect>::epsilon)) {
+                            add_edge(PAutomaton<W,indirect>::epsilon);
+                        }
                     } else {
-                        edge["to"] = state_to_string(to);
+                        for (const auto& [label,tw] : labels) {
+                            add_edge(label);
+                        }
                     }
-                    edge["label"] = label == PAutomaton<W,indirect>::epsilon ? "" : details::label_to_string(automaton.typed_pda().get_symbol(label));
-                    j_state["edges"].emplace_back(edge);
+                }
+                if constexpr (skip_state_mapping) {
+                    j_states.emplace_back(j_state);
+                } else {
+                    j_states[state_to_string(state->_id)] = j_state;
                 }
             }
-            if constexpr (skip_state_mapping) {
-                j_states.emplace_back(j_state);
-            } else {
-                j_states[state_to_string(state->_id)] = j_state;
-            }
-        }
+        });
         j["states"] = j_states;
     }
 
@@ -105,7 +105,17 @@ namespace pdaaal {
                 if constexpr (bottom_val != 0) {
                     if (lhs == bottom_val || rhs == bottom_val) return bottom_val;
                 }
-                return lhs + rhs;
+                if constexpr (std::is_integral_v<type>) {
+                    // Saturate instead of wrapping around. A sum that is better than any representable weight becomes bottom,
+                    // so unbounded weights in the fixed-point algorithms are detected even when they grow exponentially.
+                    type result{};
+                    if (__builtin_add_overflow(lhs, rhs, &result)) {
+                        return (maximize == (rhs > 0)) ? bottom_val : max_val;
+                    }
+                    return result;
+                } else {
+                    return lhs + rhs;
+                }
             };
         };
         template<typename Inner, std::size_t N, bool maximize>
@@ -170,6 +180,97 @@ namespace pdaaal {
     template<typename W> using min_weight = details::weight_impl<W,false>;
     template<typename W> using max_weight = details::weight_impl<W,true>;
 
+    // A weight domain given by an idempotent semiring S, used as the weight type W = semiring_weight<S> of a PDA.
+    // S::type is the type of the weights, and S has the static functions:
+    //   combine(a, b): The better of a and b (the semiring plus). It must return a or b (unless S::selective is false), so it gives the order of the solvers.
+    //   extend(a, b):  The weight of a trace with parts of weight a and b (the semiring times). The solvers add weights in any order,
+    //                  so it must be commutative.
+    //   zero():        The identity of combine and annihilator of extend, i.e. the weight of no trace.
+    //   one():         The identity of extend, i.e. the weight of the empty trace.
+    // Optionally, S::bounded_height is true if there is no infinite chain of strictly better weights. Otherwise, the fixed-point solvers
+    // (Trace_Type::ShortestFixedPoint) need S::bottom(), the weight of unboundedly improving traces, which extend must propagate.
+    // Trace_Type::Shortest requires that extend never gives a weight better than its arguments. As for negative weights of min_weight,
+    // the solvers throw on rule weights better than one().
+    // With S::selective = false, combine may give a weight that is neither a nor b, as for dataflow facts (see bitvector_semiring).
+    // Such an S must have bounded_height, and only the fixed-point solvers (Trace_Type::ShortestFixedPoint) support it. They give the
+    // combine of the weights of all traces (for edges and for the answer), and the trace they return is just some trace.
+    template<typename S>
+    struct semiring_weight {
+        using semiring = S;
+        using type = typename S::type;
+        static constexpr bool is_weight = true;
+        static constexpr bool is_signed = true; // Rule weights are checked against one().
+        static constexpr type zero() { return S::one(); }
+    };
+    template<typename W, typename = void> inline constexpr bool is_semiring_weight = false;
+    template<typename W> inline constexpr bool is_semiring_weight<W, std::void_t<typename W::semiring>> = true;
+
+    // Solver weights (with the interface of min_weight) with bounded_height do not need bottom(), since fixed points always converge.
+    template<typename SolverW, typename = void> inline constexpr bool is_bounded_height = false;
+    template<typename SolverW> inline constexpr bool is_bounded_height<SolverW, std::enable_if_t<SolverW::bounded_height>> = true;
+    // Weights are selective (combine returns one of its arguments) unless they set selective to false. Solver weights of min_weight and max_weight are.
+    template<typename SolverW, typename = void> inline constexpr bool is_selective = true;
+    template<typename SolverW> inline constexpr bool is_selective<SolverW, std::enable_if_t<!SolverW::selective>> = false;
+
+    namespace details {
+        template<typename S>
+        struct semiring_impl : public semiring_weight<S> {
+            using typename semiring_weight<S>::type;
+            static constexpr bool bounded_height = is_bounded_height<S>;
+            static constexpr bool selective = is_selective<S>;
+            static_assert(selective || bounded_height, "A semiring without a selective combine must have bounded height.");
+            static constexpr type max() { return S::zero(); }
+            static constexpr type bottom() { return S::bottom(); } // Only instantiated where used, so bounded_height semirings need not define it.
+            static constexpr bool less(const type& lhs, const type& rhs) {
+                return !(lhs == rhs) && S::combine(lhs, rhs) == lhs;
+            }
+            static constexpr type add(const type& lhs, const type& rhs) {
+                return S::extend(lhs, rhs);
+            }
+            static constexpr type combine(const type& lhs, const type& rhs) {
+                return S::combine(lhs, rhs);
+            }
+        };
+    }
+
+    // The (min,+) semiring of min_weight, e.g. for ordered vectors of weights as semiring_weight<min_plus_semiring<std::vector<uint32_t>>>.
+    template<typename T>
+    struct min_plus_semiring {
+        using type = T;
+        static constexpr type combine(const type& lhs, const type& rhs) { return min_weight<T>::less(rhs, lhs) ? rhs : lhs; }
+        static constexpr type extend(const type& lhs, const type& rhs) { return min_weight<T>::add(lhs, rhs); }
+        static constexpr type zero() { return min_weight<T>::max(); }
+        static constexpr type one() { return weight<T>::zero(); }
+        static constexpr type bottom() { return min_weight<T>::bottom(); }
+    };
+
+    // Bottleneck (widest path) weights: The capacity of a trace is the smallest capacity of its rules, and the best trace has the largest capacity.
+    template<typename T>
+    struct bottleneck_semiring {
+        static_assert(std::is_arithmetic_v<T> && std::numeric_limits<T>::is_specialized);
+        using type = T;
+        static constexpr bool bounded_height = std::is_integral_v<T>;
+        static constexpr type combine(type lhs, type rhs) { return std::max(lhs, rhs); }
+        static constexpr type extend(type lhs, type rhs) { return std::min(lhs, rhs); }
+        static constexpr type zero() { return std::numeric_limits<T>::lowest(); }
+        static constexpr type one() { return std::numeric_limits<T>::max(); }
+    };
+
+    // Bitvector dataflow facts that hold on every trace: The weight of a rule is the set of facts it generates (the bits of an unsigned integer).
+    // A trace generates the union over its rules, and the combined weight of traces is the intersection, i.e. the facts generated on all of them.
+    // combine is not selective, so only the fixed-point solvers support this (see semiring_weight).
+    template<typename T>
+    struct bitvector_semiring {
+        static_assert(std::is_unsigned_v<T>);
+        using type = T;
+        static constexpr bool selective = false;
+        static constexpr bool bounded_height = true;
+        static constexpr type combine(type lhs, type rhs) { return lhs & rhs; }
+        static constexpr type extend(type lhs, type rhs) { return lhs | rhs; }
+        static constexpr type zero() { return static_cast<type>(~type(0)); }
+        static constexpr type one() { return 0; }
+    };
+
     template<typename W> inline constexpr auto is_weighted = W::is_weight; // TODO: Remove usage of is_weighted<W>. Just use W::is_weight directly instead.
 
     template <typename W, typename... Args>
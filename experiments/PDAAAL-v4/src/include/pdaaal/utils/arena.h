@@ -0,0 +1,129 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_ARENA_H
+#define PDAAAL_ARENA_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <absl/hash/hash.h>
+
+namespace pdaaal {
+
+    // Append-only storage of T in fixed-size blocks, where elements are addressed by 32-bit handles.
+    // Elements never move, and adding an element allocates at most one block (of 2^block_bits elements).
+    template <typename T, size_t block_bits = 12>
+    class arena {
+        static_assert(block_bits < 32);
+        static constexpr size_t block_size = size_t(1) << block_bits;
+        static constexpr size_t block_mask = block_size - 1;
+    public:
+        using handle_t = uint32_t;
+        static constexpr handle_t null_handle = std::numeric_limits<handle_t>::max();
+
+        template <typename... Args>
+        handle_t emplace(Args&&... args) {
+            if (_size == null_handle) {
+                throw std::runtime_error("arena: More than 2^32-1 elements.");
+            }
+            if ((_size & block_mask) == 0) {
+                _blocks.emplace_back(std::make_unique<T[]>(block_size));
+            }
+            auto handle = static_cast<handle_t>(_size++);
+            (*this)[handle] = T(std::forward<Args>(args)...);
+            return handle;
+        }
+
+        [[nodiscard]] const T& operator[](handle_t handle) const {
+            assert(handle < _size);
+            return _blocks[handle >> block_bits][handle & block_mask];
+        }
+        [[nodiscard]] T& operator[](handle_t handle) {
+            assert(handle < _size);
+            return _blocks[handle >> block_bits][handle & block_mask];
+        }
+
+        [[nodiscard]] size_t size() const { return _size; }
+        [[nodiscard]] bool empty() const { return _size == 0; }
+        [[nodiscard]] size_t memory_usage() const {
+            return _blocks.capacity() * sizeof(std::unique_ptr<T[]>) + _blocks.size() * block_size * sizeof(T);
+        }
+
+    private:
+        std::vector<std::unique_ptr<T[]>> _blocks;
+        size_t _size = 0;
+    };
+
+    // An arena where equal elements share one handle. intern(value) returns the handle of an existing equal element if there is one.
+    // The index is an open addressing table of handles (linear probing), so it costs a few bytes per element in addition to the arena.
+    template <typename T, typename Hash = absl::Hash<T>, typename Equal = std::equal_to<T>, size_t block_bits = 12>
+    class interning_arena {
+        using arena_t = arena<T,block_bits>;
+    public:
+        using handle_t = typename arena_t::handle_t;
+        static constexpr handle_t null_handle = arena_t::null_handle;
+
+        handle_t intern(const T& value) {
+            if ((_elements.size() + 1) * 2 > _table.size()) {
+                grow();
+            }
+            auto mask = _table.size() - 1;
+            for (auto i = Hash{}(value) & mask; ; i = (i + 1) & mask) {
+                auto handle = _table[i];
+                if (handle == null_handle) {
+                    handle = _elements.emplace(value);
+                    _table[i] = handle;
+                    return handle;
+                }
+                if (Equal{}(_elements[handle], value)) {
+                    return handle;
+                }
+            }
+        }
+
+        [[nodiscard]] const T& operator[](handle_t handle) const { return _elements[handle]; }
+        [[nodiscard]] size_t size() const { return _elements.size(); }
+        [[nodiscard]] bool empty() const { return _elements.empty(); }
+        [[nodiscard]] size_t memory_usage() const {
+            return _elements.memory_usage() + _table.capacity() * sizeof(handle_t);
+        }
+
+    private:
+        void grow() {
+            std::vector<handle_t> table(std::max<size_t>(16, _table.size() * 2), null_handle);
+            auto mask = table.size() - 1;
+            for (handle_t handle = 0; handle < _elements.size(); ++handle) {
+                auto i = Hash{}(_elements[handle]) & mask;
+                while (table[i] != null_handle) {
+                    i = (i + 1) & mask;
+                }
+                table[i] = handle;
+            }
+            _table = std::move(table);
+        }
+
+        arena_t _elements;
+        std::vector<handle_t> _table;
+    };
+
+}
+
+#endif //PDAAAL_ARENA_H
@@ -0,0 +1,159 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_BUDGET_H
+#define PDAAAL_BUDGET_H
+
+#include <pdaaal/utils/stop_token.h>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <ostream>
+
+namespace pdaaal {
+
+    // The answer of a reachability query that is run with a budget.
+    enum class Reachability { NotReachable, Reachable, Unknown };
+
+    // Limits for a solver run: wall-clock time, number of saturation steps, approximate memory used by the solver
+    // (edge sets and trace information), and a stop_token for cooperative cancellation.
+    // The solvers call allow_step() once per step of their saturation loop and stop (without an answer) when it returns false.
+    // The stop_token and step limit are checked on every step, while the clock and memory are only checked every check_interval steps.
+    // A default constructed budget is unlimited. The counters are mutable, so a budget can be passed (also as a temporary) by const reference.
+    class budget {
+    public:
+        enum class limit_t { none, stopped, time, steps, memory };
+        using clock = std::chrono::steady_clock;
+        static constexpr size_t check_interval = 1024;
+
+        budget() = default;
+        budget(stop_token stop) : _stop(std::move(stop)) {} // Implicit, so a stop_token can be given where a budget is expected.
+        budget(const budget& other)  // Copies the limits (and deadline), but not the state of the run.
+        : _stop(other._stop), _deadline(other._deadline), _has_deadline(other._has_deadline),
+          _max_steps(other._max_steps), _max_bytes(other._max_bytes) {}
+        budget& operator=(const budget&) = delete;
+
+        // The time limit is measured from this call.
+        budget& set_time_limit(clock::duration time_limit) {
+            _deadline = clock::now() + time_limit;
+            _has_deadline = true;
+            return *this;
+        }
+        budget& set_time_limit(double seconds) {
+            return set_time_limit(std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds)));
+        }
+        budget& set_step_limit(size_t steps) {
+            _max_steps = steps;
+            return *this;
+        }
+        budget& set_memory_limit(size_t bytes) {
+            _max_bytes = bytes;
+            return *this;
+        }
+        budget& set_stop_token(stop_token stop) {
+            _stop = std::move(stop);
+            return *this;
+        }
+        // Same limits (and deadline), but with another stop_token. Used to run several solvers within the same budget.
+        [[nodiscard]] budget with_stop_token(stop_token stop) const {
+            budget b(*this);
+            b._stop = std::move(stop);
+            return b;
+        }
+
+        // Counts one step. Returns false if the budget is exceeded. memory_usage() is only called when a memory limit is set.
+        // Not thread-safe. Parallel solvers should use allow_steps.
+        template <typename MemoryFn>
+        bool allow_step(MemoryFn&& memory_usage) const {
+            if (_stop.stop_requested()) return exceed(limit_t::stopped);
+            auto steps = _steps.load(std::memory_order_relaxed) + 1;
+            _steps.store(steps, std::memory_order_relaxed);
+            if (steps > _max_steps) return exceed(limit_t::steps);
+            if (steps % check_interval == 0) return check(memory_usage);
+            return _exceeded.load(std::memory_order_relaxed) == limit_t::none;
+        }
+        bool allow_step() const {
+            return allow_step([]() -> size_t { return 0; });
+        }
+        // Counts n steps at once. Thread-safe (when memory_usage is).
+        template <typename MemoryFn>
+        bool allow_steps(size_t n, MemoryFn&& memory_usage) const {
+            if (_stop.stop_requested()) return exceed(limit_t::stopped);
+            auto before = _steps.fetch_add(n, std::memory_order_relaxed);
+            auto steps = before + n;
+            if (steps > _max_steps) return exceed(limit_t::steps);
+            if (steps / check_interval != before / check_interval) return check(memory_usage);
+            return _exceeded.load(std::memory_order_relaxed) == limit_t::none;
+        }
+
+        [[nodiscard]] bool exceeded() const { return _exceeded.load() != limit_t::none; }
+        [[nodiscard]] limit_t reason() const { return _exceeded.load(); }
+        [[nodiscard]] size_t steps() const { return _steps.load(); }
+        [[nodiscard]] bool limited() const {
+            return _stop.stop_possible() || _has_deadline || _max_steps != std::numeric_limits<size_t>::max() || _max_bytes != std::numeric_limits<size_t>::max();
+        }
+
+        // A positive answer is always correct, since the saturation procedures only add edges for reachable configurations.
+        // A negative answer is only correct if the budget was not exceeded.
+        [[nodiscard]] Reachability result(bool answer) const {
+            return answer ? Reachability::Reachable : (exceeded() ? Reachability::Unknown : Reachability::NotReachable);
+        }
+
+    private:
+        template <typename MemoryFn>
+        bool check(MemoryFn&& memory_usage) const {
+            if (_has_deadline && clock::now() > _deadline) return exceed(limit_t::time);
+            if (_max_bytes != std::numeric_limits<size_t>::max() && memory_usage() > _max_bytes) return exceed(limit_t::memory);
+            return _exceeded.load(std::memory_order_relaxed) == limit_t::none;
+        }
+        bool exceed(limit_t reason) const {
+            auto expected = limit_t::none;
+            _exceeded.compare_exchange_strong(expected, reason);
+            return false;
+        }
+
+        stop_token _stop;
+        clock::time_point _deadline;
+        bool _has_deadline = false;
+        size_t _max_steps = std::numeric_limits<size_t>::max();
+        size_t _max_bytes = std::numeric_limits<size_t>::max();
+        mutable std::atomic<size_t> _steps{0};
+        mutable std::atomic<limit_t> _exceeded{limit_t::none};
+    };
+
+    inline std::ostream& operator<<(std::ostream& s, budget::limit_t limit) {
+        switch (limit) {
+            case budget::limit_t::none:
+                s << "none";
+                break;
+            case budget::limit_t::stopped:
+                s << "stopped";
+                break;
+            case budget::limit_t::time:
+                s << "time limit";
+                break;
+            case budget::limit_t::steps:
+                s << "step limit";
+                break;
+            case budget::limit_t::memory:
+                s << "memory limit";
+                break;
+        }
+        return s;
+    }
+
+}
+
+#endif //PDAAAL_BUDGET_H
@@ -0,0 +1,103 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_DUAL_SCHEDULER_H
+#define PDAAAL_DUAL_SCHEDULER_H
+
+#include <array>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace pdaaal {
+
+    // How dual* divides the work between its post* and pre* saturation.
+    //  - Alternate: one post* step, then one pre* step.
+    //  - Frontier:  a step in the direction with the smaller workset.
+    //  - Edges:     a step in the direction that has done the least work so far, where the work is the number of steps plus inserted edges.
+    // With Edges, a direction that is cheap on the instance does correspondingly more steps. Since the directions get the same
+    // amount of work, dual* then does at most about twice the work of the cheaper direction (not counting the product construction).
+    // The work is counted and not timed, since the time of the product construction in one direction mostly depends on the size of the
+    // automaton in the other direction. It also makes the search (and so the trace) deterministic.
+    enum class Dual_Policy { Alternate, Frontier, Edges };
+
+    inline std::istream& operator>>(std::istream& in, Dual_Policy& policy) {
+        std::string token;
+        in >> token;
+        if (token == "alternate") {
+            policy = Dual_Policy::Alternate;
+        } else if (token == "frontier") {
+            policy = Dual_Policy::Frontier;
+        } else if (token == "edges") {
+            policy = Dual_Policy::Edges;
+        } else {
+            in.setstate(std::ios_base::failbit);
+        }
+        return in;
+    }
+    inline std::ostream& operator<<(std::ostream& s, Dual_Policy policy) {
+        switch (policy) {
+            case Dual_Policy::Alternate:
+                s << "alternate";
+                break;
+            case Dual_Policy::Frontier:
+                s << "frontier";
+                break;
+            case Dual_Policy::Edges:
+                s << "edges";
+                break;
+        }
+        return s;
+    }
+
+    // Chooses the direction of the next step in dual*, and keeps track of the work done in each direction.
+    class dual_scheduler {
+    public:
+        enum direction_t { post = 0, pre = 1 };
+
+        explicit dual_scheduler(Dual_Policy policy = Dual_Policy::Alternate) : _policy(policy) {}
+
+        [[nodiscard]] direction_t next(size_t post_workset_size, size_t pre_workset_size) {
+            switch (_policy) {
+                case Dual_Policy::Alternate:
+                    return _last = (_last == post ? pre : post);
+                case Dual_Policy::Frontier:
+                    return _last = (pre_workset_size < post_workset_size ? pre : post);
+                case Dual_Policy::Edges:
+                    return _last = (_steps[pre] + _edges[pre] < _steps[post] + _edges[post] ? pre : post);
+            }
+            return post;
+        }
+        // Records a step and the number of edges it inserted.
+        void record(direction_t direction, size_t new_edges) {
+            ++_steps[direction];
+            _edges[direction] += new_edges;
+        }
+
+        [[nodiscard]] Dual_Policy policy() const { return _policy; }
+        [[nodiscard]] size_t steps(direction_t direction) const { return _steps[direction]; }
+        [[nodiscard]] size_t edges(direction_t direction) const { return _edges[direction]; }
+
+    private:
+        Dual_Policy _policy;
+        direction_t _last = pre; // So Alternate starts with post*.
+        std::array<size_t,2> _steps{0, 0};
+        std::array<size_t,2> _edges{0, 0};
+    };
+
+}
+
+#endif //PDAAAL_DUAL_SCHEDULER_H
@@ -0,0 +1,319 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_EDGE_SET_H
+#define PDAAAL_EDGE_SET_H
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <tuple>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <unordered_map>
+#include <absl/hash/hash.h>
+
+// Sets (and maps) of automaton edges (from, label, to) used by the saturation algorithms to deduplicate edges.
+// All variants are constructed from the number of automaton states and the number of (non-epsilon) labels,
+// and accept the epsilon label std::numeric_limits<uint32_t>::max() and the wildcard label std::numeric_limits<uint32_t>::max()-1
+// in addition to the labels [0, n_labels).
+//  - packed_edge_set / packed_edge_map: Flat open-addressing table over a 64-bit key packed from (from, label, to).
+//  - dense_edge_set: One bit per possible edge. Only suitable for small automata.
+//  - hash_edge_set / hash_edge_map: Node-based std::unordered_set / std::unordered_map.
+
+namespace pdaaal {
+
+    namespace details {
+        constexpr uint32_t edge_set_epsilon = std::numeric_limits<uint32_t>::max();
+        constexpr uint32_t edge_set_wildcard = std::numeric_limits<uint32_t>::max() - 1;
+
+        // Maps (from, label, to) to a unique number in [0, n_states * (n_labels+2) * n_states).
+        // Epsilon is mapped to label n_labels and wildcard to label n_labels+1.
+        class edge_key_packer {
+        public:
+            edge_key_packer() = default;
+            edge_key_packer(size_t n_states, size_t n_labels) : _n_states(n_states), _n_labels(n_labels) {
+                constexpr auto max = std::numeric_limits<uint64_t>::max() - 1; // Reserve max() for empty slots.
+                auto n_labels_special = n_labels + 2;
+                _fits = n_states == 0 || (n_labels_special <= max / n_states && n_states * n_labels_special <= max / n_states);
+            }
+            [[nodiscard]] bool fits() const { return _fits; }
+            [[nodiscard]] uint64_t size() const { return (uint64_t)_n_states * (_n_labels + 2) * _n_states; }
+            [[nodiscard]] uint64_t pack(size_t from, uint32_t label, size_t to) const {
+                assert(from < _n_states && to < _n_states && (label < _n_labels || label == edge_set_epsilon || label == edge_set_wildcard));
+                uint64_t l = label < _n_labels ? label : (label == edge_set_epsilon ? _n_labels : _n_labels + 1);
+                return ((uint64_t)from * (_n_labels + 2) + l) * _n_states + to;
+            }
+            [[nodiscard]] std::tuple<size_t,uint32_t,size_t> unpack(uint64_t key) const {
+                size_t to = key % _n_states;
+                key /= _n_states;
+                auto l = key % (_n_labels + 2);
+                return {key / (_n_labels + 2), l < _n_labels ? (uint32_t)l : (l == _n_labels ? edge_set_epsilon : edge_set_wildcard), to};
+            }
+        private:
+            size_t _n_states = 0;
+            size_t _n_labels = 0;
+            bool _fits = true;
+        };
+
+        struct empty_value_t {};
+    }
+
+    // Open-addressing hash table (linear probing) over packed 64-bit keys. Value = void gives a set.
+    // If the number of states and labels is too large for the key to fit in 64 bits, a node-based table is used instead.
+    template <typename Value = void>
+    class packed_edge_table {
+        static constexpr bool is_map = !std::is_void_v<Value>;
+        using value_t = std::conditional_t<is_map, Value, details::empty_value_t>;
+        using wide_key_t = std::tuple<size_t,uint32_t,size_t>;
+        static constexpr uint64_t empty_key = std::numeric_limits<uint64_t>::max();
+        static constexpr size_t initial_capacity = 16;
+    public:
+        packed_edge_table() = default;
+        packed_edge_table(size_t n_states, size_t n_labels) : _packer(n_states, n_labels) {}
+
+        // Returns a pointer to the value of the edge (nullptr for sets), and whether the edge was inserted.
+        // The pointer is invalidated by the next insertion.
+        std::pair<value_t*,bool> emplace(size_t from, uint32_t label, size_t to, value_t value = value_t{}) {
+            if (!_packer.fits()) {
+                auto res = _wide.emplace(wide_key_t{from, label, to}, std::move(value));
+                return {&res.first->second, res.second};
+            }
+            if ((_size + 1) * 4 > _keys.size() * 3) { // Max load factor 0.75
+                grow();
+            }
+            auto key = _packer.pack(from, label, to);
+            auto i = find_slot(key);
+            if (_keys[i] == key) {
+                return {value_ptr(i), false};
+            }
+            _keys[i] = key;
+            if constexpr (is_map) {
+                _values[i] = std::move(value);
+            }
+            ++_size;
+            return {value_ptr(i), true};
+        }
+        [[nodiscard]] bool contains(size_t from, uint32_t label, size_t to) const {
+            if (!_packer.fits()) {
+                return _wide.find(wide_key_t{from, label, to}) != _wide.end();
+            }
+            if (_keys.empty()) return false;
+            auto key = _packer.pack(from, label, to);
+            return _keys[find_slot(key)] == key;
+        }
+        template <bool M = is_map, typename = std::enable_if_t<M>>
+        [[nodiscard]] value_t* find(size_t from, uint32_t label, size_t to) {
+            if (!_packer.fits()) {
+                auto it = _wide.find(wide_key_t{from, label, to});
+                return it == _wide.end() ? nullptr : &it->second;
+            }
+            if (_keys.empty()) return nullptr;
+            auto key = _packer.pack(from, label, to);
+            auto i = find_slot(key);
+            return _keys[i] == key ? &_values[i] : nullptr;
+        }
+        template <bool M = is_map, typename = std::enable_if_t<M>>
+        [[nodiscard]] const value_t* find(size_t from, uint32_t label, size_t to) const {
+            return const_cast<packed_edge_table*>(this)->find(from, label, to);
+        }
+        [[nodiscard]] size_t size() const {
+            return _packer.fits() ? _size : _wide.size();
+        }
+        [[nodiscard]] bool empty() const { return size() == 0; }
+
+        // Calls fn(from, label, to) (or fn(from, label, to, value) for maps) for each edge in unspecified order.
+        template <typename Fn>
+        void for_each(Fn&& fn) const {
+            if (!_packer.fits()) {
+                for (const auto& [key, value] : _wide) {
+                    call(fn, std::get<0>(key), std::get<1>(key), std::get<2>(key), value);
+                }
+                return;
+            }
+            for (size_t i = 0; i < _keys.size(); ++i) {
+                if (_keys[i] != empty_key) {
+                    auto [from, label, to] = _packer.unpack(_keys[i]);
+                    if constexpr (is_map) {
+                        call(fn, from, label, to, _values[i]);
+                    } else {
+                        call(fn, from, label, to, value_t{});
+                    }
+                }
+            }
+        }
+        [[nodiscard]] size_t memory_usage() const {
+            return _keys.capacity() * sizeof(uint64_t) + (is_map ? _values.capacity() * sizeof(value_t) : 0)
+                 + _wide.size() * (sizeof(wide_key_t) + sizeof(value_t) + 2 * sizeof(void*));
+        }
+
+    private:
+        details::edge_key_packer _packer;
+        std::vector<uint64_t> _keys;
+        std::vector<std::conditional_t<is_map, value_t, char>> _values;
+        size_t _size = 0;
+        std::unordered_map<wide_key_t, value_t, absl::Hash<wide_key_t>> _wide;
+
+        template <typename Fn, typename V>
+        static void call(Fn& fn, size_t from, uint32_t label, size_t to, V&& value) {
+            if constexpr (is_map) {
+                fn(from, label, to, std::forward<V>(value));
+            } else {
+                fn(from, label, to);
+            }
+        }
+        static uint64_t hash(uint64_t key) {
+            // Finalizer of splitmix64. Consecutive keys (e.g. same from and label) are spread over the table.
+            key ^= key >> 30; key *= 0xbf58476d1ce4e5b9ULL;
+            key ^= key >> 27; key *= 0x94d049bb133111ebULL;
+            key ^= key >> 31;
+            return key;
+        }
+        [[nodiscard]] size_t find_slot(uint64_t key) const {
+            assert(!_keys.empty());
+            size_t mask = _keys.size() - 1;
+            size_t i = hash(key) & mask;
+            while (_keys[i] != key && _keys[i] != empty_key) {
+                i = (i + 1) & mask;
+            }
+            return i;
+        }
+        value_t* value_ptr(size_t i) {
+            if constexpr (is_map) {
+                return &_values[i];
+            } else {
+                return nullptr;
+            }
+        }
+        void grow() {
+            auto old_keys = std::move(_keys);
+            auto old_values = std::move(_values);
+            auto capacity = old_keys.empty() ? initial_capacity : 2 * old_keys.size();
+            _keys.assign(capacity, empty_key);
+            if constexpr (is_map) {
+                _values.resize(capacity);
+            }
+            for (size_t j = 0; j < old_keys.size(); ++j) {
+                if (old_keys[j] == empty_key) continue;
+                auto i = find_slot(old_keys[j]);
+                _keys[i] = old_keys[j];
+                if constexpr (is_map) {
+                    _values[i] = std::move(old_values[j]);
+                }
+            }
+        }
+    };
+    using packed_edge_set = packed_edge_table<void>;
+    template <typename Value> using packed_edge_map = packed_edge_table<Value>;
+
+    // One bit for each possible edge. Memory is n_states^2 * (n_labels+2) bits, so this is for small automata only.
+    class dense_edge_set {
+    public:
+        static constexpr uint64_t max_bits = uint64_t(1) << 32; // 512 MB
+        dense_edge_set() = default;
+        dense_edge_set(size_t n_states, size_t n_labels) : _packer(n_states, n_labels) {
+            if (!_packer.fits() || _packer.size() > max_bits) {
+                throw std::runtime_error("dense_edge_set: Automaton is too large for a dense edge set.");
+            }
+            _bits.resize((_packer.size() + 63) / 64, 0);
+        }
+
+        std::pair<details::empty_value_t*,bool> emplace(size_t from, uint32_t label, size_t to, details::empty_value_t = {}) {
+            auto key = _packer.pack(from, label, to);
+            auto& word = _bits[key / 64];
+            auto bit = uint64_t(1) << (key % 64);
+            if (word & bit) {
+                return {nullptr, false};
+            }
+            word |= bit;
+            ++_size;
+            return {nullptr, true};
+        }
+        [[nodiscard]] bool contains(size_t from, uint32_t label, size_t to) const {
+            auto key = _packer.pack(from, label, to);
+            return (_bits[key / 64] >> (key % 64)) & 1;
+        }
+        [[nodiscard]] size_t size() const { return _size; }
+        [[nodiscard]] bool empty() const { return _size == 0; }
+        template <typename Fn>
+        void for_each(Fn&& fn) const {
+            for (size_t w = 0; w < _bits.size(); ++w) {
+                for (auto word = _bits[w]; word != 0; word &= word - 1) {
+                    auto [from, label, to] = _packer.unpack(w * 64 + __builtin_ctzll(word));
+                    fn(from, label, to);
+                }
+            }
+        }
+        [[nodiscard]] size_t memory_usage() const {
+            return _bits.capacity() * sizeof(uint64_t);
+        }
+    private:
+        details::edge_key_packer _packer;
+        std::vector<uint64_t> _bits;
+        size_t _size = 0;
+    };
+
+    // The node-based tables, mainly for comparison.
+    template <typename Value = void>
+    class hash_edge_table {
+        static constexpr bool is_map = !std::is_void_v<Value>;
+        using value_t = std::conditional_t<is_map, Value, details::empty_value_t>;
+        using key_t = std::tuple<size_t,uint32_t,size_t>;
+    public:
+        hash_edge_table() = default;
+        hash_edge_table(size_t, size_t) {}
+
+        std::pair<value_t*,bool> emplace(size_t from, uint32_t label, size_t to, value_t value = value_t{}) {
+            auto res = _map.emplace(key_t{from, label, to}, std::move(value));
+            return {&res.first->second, res.second};
+        }
+        [[nodiscard]] bool contains(size_t from, uint32_t label, size_t to) const {
+            return _map.find(key_t{from, label, to}) != _map.end();
+        }
+        template <bool M = is_map, typename = std::enable_if_t<M>>
+        [[nodiscard]] value_t* find(size_t from, uint32_t label, size_t to) {
+            auto it = _map.find(key_t{from, label, to});
+            return it == _map.end() ? nullptr : &it->second;
+        }
+        template <bool M = is_map, typename = std::enable_if_t<M>>
+        [[nodiscard]] const value_t* find(size_t from, uint32_t label, size_t to) const {
+            return const_cast<hash_edge_table*>(this)->find(from, label, to);
+        }
+        [[nodiscard]] size_t size() const { return _map.size(); }
+        [[nodiscard]] bool empty() const { return _map.empty(); }
+        template <typename Fn>
+        void for_each(Fn&& fn) const {
+            for (const auto& [key, value] : _map) {
+                if constexpr (is_map) {
+                    fn(std::get<0>(key), std::get<1>(key), std::get<2>(key), value);
+                } else {
+                    fn(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+                }
+            }
+        }
+        [[nodiscard]] size_t memory_usage() const {
+            return _map.bucket_count() * sizeof(void*) + _map.size() * (sizeof(key_t) + sizeof(value_t) + 2 * sizeof(void*));
+        }
+    private:
+        std::unordered_map<key_t, value_t, absl::Hash<key_t>> _map;
+    };
+    using hash_edge_set = hash_edge_table<void>;
+    template <typename Value> using hash_edge_map = hash_edge_table<Value>;
+
+}
+
+#endif //PDAAAL_EDGE_SET_H
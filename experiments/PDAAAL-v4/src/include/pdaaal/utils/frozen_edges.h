@@ -0,0 +1,208 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_FROZEN_EDGES_H
+#define PDAAAL_FROZEN_EDGES_H
+
+#include <pdaaal/utils/vector_set.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace pdaaal {
+
+    // Read-only edges of an automaton in compressed sparse row (CSR) layout: from -> (to -> (label -> value)).
+    // The outgoing edges of a state are grouped by target state, and each group has a sorted range of labels with a parallel range of values.
+    // Groups keep the order in which they were added, so an algorithm explores edges in the same order as on the automaton it was built from.
+    // The views mimic the fut::set containers used by PAutomaton, so read-only algorithms can be written once for both representations.
+    template <typename Value>
+    class frozen_edges {
+    public:
+        using value_type = typename fut::vector_map<uint32_t,Value>::value_type; // Same element type as the labels of a fut::set edge.
+
+        // The labels (and values) of the edges between two states.
+        class labels_view {
+        public:
+            using value_type = frozen_edges::value_type;
+            class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = frozen_edges::value_type;
+                using difference_type = std::ptrdiff_t;
+                using reference = value_type;
+                struct pointer {
+                    value_type _elem;
+                    const value_type* operator->() const { return &_elem; }
+                };
+
+                iterator() = default;
+                iterator(const uint32_t* label, const Value* value) : _label(label), _value(value) {};
+
+                value_type operator*() const { return value_type(*_label, *_value); }
+                pointer operator->() const { return pointer{**this}; }
+                iterator& operator++() {
+                    ++_label;
+                    ++_value;
+                    return *this;
+                }
+                iterator operator++(int) {
+                    auto copy = *this;
+                    ++(*this);
+                    return copy;
+                }
+                bool operator==(const iterator& other) const { return _label == other._label; }
+                bool operator!=(const iterator& other) const { return _label != other._label; }
+            private:
+                const uint32_t* _label = nullptr;
+                const Value* _value = nullptr;
+            };
+            using const_iterator = iterator;
+
+            labels_view(const uint32_t* labels, const Value* values, size_t size) : _labels(labels), _values(values), _size(size) {};
+
+            [[nodiscard]] iterator begin() const { return iterator(_labels, _values); }
+            [[nodiscard]] iterator end() const { return iterator(_labels + _size, _values + _size); }
+            [[nodiscard]] size_t size() const { return _size; }
+            [[nodiscard]] bool empty() const { return _size == 0; }
+            [[nodiscard]] value_type operator[](size_t index) const {
+                assert(index < _size);
+                return value_type(_labels[index], _values[index]);
+            }
+
+            [[nodiscard]] bool contains(uint32_t label) const {
+                return index_of(label) != _size;
+            }
+            [[nodiscard]] const Value* get(uint32_t label) const {
+                auto i = index_of(label);
+                return i == _size ? nullptr : _values + i;
+            }
+            [[nodiscard]] iterator find(uint32_t label) const {
+                auto i = index_of(label);
+                return iterator(_labels + i, _values + i);
+            }
+        private:
+            [[nodiscard]] size_t index_of(uint32_t label) const {
+                auto lb = std::lower_bound(_labels, _labels + _size, label);
+                return (lb != _labels + _size && *lb == label) ? lb - _labels : _size;
+            }
+            const uint32_t* _labels;
+            const Value* _values;
+            size_t _size;
+        };
+
+        // The outgoing edges of one state as a range of (to, labels) pairs.
+        class edges_view {
+        public:
+            class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::pair<size_t, labels_view>;
+                using difference_type = std::ptrdiff_t;
+                using reference = value_type;
+                using pointer = void;
+
+                iterator(const frozen_edges* edges, uint32_t group) : _edges(edges), _group(group) {};
+
+                value_type operator*() const { return std::make_pair(size_t(_edges->_group_to[_group]), _edges->group_labels(_group)); }
+                iterator& operator++() {
+                    ++_group;
+                    return *this;
+                }
+                bool operator==(const iterator& other) const { return _group == other._group; }
+                bool operator!=(const iterator& other) const { return _group != other._group; }
+            private:
+                const frozen_edges* _edges;
+                uint32_t _group;
+            };
+
+            edges_view(const frozen_edges* edges, uint32_t begin, uint32_t end) : _edges(edges), _begin(begin), _end(end) {};
+
+            [[nodiscard]] iterator begin() const { return iterator(_edges, _begin); }
+            [[nodiscard]] iterator end() const { return iterator(_edges, _end); }
+            [[nodiscard]] size_t size() const { return _end - _begin; }
+            [[nodiscard]] bool empty() const { return _begin == _end; }
+        private:
+            const frozen_edges* _edges;
+            uint32_t _begin;
+            uint32_t _end;
+        };
+
+        [[nodiscard]] size_t number_of_states() const { return _state_offsets.size() - 1; }
+        [[nodiscard]] size_t number_of_edges() const { return _labels.size(); }
+
+        [[nodiscard]] edges_view edges(size_t state) const {
+            assert(state < number_of_states());
+            return edges_view(this, _state_offsets[state], _state_offsets[state + 1]);
+        }
+        [[nodiscard]] const Value* get(size_t from, size_t to, uint32_t label) const {
+            assert(from < number_of_states());
+            auto begin = _group_to.begin() + _state_offsets[from];
+            auto end = _group_to.begin() + _state_offsets[from + 1];
+            auto it = std::find(begin, end, to);
+            if (it == end) return nullptr;
+            return group_labels(it - _group_to.begin()).get(label);
+        }
+
+        // Construction. The edges of each state are added grouped by target state and in label order, and then the state is closed by end_state().
+        void add_edge(size_t to, uint32_t label, const Value& value) {
+            if (_labels.size() == std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("frozen_edges: More than 2^32-1 edges.");
+            }
+            if (_group_to.size() == _state_offsets.back() || _group_to.back() != to) { // First edge of the state, or a new target state.
+                _group_to.push_back(static_cast<uint32_t>(to));
+                _group_offsets.push_back(_group_offsets.back());
+            }
+            assert(_group_offsets.back() == _group_offsets[_group_offsets.size() - 2] || _labels.back() < label);
+            _labels.push_back(label);
+            _values.push_back(value);
+            ++_group_offsets.back();
+        }
+        void end_state() {
+            _state_offsets.push_back(static_cast<uint32_t>(_group_to.size()));
+        }
+        void shrink_to_fit() {
+            _state_offsets.shrink_to_fit();
+            _group_to.shrink_to_fit();
+            _group_offsets.shrink_to_fit();
+            _labels.shrink_to_fit();
+            _values.shrink_to_fit();
+        }
+
+        [[nodiscard]] size_t memory_usage() const {
+            return (_state_offsets.capacity() + _group_to.capacity() + _group_offsets.capacity() + _labels.capacity()) * sizeof(uint32_t)
+                 + _values.capacity() * sizeof(Value);
+        }
+
+    private:
+        [[nodiscard]] labels_view group_labels(size_t group) const {
+            auto begin = _group_offsets[group];
+            return labels_view(_labels.data() + begin, _values.data() + begin, _group_offsets[group + 1] - begin);
+        }
+
+        std::vector<uint32_t> _state_offsets{0}; // Edges of state s are the groups [_state_offsets[s], _state_offsets[s+1]).
+        std::vector<uint32_t> _group_to;         // Target state of each group.
+        std::vector<uint32_t> _group_offsets{0}; // Labels of group g are [_group_offsets[g], _group_offsets[g+1]).
+        std::vector<uint32_t> _labels;
+        std::vector<Value> _values;             // Parallel to _labels.
+    };
+
+}
+
+#endif //PDAAAL_FROZEN_EDGES_H
@@ -0,0 +1,206 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_INDEXED_HEAP_H
+#define PDAAAL_INDEXED_HEAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Min-priority queues over element ids with decrease-key, used by the Dijkstra searches for shortest traces.
+// Ids are small integers (indices into an array of the caller), and the queues grow to fit the largest id pushed.
+// push(id, key) inserts id, or lowers its key if key is smaller (and otherwise does nothing). It returns whether the key was set.
+// pop() removes and returns an id with the smallest key, together with that key. An id can be pushed again after it is popped.
+//  - indexed_dary_heap:  D-ary heap with a position index, so decrease-key moves the element instead of adding a duplicate.
+//  - indexed_radix_heap: Monotone radix heap for unsigned integer keys. Keys are put in buckets by the highest bit in which they
+//                        differ from the last popped key, so a push is O(1) and each element is moved at most once per bit.
+
+namespace pdaaal {
+
+    template <typename Key, typename Less = std::less<Key>, size_t D = 4>
+    class indexed_dary_heap {
+        static_assert(D >= 2);
+        static constexpr size_t npos = std::numeric_limits<size_t>::max();
+    public:
+        explicit indexed_dary_heap(Less less = Less()) : _less(std::move(less)) {}
+
+        bool push(size_t id, const Key& key) {
+            if (id >= _pos.size()) {
+                _pos.resize(id + 1, npos);
+                _keys.resize(id + 1);
+            }
+            if (_pos[id] == npos) {
+                _keys[id] = key;
+                _pos[id] = _heap.size();
+                _heap.push_back(id);
+            } else if (_less(key, _keys[id])) {
+                _keys[id] = key;
+            } else {
+                return false;
+            }
+            sift_up(_pos[id]);
+            return true;
+        }
+        std::pair<size_t,Key> pop() {
+            assert(!_heap.empty());
+            auto id = _heap.front();
+            _pos[id] = npos;
+            auto last = _heap.back();
+            _heap.pop_back();
+            if (!_heap.empty()) {
+                _heap.front() = last;
+                _pos[last] = 0;
+                sift_down(0);
+            }
+            return {id, std::move(_keys[id])};
+        }
+        [[nodiscard]] bool contains(size_t id) const { return id < _pos.size() && _pos[id] != npos; }
+        [[nodiscard]] bool empty() const { return _heap.empty(); }
+        [[nodiscard]] size_t size() const { return _heap.size(); }
+
+    private:
+        Less _less;
+        std::vector<size_t> _heap; // Ids.
+        std::vector<size_t> _pos;  // Position of each id in _heap, or npos.
+        std::vector<Key> _keys;
+
+        void place(size_t i, size_t id) {
+            _heap[i] = id;
+            _pos[id] = i;
+        }
+        void sift_up(size_t i) {
+            auto id = _heap[i];
+            while (i > 0) {
+                auto parent = (i - 1) / D;
+                if (!_less(_keys[id], _keys[_heap[parent]])) break;
+                place(i, _heap[parent]);
+                i = parent;
+            }
+            place(i, id);
+        }
+        void sift_down(size_t i) {
+            auto id = _heap[i];
+            while (true) {
+                auto first = i * D + 1;
+                if (first >= _heap.size()) break;
+                auto last = std::min(first + D, _heap.size());
+                auto best = first;
+                for (auto c = first + 1; c < last; ++c) {
+                    if (_less(_keys[_heap[c]], _keys[_heap[best]])) best = c;
+                }
+                if (!_less(_keys[_heap[best]], _keys[id])) break;
+                place(i, _heap[best]);
+                i = best;
+            }
+            place(i, id);
+        }
+    };
+
+    // The keys should be monotone: At least the key of the last pop. A smaller key is still accepted, and is popped next
+    // (or after other keys equal to the last pop), so the order is only approximate in that case.
+    // Decrease-key adds an entry for the new key, and the old entry is skipped when it reaches the front.
+    template <typename Key>
+    class indexed_radix_heap {
+        static_assert(std::is_unsigned_v<Key> && sizeof(Key) <= sizeof(unsigned long long));
+        static constexpr size_t n_buckets = std::numeric_limits<Key>::digits + 1;
+    public:
+        bool push(size_t id, Key key) {
+            if (id >= _keys.size()) {
+                _keys.resize(id + 1);
+                _queued.resize(id + 1, false);
+            }
+            if (!_queued[id]) {
+                _queued[id] = true;
+                ++_size;
+            } else if (key >= _keys[id]) {
+                return false;
+            }
+            _keys[id] = key;
+            _buckets[bucket(key)].emplace_back(key, id);
+            return true;
+        }
+        std::pair<size_t,Key> pop() {
+            assert(_size > 0);
+            while (true) {
+                if (_buckets[0].empty()) {
+                    refill();
+                }
+                auto [key, id] = _buckets[0].back();
+                _buckets[0].pop_back();
+                if (is_live(key, id)) {
+                    _queued[id] = false;
+                    --_size;
+                    return {id, key};
+                }
+            }
+        }
+        [[nodiscard]] bool contains(size_t id) const { return id < _queued.size() && _queued[id]; }
+        [[nodiscard]] bool empty() const { return _size == 0; }
+        [[nodiscard]] size_t size() const { return _size; }
+
+    private:
+        std::vector<std::pair<Key,size_t>> _buckets[n_buckets];
+        std::vector<Key> _keys;
+        std::vector<bool> _queued;
+        Key _last = 0;
+        size_t _size = 0;
+
+        [[nodiscard]] size_t bucket(Key key) const {
+            if (key <= _last) return 0;
+            return std::numeric_limits<unsigned long long>::digits - __builtin_clzll(static_cast<unsigned long long>(key ^ _last));
+        }
+        [[nodiscard]] bool is_live(Key key, size_t id) const {
+            return _queued[id] && _keys[id] == key;
+        }
+        // Moves the entries of the first non-empty bucket to smaller buckets, relative to their smallest key.
+        void refill() {
+            for (size_t i = 1; i < n_buckets; ++i) {
+                auto& entries = _buckets[i];
+                if (entries.empty()) continue;
+                auto min = std::numeric_limits<Key>::max();
+                bool any_live = false;
+                for (const auto& [key, id] : entries) {
+                    if (is_live(key, id)) {
+                        min = std::min(min, key);
+                        any_live = true;
+                    }
+                }
+                if (!any_live) {
+                    entries.clear();
+                    continue;
+                }
+                _last = min;
+                for (const auto& [key, id] : entries) {
+                    if (is_live(key, id)) {
+                        _buckets[bucket(key)].emplace_back(key, id);
+                    }
+                }
+                entries.clear();
+                return;
+            }
+            assert(false); // Only called when there is a live entry.
+        }
+    };
+
+}
+
+#endif //PDAAAL_INDEXED_HEAP_H
@@ -0,0 +1,282 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_SCC_FIXED_POINT_H
+#define PDAAAL_SCC_FIXED_POINT_H
+
+#include <pdaaal/utils/budget.h>
+#include <pdaaal/Weight.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Fixed point of weights given by derivations, solved one strongly connected component (SCC) of the dependency graph at a time.
+// A derivation gives its node a weight: The weight of the derivation plus the weights of its premises (at most two nodes).
+// The weight of a node is the best (by SolverW::less) over its derivations, and a node is unreached until a derivation with reached premises applies.
+// The SCCs are solved in topological order, so the premises outside the SCC being solved already have their final weights.
+// Within an SCC, the derivations are evaluated in rounds, where round k re-evaluates the derivations using nodes that changed in round k-1.
+// After round k, all derivation trees of height at most k+1 inside the SCC are accounted for. A best tree repeats no node on a path unless
+// repeating the part between the two occurrences improves the weight without bound, so if weights still change in round |SCC|,
+// the weights of the SCC are unbounded and become SolverW::bottom(). SolverW::add propagates bottom to the SCCs that depend on it,
+// and SCCs that converge quickly take few rounds, unlike a global round limit.
+// Weights with bounded height (see is_bounded_height in Weight.h) cannot improve without bound, so their rounds continue until no weight changes.
+// If SolverW is not selective (see is_selective in Weight.h), the weight of a node is the SolverW::combine over its derivations instead,
+// and the payload is that of the first derivation that reached the node.
+
+namespace pdaaal {
+
+    template <typename SolverW, typename Payload>
+    class scc_fixed_point {
+    public:
+        using weight_t = typename SolverW::type;
+        static constexpr uint32_t no_node = std::numeric_limits<uint32_t>::max();
+
+        uint32_t add_node() {
+            if (_weights.size() >= no_node) {
+                throw std::runtime_error("Too many nodes (" + std::to_string(_weights.size()) + ") in scc_fixed_point.");
+            }
+            _weights.emplace_back(SolverW::max());
+            _best.push_back(no_derivation);
+            return static_cast<uint32_t>(_weights.size() - 1);
+        }
+        // The payload of the best (or first, see above) derivation of a node is available after run(), e.g. to reconstruct a trace.
+        void add_derivation(uint32_t node, weight_t weight, Payload payload, uint32_t premise1 = no_node, uint32_t premise2 = no_node) {
+            assert(node < size() && (premise1 == no_node || premise1 < size()) && (premise2 == no_node || premise2 < size()));
+            if (_derivations.size() >= no_derivation) {
+                throw std::runtime_error("Too many derivations (" + std::to_string(_derivations.size()) + ") in scc_fixed_point.");
+            }
+            _derivations.push_back(derivation{std::move(weight), std::move(payload), node, {premise1, premise2}});
+        }
+
+        // Computes the weights. Returns false if the budget is exceeded, and then the weights are not final.
+        template <typename MemoryFn>
+        bool run(const budget& limits, MemoryFn&& memory_usage) {
+            index();
+            auto [order, component_offsets] = components();
+            std::vector<uint32_t> component(size());
+            for (uint32_t c = 0; c + 1 < component_offsets.size(); ++c) {
+                for (auto i = component_offsets[c]; i < component_offsets[c + 1]; ++i) {
+                    component[order[i]] = c;
+                }
+            }
+            std::vector<bool> queued(size(), false);
+            for (uint32_t c = 0; c + 1 < component_offsets.size(); ++c) {
+                if (!solve(order.begin() + component_offsets[c], order.begin() + component_offsets[c + 1], c, component, queued, limits, memory_usage)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        bool run(const budget& limits = budget()) {
+            return run(limits, [this](){ return memory_usage(); });
+        }
+
+        [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(_weights.size()); }
+        [[nodiscard]] size_t number_of_derivations() const { return _derivations.size(); }
+        [[nodiscard]] bool reached(uint32_t node) const { return _best[node] != no_derivation; }
+        [[nodiscard]] const weight_t& weight(uint32_t node) const { return _weights[node]; }
+        [[nodiscard]] const Payload& payload(uint32_t node) const {
+            assert(reached(node));
+            return _derivations[_best[node]]._payload;
+        }
+        // Approximate number of bytes used.
+        [[nodiscard]] size_t memory_usage() const {
+            return _weights.capacity() * sizeof(weight_t) + _best.capacity() * sizeof(uint32_t) + _derivations.capacity() * sizeof(derivation)
+                 + (_uses_offsets.capacity() + _uses.capacity() + _into_offsets.capacity() + _into.capacity()) * sizeof(uint32_t);
+        }
+
+    private:
+        static constexpr uint32_t no_derivation = std::numeric_limits<uint32_t>::max();
+        struct derivation {
+            weight_t _weight;
+            Payload _payload;
+            uint32_t _node;
+            std::array<uint32_t,2> _premises;
+        };
+        std::vector<weight_t> _weights;
+        std::vector<uint32_t> _best; // Index of the best (or first) derivation of each node, or no_derivation.
+        std::vector<derivation> _derivations;
+        // The derivations that use each node as premise, and the derivations of each node, as offsets into flat arrays.
+        std::vector<uint32_t> _uses_offsets, _uses;
+        std::vector<uint32_t> _into_offsets, _into;
+
+        void index() {
+            _uses_offsets.assign(size() + 1, 0);
+            _into_offsets.assign(size() + 1, 0);
+            for (const auto& d : _derivations) {
+                ++_into_offsets[d._node + 1];
+                for (auto premise : d._premises) {
+                    if (premise != no_node) ++_uses_offsets[premise + 1];
+                }
+            }
+            for (uint32_t i = 0; i < size(); ++i) {
+                _uses_offsets[i + 1] += _uses_offsets[i];
+                _into_offsets[i + 1] += _into_offsets[i];
+            }
+            _uses.resize(_uses_offsets.back());
+            _into.resize(_into_offsets.back());
+            std::vector<uint32_t> uses_next(_uses_offsets.begin(), _uses_offsets.end() - 1);
+            std::vector<uint32_t> into_next(_into_offsets.begin(), _into_offsets.end() - 1);
+            for (uint32_t i = 0; i < _derivations.size(); ++i) {
+                const auto& d = _derivations[i];
+                _into[into_next[d._node]++] = i;
+                for (auto premise : d._premises) {
+                    if (premise != no_node) _uses[uses_next[premise]++] = i;
+                }
+            }
+        }
+
+        // Tarjan's algorithm (without recursion) on the graph with an edge from each premise to the node of the derivation.
+        // Returns the nodes grouped by SCC, and the offset of each SCC in that order. The SCCs are in topological order.
+        [[nodiscard]] std::pair<std::vector<uint32_t>,std::vector<uint32_t>> components() const {
+            constexpr uint32_t unvisited = std::numeric_limits<uint32_t>::max();
+            std::vector<uint32_t> index(size(), unvisited);
+            std::vector<uint32_t> low(size());
+            std::vector<bool> on_stack(size(), false);
+            std::vector<uint32_t> stack;
+            std::vector<std::pair<uint32_t,uint32_t>> call_stack; // Node and position of the next successor in _uses.
+            std::vector<uint32_t> order;
+            std::vector<uint32_t> component_sizes;
+            order.reserve(size());
+            uint32_t next_index = 0;
+            auto visit = [&](uint32_t node) {
+                index[node] = low[node] = next_index++;
+                stack.push_back(node);
+                on_stack[node] = true;
+                call_stack.emplace_back(node, _uses_offsets[node]);
+            };
+            for (uint32_t root = 0; root < size(); ++root) {
+                if (index[root] != unvisited) continue;
+                visit(root);
+                while (!call_stack.empty()) {
+                    auto [node, pos] = call_stack.back();
+                    if (pos < _uses_offsets[node + 1]) {
+                        ++call_stack.back().second;
+                        auto successor = _derivations[_uses[pos]]._node;
+                        if (index[successor] == unvisited) {
+                            visit(successor);
+                        } else if (on_stack[successor]) {
+                            low[node] = std::min(low[node], index[successor]);
+                        }
+                        continue;
+                    }
+                    call_stack.pop_back();
+                    if (!call_stack.empty()) {
+                        auto parent = call_stack.back().first;
+                        low[parent] = std::min(low[parent], low[node]);
+                    }
+                    if (low[node] == index[node]) {
+                        auto begin = order.size();
+                        uint32_t member;
+                        do {
+                            member = stack.back();
+                            stack.pop_back();
+                            on_stack[member] = false;
+                            order.push_back(member);
+                        } while (member != node);
+                        component_sizes.push_back(static_cast<uint32_t>(order.size() - begin));
+                    }
+                }
+            }
+            // Tarjan finds an SCC after all SCCs reachable from it, so reverse the order.
+            std::reverse(order.begin(), order.end());
+            std::reverse(component_sizes.begin(), component_sizes.end());
+            std::vector<uint32_t> component_offsets(component_sizes.size() + 1, 0);
+            for (size_t c = 0; c < component_sizes.size(); ++c) {
+                component_offsets[c + 1] = component_offsets[c] + component_sizes[c];
+            }
+            return {std::move(order), std::move(component_offsets)};
+        }
+
+        // Evaluates a derivation, and updates its node if the weight is better (or combines into a new weight). Returns whether the node changed.
+        bool relax(uint32_t derivation_id) {
+            const auto& d = _derivations[derivation_id];
+            auto weight = d._weight;
+            for (auto premise : d._premises) {
+                if (premise == no_node) continue;
+                if (!reached(premise)) return false;
+                weight = SolverW::add(weight, _weights[premise]);
+            }
+            if constexpr (is_selective<SolverW>) {
+                if (reached(d._node) && !SolverW::less(weight, _weights[d._node])) return false;
+                _best[d._node] = derivation_id;
+            } else {
+                if (reached(d._node)) {
+                    weight = SolverW::combine(_weights[d._node], weight);
+                    if (weight == _weights[d._node]) return false;
+                } else {
+                    _best[d._node] = derivation_id;
+                }
+            }
+            _weights[d._node] = std::move(weight);
+            return true;
+        }
+
+        template <typename It, typename MemoryFn>
+        bool solve(It begin, It end, uint32_t c, const std::vector<uint32_t>& component, std::vector<bool>& queued,
+                   const budget& limits, MemoryFn&& memory_usage) {
+            std::vector<uint32_t> changed, next;
+            // Round 0: All derivations of the SCC.
+            for (auto it = begin; it != end; ++it) {
+                if (!limits.allow_step(memory_usage)) return false;
+                for (auto i = _into_offsets[*it]; i < _into_offsets[*it + 1]; ++i) {
+                    if (relax(_into[i]) && !queued[*it]) {
+                        queued[*it] = true;
+                        changed.push_back(*it);
+                    }
+                }
+            }
+            const auto n = static_cast<size_t>(end - begin);
+            for (size_t round = 1; (is_bounded_height<SolverW> || round <= n) && !changed.empty(); ++round) {
+                for (auto node : changed) {
+                    queued[node] = false;
+                }
+                for (auto node : changed) {
+                    if (!limits.allow_step(memory_usage)) return false;
+                    for (auto i = _uses_offsets[node]; i < _uses_offsets[node + 1]; ++i) {
+                        auto target = _derivations[_uses[i]]._node;
+                        if (component[target] == c && relax(_uses[i]) && !queued[target]) {
+                            queued[target] = true;
+                            next.push_back(target);
+                        }
+                    }
+                }
+                std::swap(changed, next);
+                next.clear();
+            }
+            if constexpr (!is_bounded_height<SolverW>) {
+                if (!changed.empty()) { // Still changing in round |SCC|, so the weights are unbounded.
+                    for (auto node : changed) {
+                        queued[node] = false;
+                    }
+                    for (auto it = begin; it != end; ++it) {
+                        if (reached(*it)) _weights[*it] = SolverW::bottom();
+                    }
+                }
+            }
+            return true;
+        }
+    };
+
+}
+
+#endif //PDAAAL_SCC_FIXED_POINT_H
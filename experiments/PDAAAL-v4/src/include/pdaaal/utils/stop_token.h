@@ -0,0 +1,65 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_STOP_TOKEN_H
+#define PDAAAL_STOP_TOKEN_H
+
+#include <atomic>
+#include <memory>
+
+namespace pdaaal {
+
+    // Cooperative cancellation, modelled on C++20 std::stop_source / std::stop_token.
+    // A solver that is given a stop_token checks stop_requested() between saturation steps and returns early (without an answer) if it is set.
+    // A default constructed stop_token can never be stopped.
+    class stop_token {
+    public:
+        stop_token() = default;
+
+        [[nodiscard]] bool stop_requested() const noexcept {
+            return _state && _state->load(std::memory_order_relaxed);
+        }
+        [[nodiscard]] bool stop_possible() const noexcept {
+            return _state != nullptr;
+        }
+
+    private:
+        friend class stop_source;
+        explicit stop_token(std::shared_ptr<std::atomic<bool>> state) : _state(std::move(state)) {}
+        std::shared_ptr<std::atomic<bool>> _state;
+    };
+
+    class stop_source {
+    public:
+        stop_source() : _state(std::make_shared<std::atomic<bool>>(false)) {}
+
+        // Returns true if this call made the stop request (i.e. it was not already requested).
+        bool request_stop() noexcept {
+            return !_state->exchange(true);
+        }
+        [[nodiscard]] bool stop_requested() const noexcept {
+            return _state->load();
+        }
+        [[nodiscard]] stop_token get_token() const {
+            return stop_token(_state);
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> _state;
+    };
+
+}
+
+#endif //PDAAAL_STOP_TOKEN_H
@@ -0,0 +1,198 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_WORK_QUEUE_H
+#define PDAAAL_WORK_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <utility>
+
+namespace pdaaal {
+
+    // One work queue per worker thread. A worker takes its own newest item (LIFO), and if its queue is empty,
+    // it steals the oldest item from another worker's queue. If there is nothing to steal, the worker sleeps until an item is pushed.
+    // Termination: The number of pending items counts items that are pushed but not yet finished (see finish()),
+    // so when it reaches zero, no worker can produce more work.
+    template <typename T>
+    class work_stealing_queues {
+        struct alignas(64) queue_t { // Separate cache lines to avoid false sharing between workers.
+            std::mutex _mutex;
+            std::deque<T> _items;
+        };
+    public:
+        explicit work_stealing_queues(size_t n_workers) : _queues(n_workers) {
+            assert(n_workers > 0);
+        }
+
+        [[nodiscard]] size_t workers() const { return _queues.size(); }
+
+        void push(size_t worker, T item) {
+            assert(worker < _queues.size());
+            _pending.fetch_add(1, std::memory_order_relaxed);
+            _queued.fetch_add(1); // Before the item is in the queue, so _queued never drops below the number of queued items.
+            {
+                std::lock_guard lock(_queues[worker]._mutex);
+                _queues[worker]._items.push_back(std::move(item));
+            }
+            if (_sleeping.load() > 0) { // Either this sees the sleeping worker, or the worker sees _queued before it sleeps.
+                std::lock_guard lock(_sleep_mutex);
+                _wake.notify_one();
+            }
+        }
+
+        // Takes an item for worker, and waits while other workers may still produce one.
+        // Returns false when all items are finished, or after close().
+        bool pop(size_t worker, T& item) {
+            while (true) {
+                if (try_pop(worker, item)) return true;
+                std::unique_lock lock(_sleep_mutex);
+                _sleeping.fetch_add(1);
+                _wake.wait(lock, [this](){ return _queued.load() > 0 || done() || _closed.load(); });
+                _sleeping.fetch_sub(1);
+                if (_closed.load() || done()) return false;
+            }
+        }
+
+        // Wakes all sleeping workers and makes pop return false from now on.
+        void close() {
+            _closed = true;
+            std::lock_guard lock(_sleep_mutex);
+            _wake.notify_all();
+        }
+
+        // Takes an item for worker. Returns false if no item was available at the moment.
+        bool try_pop(size_t worker, T& item) {
+            assert(worker < _queues.size());
+            {
+                auto& own = _queues[worker];
+                std::lock_guard lock(own._mutex);
+                if (!own._items.empty()) {
+                    item = std::move(own._items.back());
+                    own._items.pop_back();
+                    _queued.fetch_sub(1);
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < _queues.size(); ++i) {
+                auto& other = _queues[(worker + i) % _queues.size()];
+                std::lock_guard lock(other._mutex);
+                if (!other._items.empty()) {
+                    item = std::move(other._items.front());
+                    other._items.pop_front();
+                    _queued.fetch_sub(1);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Must be called when an item taken by pop (or try_pop) has been processed (including pushing any new items it produced).
+        void finish() {
+            if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard lock(_sleep_mutex);
+                _wake.notify_all();
+            }
+        }
+
+        [[nodiscard]] bool done() const {
+            return _pending.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        std::vector<queue_t> _queues;
+        std::atomic<size_t> _pending{0};
+        std::atomic<size_t> _queued{0}; // Items in the queues, i.e. pushed but not yet taken.
+        std::atomic<size_t> _sleeping{0};
+        std::atomic<bool> _closed{false};
+        std::mutex _sleep_mutex;
+        std::condition_variable _wake;
+    };
+
+    // Vector where one thread at a time appends (the caller serializes emplace_back, e.g. with a lock),
+    // while other threads read without locking. Elements are stored in a list of chunks of doubling size, so they never move,
+    // and emplace_back publishes the new size after the element is written, so the first size() elements are safe to read.
+    template <typename T>
+    class append_only_vector {
+        struct chunk_t {
+            explicit chunk_t(size_t capacity) : _elements(std::make_unique<T[]>(capacity)), _capacity(capacity) {}
+            std::unique_ptr<T[]> _elements;
+            size_t _capacity;
+            std::unique_ptr<chunk_t> _next;
+        };
+        static constexpr size_t first_chunk_capacity = 8;
+    public:
+        template <typename... Args>
+        void emplace_back(Args&&... args) {
+            if (_last == nullptr) {
+                _first = std::make_unique<chunk_t>(first_chunk_capacity);
+                _last = _first.get();
+            } else if (_last_size == _last->_capacity) {
+                _last->_next = std::make_unique<chunk_t>(2 * _last->_capacity);
+                _last = _last->_next.get();
+                _last_size = 0;
+            }
+            _last->_elements[_last_size++] = T{std::forward<Args>(args)...};
+            _size.store(_size.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        [[nodiscard]] size_t size() const {
+            return _size.load(std::memory_order_acquire);
+        }
+        // Calls fn on the first n elements, where n is a value of size() read by this thread.
+        template <typename Fn>
+        void for_each(size_t n, Fn&& fn) const {
+            if (n == 0) return; // _first may be written concurrently.
+            for (const chunk_t* chunk = _first.get();; chunk = chunk->_next.get()) {
+                auto end = std::min(n, chunk->_capacity);
+                for (size_t i = 0; i < end; ++i) {
+                    fn(chunk->_elements[i]);
+                }
+                n -= end;
+                if (n == 0) return; // Do not read _next of the last chunk, which may be written concurrently.
+            }
+        }
+
+    private:
+        std::unique_ptr<chunk_t> _first;
+        chunk_t* _last = nullptr; // Only used by the writer.
+        size_t _last_size = 0;    // Only used by the writer.
+        std::atomic<size_t> _size{0};
+    };
+
+    // Runs fn(worker) for worker = 0..n_workers-1, where worker 0 runs on the calling thread.
+    inline void run_workers(size_t n_workers, const std::function<void(size_t)>& fn) {
+        std::vector<std::thread> threads;
+        threads.reserve(n_workers - 1);
+        for (size_t worker = 1; worker < n_workers; ++worker) {
+            threads.emplace_back(fn, worker);
+        }
+        fn(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+}
+
+#endif //PDAAAL_WORK_QUEUE_H
@@ -27,67 +27,265 @@
 #ifndef PDAAAL_WORKSET_H
 #define PDAAAL_WORKSET_H
 
+#include <pdaaal/utils/budget.h>
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <limits>
+#include <ostream>
 #include <stack>
 #include <queue>
+#include <string>
+#include <vector>
 
 namespace pdaaal {
 
-    template<typename Derived, typename Elem>
-    class fixed_point_workset {
-        static constexpr Elem next_round_elem = Derived::next_round_elem;
-        bool _done = false;
-        const size_t _round_limit;
-        size_t _rounds = 0;
-        std::deque<Elem> _workset;
+    // The order in which the saturation procedures (PreStarSaturation, PostStarSaturation and PostStarNoTraceSaturation) take edges from their workset.
+    //  - Default:  LIFO for pre* and FIFO for post*.
+    //  - LIFO, FIFO.
+    //  - Distance: edges from the control states closest to the goal first (see distance_workset).
+    //  - Label:    edges with the same label in batches (see label_workset).
+    //  - Goal:     for post*, A* order by the steps so far plus a lower bound on the steps to the final automaton
+    //              (see goal_workset and details::goal_bound in Solver.h). For pre* this is the same as Distance.
+    // The order does not change the saturated automaton, but it changes how soon early termination happens and how large the workset gets.
+    enum class Workset_Policy { Default, LIFO, FIFO, Distance, Label, Goal };
+
+    inline std::istream& operator>>(std::istream& in, Workset_Policy& policy) {
+        std::string token;
+        in >> token;
+        if (token == "default") {
+            policy = Workset_Policy::Default;
+        } else if (token == "lifo") {
+            policy = Workset_Policy::LIFO;
+        } else if (token == "fifo") {
+            policy = Workset_Policy::FIFO;
+        } else if (token == "distance") {
+            policy = Workset_Policy::Distance;
+        } else if (token == "label") {
+            policy = Workset_Policy::Label;
+        } else if (token == "goal") {
+            policy = Workset_Policy::Goal;
+        } else {
+            in.setstate(std::ios_base::failbit);
+        }
+        return in;
+    }
+    inline std::ostream& operator<<(std::ostream& s, Workset_Policy policy) {
+        switch (policy) {
+            case Workset_Policy::Default:
+                s << "default";
+                break;
+            case Workset_Policy::LIFO:
+                s << "lifo";
+                break;
+            case Workset_Policy::FIFO:
+                s << "fifo";
+                break;
+            case Workset_Policy::Distance:
+                s << "distance";
+                break;
+            case Workset_Policy::Label:
+                s << "label";
+                break;
+            case Workset_Policy::Goal:
+                s << "goal";
+                break;
+        }
+        return s;
+    }
+
+    // The worksets below have the same interface: push, pop (which returns the element), empty and size.
+    // Elements are edges with _from and _label members.
+
+    template<typename Elem>
+    class lifo_workset {
+        std::vector<Elem> _elems;
     public:
-        explicit fixed_point_workset(size_t round_limit) : _round_limit(round_limit) {
-            _workset.emplace_back(next_round_elem);
-        };
+        void push(const Elem& elem) {
+            _elems.push_back(elem);
+        }
+        Elem pop() {
+            assert(!_elems.empty());
+            auto elem = _elems.back();
+            _elems.pop_back();
+            return elem;
+        }
+        [[nodiscard]] bool empty() const { return _elems.empty(); }
+        [[nodiscard]] size_t size() const { return _elems.size(); }
+    };
 
-        template<bool change_is_bottom = false>
-        bool step() {
-            auto current = _workset.front();
-            _workset.pop_front();
-
-            if (current == next_round_elem) {
-                ++_rounds;
-                if (_workset.empty()) {
-                    _done = true;
-                    return false;
-                }
-                _workset.emplace_back(next_round_elem);
-                current = _workset.front();
-                _workset.pop_front();
-                assert(current != next_round_elem);
+    template<typename Elem>
+    class fifo_workset {
+        std::deque<Elem> _elems;
+    public:
+        void push(const Elem& elem) {
+            _elems.push_back(elem);
+        }
+        Elem pop() {
+            assert(!_elems.empty());
+            auto elem = _elems.front();
+            _elems.pop_front();
+            return elem;
+        }
+        [[nodiscard]] bool empty() const { return _elems.empty(); }
+        [[nodiscard]] size_t size() const { return _elems.size(); }
+    };
+
+    // Takes the element with the smallest priority first (LIFO among equal priorities), where priority(elem) gives the priority of an element.
+    // The priorities are small integers (distances), so this is a bucket queue.
+    template<typename Elem, typename PriorityFn>
+    class priority_workset {
+        PriorityFn _priority;
+        std::vector<std::vector<Elem>> _buckets;
+        size_t _min = 0;
+        size_t _size = 0;
+    public:
+        explicit priority_workset(PriorityFn priority) : _priority(std::move(priority)) {}
+
+        void push(const Elem& elem) {
+            size_t priority = _priority(elem);
+            if (priority >= _buckets.size()) {
+                _buckets.resize(priority + 1);
             }
-            if (!static_cast<Derived*>(this)->template step_with<change_is_bottom>(std::move(current))) {
-                _done = true;
-                return false;
+            _buckets[priority].push_back(elem);
+            _min = std::min(_min, priority);
+            ++_size;
+        }
+        Elem pop() {
+            assert(_size > 0);
+            while (_buckets[_min].empty()) ++_min;
+            auto elem = _buckets[_min].back();
+            _buckets[_min].pop_back();
+            --_size;
+            return elem;
+        }
+        [[nodiscard]] bool empty() const { return _size == 0; }
+        [[nodiscard]] size_t size() const { return _size; }
+    };
+
+    // The distance of the from-state of an edge (see Solver::goal_distances). States without a distance have distance 0.
+    struct state_distance {
+        std::vector<uint32_t> _distances;
+        template<typename Elem>
+        uint32_t operator()(const Elem& elem) const {
+            return elem._from < _distances.size() ? _distances[elem._from] : 0;
+        }
+    };
+
+    template<typename Elem>
+    class distance_workset : public priority_workset<Elem, state_distance> {
+    public:
+        explicit distance_workset(std::vector<uint32_t> distances = {})
+        : priority_workset<Elem, state_distance>(state_distance{std::move(distances)}) {}
+    };
+
+    // Takes the element with the smallest depth + bound(elem) first, and among equal values the one pushed first.
+    // The depth of an element is one more than the depth of the element popped before it was pushed (0 before the first pop),
+    // i.e. the number of steps that led to it, which is what FIFO order goes by. With bound(elem) a lower bound on the number of
+    // steps from the element to the goal, this is A* search: Elements on the way to the goal are taken as in FIFO order, and the others are put off.
+    template<typename Elem, typename BoundFn>
+    class goal_workset {
+        struct bucket_t {
+            std::vector<std::pair<Elem,uint32_t>> _elems; // Elements with their depth.
+            size_t _head = 0;
+        };
+        BoundFn _bound;
+        std::vector<bucket_t> _buckets;
+        size_t _min = 0;
+        size_t _size = 0;
+        uint32_t _depth = 0; // Depth of the elements pushed now.
+    public:
+        explicit goal_workset(BoundFn bound) : _bound(std::move(bound)) {}
+
+        void push(const Elem& elem) {
+            size_t priority = _depth + _bound(elem);
+            if (priority >= _buckets.size()) {
+                _buckets.resize(priority + 1);
             }
-            return true;
+            _buckets[priority]._elems.emplace_back(elem, _depth);
+            _min = std::min(_min, priority);
+            ++_size;
         }
-        void finalize() {
-            _rounds = 0; // Reset _round count and run again, this time changes gives -inf weight.
-            while (!done()) {
-                step<true>();
+        Elem pop() {
+            assert(_size > 0);
+            while (_buckets[_min]._head == _buckets[_min]._elems.size()) ++_min;
+            auto& bucket = _buckets[_min];
+            auto [elem, depth] = bucket._elems[bucket._head++];
+            if (bucket._head == bucket._elems.size()) {
+                bucket._elems.clear();
+                bucket._head = 0;
             }
+            _depth = depth + 1;
+            --_size;
+            return elem;
         }
-        [[nodiscard]] bool done() const {
-            return _done || _rounds == _round_limit;
+        [[nodiscard]] bool empty() const { return _size == 0; }
+        [[nodiscard]] size_t size() const { return _size; }
+    };
+
+    // Takes all edges with one label (LIFO), before going to the next label (in the order the labels got edges).
+    // Edges with the same label use the same rules, so a batch visits the same part of the rule index.
+    template<typename Elem>
+    class label_workset {
+        std::vector<std::vector<Elem>> _buckets;
+        std::deque<size_t> _labels; // Buckets that became non-empty. May contain buckets that were emptied again, these are skipped.
+        size_t _current = 0;
+        size_t _size = 0;
+
+        static size_t bucket(uint32_t label) { // Epsilon and wildcard (the largest labels) go to bucket 0 and 1.
+            constexpr auto max = std::numeric_limits<uint32_t>::max();
+            return label >= max - 1 ? max - label : static_cast<size_t>(label) + 2;
         }
-        void run() {
-            while(!done()) {
-                step();
+    public:
+        void push(const Elem& elem) {
+            auto b = bucket(elem._label);
+            if (b >= _buckets.size()) {
+                _buckets.resize(b + 1);
             }
-            finalize();
+            if (_buckets[b].empty()) {
+                _labels.push_back(b);
+            }
+            _buckets[b].push_back(elem);
+            ++_size;
         }
-    protected:
-        template<typename... Args>
-        auto emplace(Args&&... args){
-            return _workset.emplace_back(std::forward<Args>(args)...);
+        Elem pop() {
+            assert(_size > 0);
+            while (_current >= _buckets.size() || _buckets[_current].empty()) {
+                assert(!_labels.empty());
+                _current = _labels.front();
+                _labels.pop_front();
+            }
+            auto elem = _buckets[_current].back();
+            _buckets[_current].pop_back();
+            --_size;
+            return elem;
         }
+        [[nodiscard]] bool empty() const { return _size == 0; }
+        [[nodiscard]] size_t size() const { return _size; }
     };
+
+    // Calls fn with an empty workset for the policy (or default_policy, if policy is Default), and returns its result.
+    // distances() gives the distances for distance_workset, and goal_priority() gives the priority function for Goal.
+    // These are only called for their policy.
+    template<typename Elem, typename DistanceFn, typename GoalFn, typename Fn>
+    auto with_workset(Workset_Policy policy, Workset_Policy default_policy, DistanceFn&& distances, GoalFn&& goal_priority, Fn&& fn) {
+        switch (policy == Workset_Policy::Default ? default_policy : policy) {
+            case Workset_Policy::FIFO:
+                return fn(fifo_workset<Elem>());
+            case Workset_Policy::Distance:
+                return fn(distance_workset<Elem>(distances()));
+            case Workset_Policy::Label:
+                return fn(label_workset<Elem>());
+            case Workset_Policy::Goal:
+                return fn(goal_workset<Elem, decltype(goal_priority())>(goal_priority()));
+            case Workset_Policy::Default:
+            case Workset_Policy::LIFO:
+            default:
+                return fn(lifo_workset<Elem>());
+        }
+    }
 }
 
 #endif //PDAAAL_WORKSET_H
@@ -29,6 +29,7 @@
 
 #include <pdaaal/Solver.h>
 #include <parsing/PAutomatonParser.h>
+#include "utils/portfolio.h"
 
 namespace pdaaal {
 
@@ -75,11 +76,16 @@ namespace pdaaal {
     public:
         explicit Verifier(const std::string& caption) : verification_options{caption} {
             verification_options.add_options()
-                    ("engine,e", po::value<size_t>(&engine), "Engine. 0=no verification, 1=post*, 2=pre*, 3=dual*")
+                    ("engine,e", po::value<size_t>(&engine), "Engine. 0=no verification, 1=post*, 2=pre*, 3=dual*, 4=parallel post*, 5=portfolio (races post*, pre* and dual* on separate threads)")
                     ("trace,t", po::value<Trace_Type>(&trace_type)->default_value(Trace_Type::None), "Trace type. 0=no trace, 1=any trace, 2=shortest trace, 3=longest trace, 4=fixed-point shortest trace")
                     ("initial-automaton,i", po::value<std::string>(&initial_pa_file), "Initial PAutomaton file input.")
                     ("final-automaton,f", po::value<std::string>(&final_pa_file), "Final PAutomaton file input.")
                     ("json-automata", po::bool_switch(&json_automata), "Parse Pautomata files using JSON format.")
+                    ("dual-policy", po::value<Dual_Policy>(&dual_policy)->default_value(Dual_Policy::Alternate), "How single-threaded dual* divides the steps between post* and pre*. alternate=one step each, frontier=step the smaller workset, edges=balance the steps and inserted edges")
+                    ("workset", po::value<Workset_Policy>(&workset_policy)->default_value(Workset_Policy::Default), "Workset order of the post* and pre* engines with trace type 0 or 1 (single-threaded). default=fifo for post* and lifo for pre*, lifo, fifo, distance=edges from control states closest to the other automaton first, label=edges with the same label in batches, goal=for post*: A* order by the steps so far plus a lower bound on the steps to the final automaton using the top label")
+                    ("threads", po::value<size_t>(&threads)->default_value(1), "Number of worker threads. Used by the parallel post* engine, and by the pre* and dual* engines with trace type 0 or 1. Parallel dual* runs post* and pre* at the same time, so it uses at least two threads.")
+                    ("timeout", po::value<double>(&timeout), "Time limit in seconds for the verification. When exceeded, the answer is unknown.")
+                    ("memory-limit", po::value<size_t>(&memory_limit), "Approximate limit in MB on the memory used by the solver (edge sets and trace information). When exceeded, the answer is unknown.")
                     ;
         }
         [[nodiscard]] const po::options_description& options() const { return verification_options; }
@@ -95,26 +101,37 @@ namespace pdaaal {
                      PAutomatonParser::parse_file(final_pa_file, pda);
             PAutomatonProduct instance(pda, std::move(initial_p_automaton), std::move(final_p_automaton));
 
+            budget limits;
+            if (timeout > 0) {
+                limits.set_time_limit(timeout);
+            }
+            if (memory_limit > 0) {
+                limits.set_memory_limit(memory_limit * 1024 * 1024);
+            }
             bool result = false;
+            std::optional<Reachability> outcome; // Set by engines that give a three-valued answer, otherwise computed from result and limits.
             std::vector<typename pda_t::tracestate_t> trace;
             switch (engine) {
                 case 1: {
                     std::cout << "Using post*" << std::endl;
                     switch (trace_type) {
                         case Trace_Type::None:
-                            result = Solver::post_star_accepts<Trace_Type::None>(instance);
+                            instance.enable_emptiness_only(); // No trace, so the product automaton is not needed.
+                            result = Solver::post_star_accepts<Trace_Type::None>(instance, limits, workset_policy);
                             break;
                         case Trace_Type::Any:
-                            result = Solver::post_star_accepts<Trace_Type::Any>(instance);
+                            result = Solver::post_star_accepts<Trace_Type::Any>(instance, limits, workset_policy);
                             if (result) {
+                                instance.freeze();
                                 trace = Solver::get_trace<Trace_Type::Any>(instance);
                             }
                             break;
                         case Trace_Type::Shortest:
                             if constexpr(pda_t::has_weight) {
-                                result = Solver::post_star_accepts<Trace_Type::Shortest>(instance);
+                                result = Solver::post_star_accepts<Trace_Type::Shortest>(instance, limits);
                                 if (result) {
                                     typename pda_t::weight_type weight;
+                                    instance.freeze();
                                     std::tie(trace, weight) = Solver::get_trace<Trace_Type::Shortest>(instance);
                                     std::cout << "Weight: " << weight << std::endl;
                                 }
@@ -124,12 +141,42 @@ namespace pdaaal {
                             }
                             break;
                         case Trace_Type::Longest:
-                            assert(false);
-                            throw std::runtime_error("Cannot use fixed-point longest trace, not implemented for post* engine.");
+                            if constexpr(pda_t::has_weight) {
+                                result = Solver::post_star_fixed_point_accepts<Trace_Type::Longest>(instance, limits);
+                                if (result) {
+                                    typename pda_t::weight_type weight;
+                                    instance.freeze();
+                                    std::tie(trace, weight) = Solver::get_trace<Trace_Type::Longest>(instance);
+                                    using W = typename pda_t::weight;
+                                    if (weight == solver_weight<W,Trace_Type::Longest>::bottom()) {
+                                        std::cout << "Weight: infinity" << std::endl;
+                                    } else {
+                                        std::cout << "Weight: " << weight << std::endl;
+                                    }
+                                }
+                            } else {
+                                assert(false);
+                                throw std::runtime_error("Cannot use longest (fixed point) trace option for unweighted PDA.");
+                            }
                             break;
                         case Trace_Type::ShortestFixedPoint:
-                            assert(false);
-                            throw std::runtime_error("Cannot use fixed-point shortest trace, not implemented for post* engine.");
+                            if constexpr(pda_t::has_weight) {
+                                result = Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(instance, limits);
+                                if (result) {
+                                    typename pda_t::weight_type weight;
+                                    instance.freeze();
+                                    std::tie(trace, weight) = Solver::get_trace<Trace_Type::ShortestFixedPoint>(instance);
+                                    using W = typename pda_t::weight;
+                                    if (weight == solver_weight<W,Trace_Type::ShortestFixedPoint>::bottom()) {
+                                        std::cout << "Weight: negative infinity" << std::endl;
+                                    } else {
+                                        std::cout << "Weight: " << weight << std::endl;
+                                    }
+                                }
+                            } else {
+                                assert(false);
+                                throw std::runtime_error("Cannot use shortest (fixed point) trace option for unweighted PDA.");
+                            }
                             break;
                     }
                     break;
@@ -138,23 +185,36 @@ namespace pdaaal {
                     std::cout << "Using pre*" << std::endl;
                     switch (trace_type) {
                         case Trace_Type::None:
-                            result = Solver::pre_star_accepts(instance);
+                            instance.enable_emptiness_only();
+                            result = threads > 1 ? Solver::pre_star_parallel_accepts(instance, threads, limits) : Solver::pre_star_accepts(instance, limits, workset_policy);
                             break;
                         case Trace_Type::Any:
-                            result = Solver::pre_star_accepts(instance);
+                            result = threads > 1 ? Solver::pre_star_parallel_accepts(instance, threads, limits) : Solver::pre_star_accepts(instance, limits, workset_policy);
                             if (result) {
+                                instance.freeze();
                                 trace = Solver::get_trace(instance);
                             }
                             break;
                         case Trace_Type::Shortest:
-                            assert(false);
-                            throw std::runtime_error("Cannot use shortest trace, not implemented for pre* engine.");
+                            if constexpr(pda_t::has_weight) {
+                                result = Solver::pre_star_accepts<Trace_Type::Shortest>(instance, limits);
+                                if (result) {
+                                    typename pda_t::weight_type weight;
+                                    instance.freeze();
+                                    std::tie(trace, weight) = Solver::get_trace<Trace_Type::Shortest>(instance);
+                                    std::cout << "Weight: " << weight << std::endl;
+                                }
+                            } else {
+                                assert(false);
+                                throw std::runtime_error("Cannot use shortest trace option for unweighted PDA.");
+                            }
                             break;
                         case Trace_Type::Longest:
                             if constexpr(pda_t::has_weight) {
-                                result = Solver::pre_star_fixed_point_accepts<Trace_Type::Longest>(instance);
+                                result = Solver::pre_star_fixed_point_accepts<Trace_Type::Longest>(instance, limits);
                                 if (result) {
                                     typename pda_t::weight_type weight;
+                                    instance.freeze();
                                     std::tie(trace, weight) = Solver::get_trace<Trace_Type::Longest>(instance);
                                     using W = typename pda_t::weight;
                                     if (weight == solver_weight<W,Trace_Type::Longest>::bottom()) {
@@ -170,9 +230,10 @@ namespace pdaaal {
                             break;
                         case Trace_Type::ShortestFixedPoint:
                             if constexpr(pda_t::has_weight) {
-                                result = Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(instance);
+                                result = Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(instance, limits);
                                 if (result) {
                                     typename pda_t::weight_type weight;
+                                    instance.freeze();
                                     std::tie(trace, weight) = Solver::get_trace<Trace_Type::ShortestFixedPoint>(instance);
                                     using W = typename pda_t::weight;
                                     if (weight == solver_weight<W,Trace_Type::ShortestFixedPoint>::bottom()) {
@@ -193,17 +254,29 @@ namespace pdaaal {
                     std::cout << "Using dual*" << std::endl;
                     switch (trace_type) {
                         case Trace_Type::None:
-                            result = Solver::dual_search_accepts(instance);
+                            instance.enable_emptiness_only();
+                            result = threads > 1 ? Solver::dual_search_parallel_accepts(instance, threads, limits) : Solver::dual_search_accepts(instance, limits, dual_policy);
                             break;
                         case Trace_Type::Any:
-                            result = Solver::dual_search_accepts(instance);
+                            result = threads > 1 ? Solver::dual_search_parallel_accepts(instance, threads, limits) : Solver::dual_search_accepts(instance, limits, dual_policy);
                             if (result) {
+                                instance.freeze();
                                 trace = Solver::get_trace_dual_search(instance);
                             }
                             break;
                         case Trace_Type::Shortest:
-                            assert(false);
-                            throw std::runtime_error("Cannot use shortest trace, not implemented for dual* engine.");
+                            if constexpr(pda_t::has_weight) {
+                                result = Solver::dual_search_accepts<Trace_Type::Shortest>(instance, limits, dual_policy);
+                                if (result) {
+                                    typename pda_t::weight_type weight;
+                                    instance.freeze();
+                                    std::tie(trace, weight) = Solver::get_trace_dual_search<Trace_Type::Shortest>(instance);
+                                    std::cout << "Weight: " << weight << std::endl;
+                                }
+                            } else {
+                                assert(false);
+                                throw std::runtime_error("Cannot use shortest trace option for unweighted PDA.");
+                            }
                             break;
                         case Trace_Type::Longest:
                             assert(false);
@@ -216,8 +289,105 @@ namespace pdaaal {
                     }
                     break;
                 }
+                case 4: {
+                    std::cout << "Using parallel post* (" << threads << " threads)" << std::endl;
+                    switch (trace_type) {
+                        case Trace_Type::None:
+                            instance.enable_emptiness_only();
+                            result = Solver::post_star_parallel_accepts(instance, threads, limits);
+                            break;
+                        case Trace_Type::Any:
+                            result = Solver::post_star_parallel_accepts(instance, threads, limits);
+                            if (result) {
+                                instance.freeze();
+                                trace = Solver::get_trace(instance);
+                            }
+                            break;
+                        case Trace_Type::Shortest:
+                            assert(false);
+                            throw std::runtime_error("Cannot use shortest trace, not implemented for parallel post* engine.");
+                            break;
+                        case Trace_Type::Longest:
+                            assert(false);
+                            throw std::runtime_error("Cannot use longest trace, not implemented for parallel post* engine.");
+                            break;
+                        case Trace_Type::ShortestFixedPoint:
+                            assert(false);
+                            throw std::runtime_error("Cannot use shortest (fixed-point) trace, not implemented for parallel post* engine.");
+                            break;
+                    }
+                    break;
+                }
+                case 5: {
+                    std::cout << "Using portfolio (post*, pre*, dual*)" << std::endl;
+                    if (trace_type != Trace_Type::None && trace_type != Trace_Type::Any) {
+                        assert(false);
+                        throw std::runtime_error("Cannot use shortest or longest trace, not implemented for portfolio engine.");
+                    }
+                    // Each engine gets its own copy of the instance. The PDA is shared, so build its (lazily constructed) rule index before starting the engines.
+                    using automaton_t = std20::remove_cvref_t<decltype(instance.initial_automaton())>;
+                    PAutomatonProduct pre_instance(pda, automaton_t(instance.initial_automaton()), automaton_t(instance.final_automaton()));
+                    PAutomatonProduct dual_instance(pda, automaton_t(instance.initial_automaton()), automaton_t(instance.final_automaton()));
+                    pda.rule_index();
+                    bool no_trace = trace_type == Trace_Type::None;
+                    if (no_trace) {
+                        instance.enable_emptiness_only();
+                        pre_instance.enable_emptiness_only();
+                        dual_instance.enable_emptiness_only();
+                    }
+                    portfolio engines;
+                    engines.add_engine("post*", [&limits,&instance,no_trace](const stop_token& stop) {
+                        auto engine_limits = limits.with_stop_token(stop);
+                        return engine_limits.result(no_trace ? Solver::post_star_accepts<Trace_Type::None>(instance, engine_limits) : Solver::post_star_accepts(instance, engine_limits));
+                    });
+                    engines.add_engine("pre*", [&limits,&pre_instance](const stop_token& stop) {
+                        auto engine_limits = limits.with_stop_token(stop);
+                        return engine_limits.result(Solver::pre_star_accepts(pre_instance, engine_limits));
+                    });
+                    engines.add_engine("dual*", [&limits,&dual_instance,dual_policy = dual_policy](const stop_token& stop) {
+                        auto engine_limits = limits.with_stop_token(stop);
+                        return engine_limits.result(Solver::dual_search_accepts(dual_instance, engine_limits, dual_policy));
+                    });
+                    outcome = engines.run();
+                    result = outcome == Reachability::Reachable;
+                    engines.print_report(std::cout);
+                    if (result && !no_trace) {
+                        switch (engines.winner()) {
+                            case 0:
+                                instance.freeze();
+                                trace = Solver::get_trace(instance);
+                                break;
+                            case 1:
+                                pre_instance.freeze();
+                                trace = Solver::get_trace(pre_instance);
+                                break;
+                            case 2:
+                                dual_instance.freeze();
+                                trace = Solver::get_trace_dual_search(dual_instance);
+                                break;
+                        }
+                    }
+                    break;
+                }
+            }
+            if (!outcome) {
+                outcome = limits.result(result);
+            }
+            switch (outcome.value()) {
+                case Reachability::Reachable:
+                    std::cout << "Reachable" << std::endl;
+                    break;
+                case Reachability::NotReachable:
+                    std::cout << "Not reachable" << std::endl;
+                    break;
+                case Reachability::Unknown:
+                    std::cout << "Unknown (budget exceeded";
+                    if (limits.exceeded()) {
+                        std::cout << ": " << limits.reason();
+                    }
+                    std::cout << ")" << std::endl;
+                    break;
             }
-            std::cout << ((result) ? "Reachable" : "Not reachable") << std::endl;
             for (const auto& trace_state : trace) {
                 std::cout << "< " << trace_state._pdastate << ", [";
                 bool first = true;
@@ -237,7 +407,12 @@ namespace pdaaal {
     private:
         po::options_description verification_options;
         size_t engine = 0;
+        size_t threads = 1;
+        double timeout = 0;
+        size_t memory_limit = 0;
         Trace_Type trace_type = Trace_Type::None;
+        Dual_Policy dual_policy = Dual_Policy::Alternate;
+        Workset_Policy workset_policy = Workset_Policy::Default;
         std::string initial_pa_file, final_pa_file;
         bool json_automata = false;
         //bool print_trace = false;
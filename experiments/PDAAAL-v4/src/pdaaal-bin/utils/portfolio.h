@@ -0,0 +1,125 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PDAAAL_PORTFOLIO_H
+#define PDAAAL_PORTFOLIO_H
+
+#include <pdaaal/utils/budget.h>
+#include "stopwatch.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pdaaal {
+
+    // Races a number of engines on separate threads. The first engine to return a definite answer (not Reachability::Unknown) wins,
+    // and the other engines are cancelled through a shared stop_token.
+    // Engines must only touch their own data (e.g. their own copy of the PAutomatonProduct), and anything they share must be read-only.
+    class portfolio {
+    public:
+        using engine_fn = std::function<Reachability(const stop_token&)>;
+        static constexpr size_t no_winner = std::numeric_limits<size_t>::max();
+
+        void add_engine(std::string name, engine_fn engine) {
+            _engines.push_back(engine_t{std::move(name), std::move(engine)});
+        }
+
+        // Runs all engines and returns the answer of the winner, or Reachability::Unknown if no engine gave an answer.
+        // If all engines throw, the exception of the first engine is rethrown.
+        Reachability run() {
+            stop_source stop;
+            _winner = no_winner;
+            std::atomic<size_t> winner{no_winner};
+            std::vector<std::thread> threads;
+            threads.reserve(_engines.size());
+            for (size_t i = 0; i < _engines.size(); ++i) {
+                threads.emplace_back([this, i, &stop, &winner]() {
+                    auto& engine = _engines[i];
+                    engine._timer = stopwatch();
+                    try {
+                        engine._result = engine._fn(stop.get_token());
+                        engine._completed = !stop.stop_requested(); // Otherwise, the engine may have returned early because of the stop request.
+                        // An engine that was cancelled cannot win, since cancellation only happens after a winner is found.
+                        size_t expected = no_winner;
+                        if (engine._result != Reachability::Unknown && winner.compare_exchange_strong(expected, i)) {
+                            stop.request_stop();
+                        }
+                    } catch (...) {
+                        engine._exception = std::current_exception();
+                    }
+                    engine._timer.stop();
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            _winner = winner.load();
+            if (_winner == no_winner) {
+                if (std::all_of(_engines.begin(), _engines.end(), [](const auto& engine){ return engine._exception != nullptr; })) {
+                    std::rethrow_exception(_engines.front()._exception);
+                }
+                return Reachability::Unknown;
+            }
+            return _engines[_winner]._result;
+        }
+
+        [[nodiscard]] size_t winner() const { return _winner; }
+
+        void print_report(std::ostream& out) const {
+            if (_winner == no_winner) {
+                out << "Portfolio winner: none" << std::endl;
+            } else {
+                out << "Portfolio winner: " << _engines[_winner]._name << std::endl;
+            }
+            for (size_t i = 0; i < _engines.size(); ++i) {
+                const auto& engine = _engines[i];
+                out << "  " << engine._name << ": " << engine._timer.duration() << " s";
+                if (i == _winner) {
+                    out << " (winner)";
+                } else if (engine._exception) {
+                    out << " (failed)";
+                } else if (engine._result == Reachability::Unknown && engine._completed) {
+                    out << " (budget exceeded)";
+                } else if (engine._completed) {
+                    out << " (finished)";
+                } else {
+                    out << " (cancelled)";
+                }
+                out << std::endl;
+            }
+        }
+
+    private:
+        struct engine_t {
+            std::string _name;
+            engine_fn _fn;
+            stopwatch _timer{false};
+            Reachability _result = Reachability::Unknown;
+            bool _completed = false;
+            std::exception_ptr _exception;
+        };
+        std::vector<engine_t> _engines;
+        size_t _winner = no_winner;
+    };
+
+}
+
+#endif //PDAAAL_PORTFOLIO_H
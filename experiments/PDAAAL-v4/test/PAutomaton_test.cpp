@@ -31,6 +31,7 @@
 #include <pdaaal/TypedPDA.h>
 #include <pdaaal/Solver.h>
 #include <chrono>
+#include <sstream>
 
 using namespace pdaaal;
 
@@ -89,6 +90,86 @@ BOOST_AUTO_TEST_CASE(UnweightedPreStar)
     BOOST_CHECK_EQUAL(automaton.accepts(2, pda.encode_pre(test_stack_unreachable)), false);
 }
 
+BOOST_AUTO_TEST_CASE(UnweightedPreStarWildcard)
+{
+    // Rules with wildcard pre-label give one symbolic edge instead of one edge per label.
+    std::unordered_set<int> labels;
+    for (int i = 0; i < 1000; ++i) labels.insert(i);
+    TypedPDA<int> pda(labels);
+    pda.add_rule(0, 1, POP, 0, true, std::vector<int>{});
+    pda.add_rule(2, 0, NOOP, 0, true, std::vector<int>{});
+    pda.add_rule(3, 2, SWAP, 5, true, std::vector<int>{});
+    pda.add_rule(4, 2, SWAP, 5, false, std::vector<int>{7, 8});
+
+    PAutomaton automaton(pda, 1, std::vector<uint32_t>{});
+    Solver::pre_star(automaton);
+
+    BOOST_CHECK(automaton.accepts(3, pda.encode_pre(std::vector<int>{42})));
+    BOOST_CHECK(automaton.accepts(4, pda.encode_pre(std::vector<int>{8})));
+    BOOST_CHECK(!automaton.accepts(4, pda.encode_pre(std::vector<int>{9})));
+    BOOST_CHECK(!automaton.accepts(3, pda.encode_pre(std::vector<int>{42, 42})));
+    for (size_t state : {0, 2, 3}) {
+        BOOST_CHECK_EQUAL(automaton.states()[state]->edges().size(), 1);
+        BOOST_CHECK(automaton.states()[state]->edges().contains(1, PAutomaton<>::wildcard));
+        BOOST_CHECK_EQUAL(automaton.states()[state]->edges().begin()->second.size(), 1);
+    }
+    BOOST_CHECK_EQUAL(automaton.states()[4]->edges().begin()->second.size(), 2);
+
+    auto trace = Solver::get_trace(pda, automaton, 3, std::vector<int>{42});
+    BOOST_CHECK_EQUAL(trace.size(), 4);
+    BOOST_CHECK_EQUAL(trace[1]._pdastate, 2);
+    BOOST_CHECK_EQUAL(trace[1]._stack[0], 5);
+    BOOST_CHECK_EQUAL(trace.back()._pdastate, 1);
+    BOOST_CHECK(trace.back()._stack.empty());
+}
+
+BOOST_AUTO_TEST_CASE(UnweightedPreStarParallel)
+{
+    // The multi-threaded pre* must give the same language as the sequential one.
+    std::unordered_set<int> labels;
+    for (int i = 0; i < 8; ++i) labels.insert(i);
+    TypedPDA<int> pda(labels);
+    uint32_t seed = 42;
+    auto next = [&seed](uint32_t n) { seed = seed * 1103515245 + 12345; return (seed >> 16) % n; };
+    const size_t n_states = 40;
+    for (size_t i = 0; i < 200; ++i) {
+        auto from = next(n_states), to = next(n_states);
+        int pre = next(8), op_label = next(8);
+        switch (next(4)) {
+            case 0: pda.add_rule(from, to, POP, 0, pre); break;
+            case 1: pda.add_rule(from, to, SWAP, op_label, pre); break;
+            case 2: pda.add_rule(from, to, PUSH, op_label, pre); break;
+            default: pda.add_rule(from, to, SWAP, op_label, true, std::vector<int>{}); break;
+        }
+    }
+    std::vector<int> init_stack{1, 2};
+    PAutomaton sequential(pda, 0, pda.encode_pre(init_stack));
+    PAutomaton parallel(pda, 0, pda.encode_pre(init_stack));
+    Solver::pre_star(sequential);
+    Solver::pre_star_parallel(parallel, 4);
+
+    size_t n_accepted = 0;
+    for (size_t state = 0; state < n_states; ++state) {
+        for (int l1 = 0; l1 < 8; ++l1) {
+            for (int l2 = 0; l2 < 8; ++l2) {
+                std::vector<int> stack{l1, l2};
+                auto result = sequential.accepts(state, pda.encode_pre(stack));
+                BOOST_CHECK_EQUAL(parallel.accepts(state, pda.encode_pre(stack)), result);
+                if (result) {
+                    ++n_accepted;
+                    auto trace = Solver::get_trace(pda, parallel, state, stack);
+                    BOOST_REQUIRE(!trace.empty());
+                    BOOST_CHECK_EQUAL(trace.front()._pdastate, state);
+                    BOOST_CHECK(trace.front()._stack == stack);
+                    BOOST_CHECK_EQUAL(trace.back()._pdastate, 0);
+                    BOOST_CHECK(trace.back()._stack == init_stack);
+                }
+            }
+        }
+    }
+    BOOST_CHECK(n_accepted > 0);
+}
+
 BOOST_AUTO_TEST_CASE(UnweightedPostStar)
 {
     // This is pretty much the rules from the example in Figure 3.1 (Schwoon-php02)
@@ -116,6 +197,240 @@ BOOST_AUTO_TEST_CASE(UnweightedPostStar)
 
 }
 
+BOOST_AUTO_TEST_CASE(TraceInformationShared)
+{
+    // Equal trace information is stored once, and edges refer to it by handle.
+    std::unordered_set<char> labels{'A', 'B'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, POP, '*', 'A');
+    pda.add_rule(0, 1, SWAP, 'B', 'A');
+    PAutomaton automaton(pda, std::vector<size_t>());
+
+    auto trace1 = automaton.new_pre_trace(0);
+    auto trace2 = automaton.new_pre_trace(1);
+    BOOST_CHECK(trace1 != trace2);
+    BOOST_CHECK(automaton.new_pre_trace(0) == trace1);
+    BOOST_CHECK(automaton.new_pre_trace(1, 2) != trace2);
+    BOOST_CHECK(automaton.new_post_trace(0, 1, 0) == automaton.new_post_trace(0, 1, 0));
+    BOOST_CHECK(automaton.new_post_trace(0) != automaton.new_post_trace(1));
+
+    auto trace = automaton.get_trace(trace2);
+    BOOST_CHECK(trace.is_pre_trace());
+    BOOST_CHECK_EQUAL(trace._rule_id, 1);
+
+    automaton.add_edge(0, 1, 0, trace1);
+    automaton.add_edge(0, 1, 1, trace1);
+    BOOST_CHECK(automaton.get_trace_label(0, 0, 1) == trace1);
+    BOOST_CHECK(automaton.get_trace_label(0, 1, 1) == trace1);
+    BOOST_CHECK(trace_is_null<true>(trace_handle()));
+}
+
+BOOST_AUTO_TEST_CASE(FrozenPostStar)
+{
+    // The read-only algorithms must give the same results on the frozen (CSR) automaton as on the normal one.
+    std::unordered_set<int> labels;
+    for (int i = 0; i < 6; ++i) labels.insert(i);
+    TypedPDA<int> pda(labels);
+    uint32_t seed = 11;
+    auto next = [&seed](uint32_t n) { seed = seed * 1103515245 + 12345; return (seed >> 16) % n; };
+    const size_t n_states = 30;
+    for (size_t i = 0; i < 150; ++i) {
+        auto from = next(n_states), to = next(n_states);
+        int pre = next(6), op_label = next(6);
+        switch (next(4)) {
+            case 0: pda.add_rule(from, to, POP, 0, pre); break;
+            case 1: pda.add_rule(from, to, SWAP, op_label, pre); break;
+            case 2: pda.add_rule(from, to, PUSH, op_label, pre); break;
+            default: pda.add_rule(from, to, NOOP, 0, true, std::vector<int>{}); break;
+        }
+    }
+    std::vector<int> init_stack{1, 2};
+    PAutomaton automaton(pda, 0, pda.encode_pre(init_stack));
+    Solver::post_star(automaton);
+
+    std::vector<std::vector<int>> stacks{{}};
+    for (size_t length = 0; length < 3; ++length) {
+        std::vector<std::vector<int>> longer;
+        for (const auto& stack : stacks) {
+            for (int l = 0; l < 6; ++l) {
+                longer.push_back(stack);
+                longer.back().push_back(l);
+            }
+        }
+        stacks.insert(stacks.end(), longer.begin(), longer.end());
+    }
+    std::vector<bool> accepted;
+    for (size_t state = 0; state < n_states; ++state) {
+        for (const auto& stack : stacks) {
+            accepted.push_back(automaton.accepts(state, pda.encode_pre(stack)));
+        }
+    }
+    std::stringstream dot;
+    automaton.to_dot(dot);
+
+    automaton.freeze();
+    BOOST_CHECK(automaton.frozen());
+    size_t i = 0, n_accepted = 0;
+    for (size_t state = 0; state < n_states; ++state) {
+        for (const auto& stack : stacks) {
+            bool result = accepted[i++];
+            BOOST_CHECK_EQUAL(automaton.accepts(state, pda.encode_pre(stack)), result);
+            BOOST_CHECK_EQUAL(automaton.accept_path(state, pda.encode_pre(stack)).empty(), !result);
+            if (result) {
+                ++n_accepted;
+                auto trace = Solver::get_trace(pda, automaton, state, stack);
+                BOOST_REQUIRE(!trace.empty());
+                BOOST_CHECK_EQUAL(trace.front()._pdastate, 0);
+                BOOST_CHECK(trace.front()._stack == init_stack);
+                BOOST_CHECK_EQUAL(trace.back()._pdastate, state);
+                BOOST_CHECK(trace.back()._stack == stack);
+            }
+        }
+    }
+    BOOST_CHECK(n_accepted > 1);
+    std::stringstream frozen_dot;
+    automaton.to_dot(frozen_dot);
+    BOOST_CHECK_EQUAL(frozen_dot.str(), dot.str()); // Same edges in the same order.
+
+    automaton.thaw();
+    BOOST_CHECK(!automaton.frozen());
+    i = 0;
+    for (size_t state = 0; state < n_states; ++state) {
+        for (const auto& stack : stacks) {
+            BOOST_CHECK_EQUAL(automaton.accepts(state, pda.encode_pre(stack)), accepted[i++]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FrozenWeightedPostStar)
+{
+    std::unordered_set<char> labels{'A'};
+    TypedPDA<char, weight<int>> pda(labels);
+
+    pda.add_rule(0, 3, PUSH, 'A', 'A', 4);
+    pda.add_rule(0, 1, PUSH , 'A', 'A', 1);
+    pda.add_rule(3, 1, PUSH , 'A', 'A', 8);
+    pda.add_rule(1, 2, POP , 'A', 'A', 2);
+    pda.add_rule(2, 4, POP , 'A', 'A', 16);
+
+    std::vector<char> init_stack{'A'};
+    PAutomaton automaton(pda, 0, pda.encode_pre(init_stack));
+
+    Solver::post_star<Trace_Type::Shortest>(automaton);
+    automaton.freeze();
+
+    std::vector<char> test_stack_reachableA{'A'};
+    auto [trace4A, distance4A] = Solver::get_trace<Trace_Type::Shortest>(pda, automaton, 4, test_stack_reachableA);
+    BOOST_CHECK_EQUAL(distance4A, 30);
+    BOOST_CHECK_EQUAL(trace4A.back()._pdastate, 4);
+
+    std::vector<char> test_stack_reachableAA{'A','A'};
+    auto result2AA = automaton.accept_path<Trace_Type::Shortest>(2, pda.encode_pre(test_stack_reachableAA));
+    BOOST_CHECK_EQUAL(result2AA.second, 14);
+}
+
+BOOST_AUTO_TEST_CASE(UnweightedPostStarParallel)
+{
+    // The multi-threaded post* must give the same language as the sequential one.
+    std::unordered_set<int> labels;
+    for (int i = 0; i < 6; ++i) labels.insert(i);
+    TypedPDA<int> pda(labels);
+    uint32_t seed = 7;
+    auto next = [&seed](uint32_t n) { seed = seed * 1103515245 + 12345; return (seed >> 16) % n; };
+    const size_t n_states = 30;
+    for (size_t i = 0; i < 150; ++i) {
+        auto from = next(n_states), to = next(n_states);
+        int pre = next(6), op_label = next(6);
+        switch (next(4)) {
+            case 0: pda.add_rule(from, to, POP, 0, pre); break;
+            case 1: pda.add_rule(from, to, SWAP, op_label, pre); break;
+            case 2: pda.add_rule(from, to, PUSH, op_label, pre); break;
+            default: pda.add_rule(from, to, NOOP, 0, true, std::vector<int>{}); break;
+        }
+    }
+    std::vector<int> init_stack{1, 2};
+    PAutomaton sequential(pda, 0, pda.encode_pre(init_stack));
+    PAutomaton parallel(pda, 0, pda.encode_pre(init_stack));
+    Solver::post_star(sequential);
+    Solver::post_star_parallel(parallel, 4);
+    BOOST_CHECK_EQUAL(parallel.states().size(), sequential.states().size());
+
+    size_t n_accepted = 0;
+    for (size_t state = 0; state < n_states; ++state) {
+        std::vector<std::vector<int>> stacks{{}};
+        for (size_t length = 0; length < 3; ++length) {
+            std::vector<std::vector<int>> longer;
+            for (const auto& stack : stacks) {
+                auto result = sequential.accepts(state, pda.encode_pre(stack));
+                BOOST_CHECK_EQUAL(parallel.accepts(state, pda.encode_pre(stack)), result);
+                if (result) {
+                    ++n_accepted;
+                    auto trace = Solver::get_trace(pda, parallel, state, stack);
+                    BOOST_REQUIRE(!trace.empty());
+                    BOOST_CHECK_EQUAL(trace.front()._pdastate, 0);
+                    BOOST_CHECK(trace.front()._stack == init_stack);
+                    BOOST_CHECK_EQUAL(trace.back()._pdastate, state);
+                    BOOST_CHECK(trace.back()._stack == stack);
+                }
+                for (int l = 0; l < 6; ++l) {
+                    longer.push_back(stack);
+                    longer.back().push_back(l);
+                }
+            }
+            stacks = std::move(longer);
+        }
+    }
+    BOOST_CHECK(n_accepted > 1);
+}
+
+BOOST_AUTO_TEST_CASE(UnweightedPostStarNoTrace)
+{
+    // This is pretty much the rules from the example in Figure 3.1 (Schwoon-php02)
+    // However r_2 requires a swap and a push, which is done through auxiliary state 3.
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP, '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+
+    std::vector<char> init_stack{'A', 'A'};
+    std::vector<char> test_stack_reachable{'B', 'A', 'A', 'A'};
+    std::vector<char> test_stack_unreachable{'A', 'A', 'B', 'A'};
+
+    PAutomaton automaton_any(pda, 0, pda.encode_pre(init_stack));
+    Solver::post_star(automaton_any);
+
+    PAutomaton automaton(pda, 0, pda.encode_pre(init_stack));
+    Solver::post_star<Trace_Type::None>(automaton);
+    BOOST_CHECK_EQUAL(automaton.accepts(1, pda.encode_pre(test_stack_reachable)), true);
+    BOOST_CHECK_EQUAL(automaton.accepts(0, pda.encode_pre(test_stack_unreachable)), false);
+    BOOST_CHECK_EQUAL(automaton.states().size(), automaton_any.states().size());
+    for (size_t i = 0; i < automaton.states().size(); ++i) {
+        BOOST_CHECK_EQUAL(automaton.states()[i]->edges().size(), automaton_any.states()[i]->edges().size());
+    }
+
+    // Answer directly from the solver-side relation. The automaton is left unchanged (apart from the added states).
+    PAutomaton automaton2(pda, 0, pda.encode_pre(init_stack));
+    BOOST_CHECK_EQUAL(Solver::post_star_accepts<Trace_Type::None>(automaton2, 1, pda.encode_pre(test_stack_reachable)), true);
+    PAutomaton automaton3(pda, 0, pda.encode_pre(init_stack));
+    BOOST_CHECK_EQUAL(Solver::post_star_accepts<Trace_Type::None>(automaton3, 0, pda.encode_pre(test_stack_unreachable)), false);
+    BOOST_CHECK_EQUAL(automaton3.states()[0]->edges().size(), 1);
+
+    // With a budget, a negative answer is unknown if the budget is exceeded.
+    PAutomaton automaton4(pda, 0, pda.encode_pre(init_stack));
+    budget few_steps;
+    few_steps.set_step_limit(1);
+    auto limited = Solver::post_star_accepts<Trace_Type::None>(automaton4, 1, pda.encode_pre(test_stack_reachable), few_steps);
+    BOOST_CHECK(few_steps.result(limited) == Reachability::Unknown);
+    PAutomaton automaton5(pda, 0, pda.encode_pre(init_stack));
+    budget enough;
+    enough.set_step_limit(1000);
+    auto unreachable = Solver::post_star_accepts<Trace_Type::None>(automaton5, 0, pda.encode_pre(test_stack_unreachable), enough);
+    BOOST_CHECK(enough.result(unreachable) == Reachability::NotReachable);
+}
+
 BOOST_AUTO_TEST_CASE(UnweightedPostStarPath)
 {
     // This is pretty much the rules from the example in Figure 3.1 (Schwoon-php02)
@@ -62,6 +62,60 @@ BOOST_AUTO_TEST_CASE(LabelsMerge)
     BOOST_CHECK_EQUAL_COLLECTIONS(labels.labels().begin(), labels.labels().end(), res_labels.begin(), res_labels.end());
 }
 
+BOOST_AUTO_TEST_CASE(LabelsBitset)
+{
+    // Adding labels one at a time switches to the bitset representation once the set is large and dense enough.
+    labels_t labels;
+    std::vector<uint32_t> expected;
+    for (uint32_t l = 0; l < 200; l += 3) {
+        labels.merge(false, std::vector<uint32_t>{l});
+        expected.push_back(l);
+        BOOST_CHECK_EQUAL(labels.has_bitset(), expected.size() >= labels_t::bitset_min_size);
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(labels.labels().begin(), labels.labels().end(), expected.begin(), expected.end());
+    for (uint32_t l = 0; l < 300; ++l) {
+        BOOST_CHECK_EQUAL(labels.contains(l), l < 200 && l % 3 == 0);
+    }
+    // A sparse set does not use a bitset.
+    labels_t sparse;
+    std::vector<uint32_t> sparse_labels;
+    for (uint32_t l = 0; l < 20; ++l) sparse_labels.push_back(l * 1000);
+    sparse.merge(false, sparse_labels);
+    BOOST_CHECK(!sparse.has_bitset());
+    BOOST_CHECK(sparse.contains(3000));
+    BOOST_CHECK(!sparse.contains(3001));
+
+    // Union and intersection agree between the two representations.
+    labels_t other;
+    std::vector<uint32_t> other_labels;
+    for (uint32_t l = 1; l < 100; l += 2) other_labels.push_back(l);
+    other.merge(false, other_labels);
+    BOOST_CHECK(other.has_bitset());
+    BOOST_CHECK(labels.intersects(other));
+    BOOST_CHECK(labels.intersects(sparse));
+    BOOST_CHECK(!other.intersects(sparse));
+    BOOST_CHECK(!other.intersects(std::vector<uint32_t>{0, 2, 4, 1000}));
+    BOOST_CHECK(other.intersects(std::vector<uint32_t>{0, 2, 99}));
+
+    labels_t merged = labels;
+    merged.merge(other);
+    std::vector<uint32_t> union_labels;
+    std::set_union(expected.begin(), expected.end(), other_labels.begin(), other_labels.end(), std::back_inserter(union_labels));
+    BOOST_CHECK_EQUAL_COLLECTIONS(merged.labels().begin(), merged.labels().end(), union_labels.begin(), union_labels.end());
+    for (auto l : union_labels) BOOST_CHECK(merged.contains(l));
+    BOOST_CHECK(!merged.contains(200));
+
+    BOOST_CHECK(merged.intersect(other_labels, 1000));
+    BOOST_CHECK_EQUAL_COLLECTIONS(merged.labels().begin(), merged.labels().end(), other_labels.begin(), other_labels.end());
+    BOOST_CHECK(merged.contains(99));
+    BOOST_CHECK(!merged.contains(0));
+
+    labels.merge(true, {});
+    BOOST_CHECK(labels.wildcard());
+    BOOST_CHECK(!labels.has_bitset());
+    BOOST_CHECK(labels.contains(1000));
+}
+
 BOOST_AUTO_TEST_CASE(PDA_Container_Type) {
     std::unordered_set<char> labels{'A', 'B'};
     TypedPDA<char,weight<int>,fut::type::hash> pda(labels);
@@ -73,3 +127,91 @@ BOOST_AUTO_TEST_CASE(PDA_Container_Type) {
 
     BOOST_CHECK_EQUAL(true, true);
 }
+
+BOOST_AUTO_TEST_CASE(RuleIndexPost) {
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP, '*', 'B');
+    pda.add_rule(0, 2, SWAP, 'C', false, std::vector<char>{'A', 'B'});
+    pda.add_rule(0, 2, NOOP, '*', true, std::vector<char>{});
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+
+    auto rules_for = [&pda](size_t from, char label) {
+        std::vector<size_t> result;
+        pda.rule_index().for_each_post_rule(from, pda.encode_pre(std::vector<char>{label})[0], [&result](size_t rule_id){ result.push_back(rule_id); });
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    // Check against scanning all rules.
+    for (size_t from = 0; from < pda.states().size(); ++from) {
+        for (char label : {'A', 'B', 'C'}) {
+            std::vector<size_t> expected;
+            const auto& rules = pda.states()[from]._rules;
+            for (size_t rule_id = 0; rule_id < rules.size(); ++rule_id) {
+                if (rules[rule_id].second.contains(pda.encode_pre(std::vector<char>{label})[0])) {
+                    expected.push_back(rule_id);
+                }
+            }
+            auto actual = rules_for(from, label);
+            BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+        }
+    }
+    BOOST_CHECK_EQUAL(rules_for(0, 'A').size(), 3);
+    BOOST_CHECK_EQUAL(rules_for(0, 'C').size(), 1);
+    BOOST_CHECK_EQUAL(pda.rule_index().post_wildcard_rules(0).size(), 1);
+
+    // The index is rebuilt after adding rules.
+    pda.add_rule(0, 3, POP, '*', 'C');
+    BOOST_CHECK_EQUAL(rules_for(0, 'C').size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(RuleIndexPre) {
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(2, 1, SWAP, 'B', 'C');
+    pda.add_rule(1, 1, POP, '*', 'B');
+    pda.add_rule(0, 1, NOOP, '*', false, std::vector<char>{'A', 'C'});
+    pda.add_rule(3, 1, NOOP, '*', true, std::vector<char>{});
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+
+    auto label = [&pda](char l) { return pda.encode_pre(std::vector<char>{l})[0]; };
+    // Check against scanning all rules.
+    for (size_t to = 0; to < pda.states().size(); ++to) {
+        for (char l : {'A', 'B', 'C'}) {
+            std::vector<std::pair<size_t,size_t>> expected_op, expected_noop, actual_op, actual_noop;
+            for (size_t from = 0; from < pda.states().size(); ++from) {
+                const auto& rules = pda.states()[from]._rules;
+                for (size_t rule_id = 0; rule_id < rules.size(); ++rule_id) {
+                    const auto& [rule, pre] = rules[rule_id];
+                    if (rule._to != to) continue;
+                    if ((rule._operation == SWAP || rule._operation == PUSH) && rule._op_label == label(l)) {
+                        expected_op.emplace_back(from, rule_id);
+                    }
+                    if (rule._operation == NOOP && pre.contains(label(l))) {
+                        expected_noop.emplace_back(from, rule_id);
+                    }
+                }
+            }
+            for (const auto& entry : pda.rule_index().pre_rules(to, label(l))) {
+                actual_op.emplace_back(entry._from, entry._rule_id);
+            }
+            for (const auto& entry : pda.rule_index().pre_noop_rules(to, label(l))) {
+                actual_noop.emplace_back(entry._from, entry._rule_id);
+            }
+            for (const auto& entry : pda.rule_index().pre_noop_wildcard_rules(to)) {
+                actual_noop.emplace_back(entry._from, entry._rule_id);
+            }
+            std::sort(actual_noop.begin(), actual_noop.end());
+            BOOST_CHECK_EQUAL(actual_op.size(), expected_op.size());
+            BOOST_CHECK(actual_op == expected_op);
+            BOOST_CHECK(actual_noop == expected_noop);
+        }
+    }
+    BOOST_CHECK(pda.rule_index().pre_rules(1, label('A')).empty());
+    BOOST_CHECK_EQUAL(pda.rule_index().pre_rules(1, label('B')).size(), 2);
+    BOOST_CHECK(pda.rule_index().pre_rules(1, label('C')).empty());
+    BOOST_CHECK_EQUAL(pda.rule_index().pre_noop_rules(1, label('A')).size(), 1);
+    BOOST_CHECK_EQUAL(pda.rule_index().pre_noop_wildcard_rules(1).size(), 1);
+}
@@ -28,9 +28,26 @@
 
 #include <boost/test/unit_test.hpp>
 #include <pdaaal/Solver.h>
+#include <array>
+#include <random>
 
 using namespace pdaaal;
 
+// Random PDA with states 0-2, labels A-C and 16 rules of all operations. Each rule weight is drawn by random_weight(gen).
+template <typename W, typename WeightFn>
+TypedPDA<char, W> make_random_pda(std::mt19937& gen, WeightFn&& random_weight) {
+    TypedPDA<char, W> pda(std::unordered_set<char>{'A', 'B', 'C'});
+    const std::vector<char> labels{'A', 'B', 'C'};
+    for (size_t r = 0; r < 16; ++r) {
+        auto op = std::array<op_t,4>{POP, SWAP, NOOP, PUSH}[gen() % 4];
+        size_t from = gen() % 3, to = gen() % 3;
+        char pre = op == POP ? 'A' : labels[gen() % 3];
+        char label = labels[gen() % 3];
+        pda.add_rule(from, to, op, pre, label, random_weight(gen));
+    }
+    return pda;
+}
+
 BOOST_AUTO_TEST_CASE(SolverTest1)
 {
     // This is pretty much the rules from the example in Figure 3.1 (Schwoon-php02)
@@ -148,4 +165,666 @@ BOOST_AUTO_TEST_CASE(EarlyTerminationPreStar)
 
     auto trace = Solver::get_trace(pda, automaton, 0, test_stack_reachable);
     BOOST_CHECK_EQUAL(trace.size(), 12);
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(StopTokenPreStar)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+
+    std::vector<char> init_stack{'B', 'A', 'A', 'A'};
+    auto stack = pda.encode_pre(std::vector<char>{'A'});
+
+    // A stop request before the search starts means that no saturation steps are done, so no answer is found.
+    stop_source stop;
+    stop.request_stop();
+    PAutomaton stopped(pda, 1, pda.encode_pre(init_stack));
+    auto result = Solver::pre_star<weight<void>,false>(stopped, [](size_t, uint32_t, size_t, trace_ptr<weight<void>>) { return false; }, stop.get_token());
+    BOOST_CHECK(!result);
+    BOOST_CHECK(!stopped.accepts(0, stack));
+
+    // A token that is never stopped does not change the result.
+    stop_source never;
+    PAutomaton automaton(pda, 1, pda.encode_pre(init_stack));
+    Solver::pre_star<weight<void>,false>(automaton, [](size_t, uint32_t, size_t, trace_ptr<weight<void>>) { return false; }, never.get_token());
+    BOOST_CHECK(automaton.accepts(0, stack));
+    BOOST_CHECK(!never.stop_requested());
+    BOOST_CHECK(!stop_token().stop_possible());
+}
+
+BOOST_AUTO_TEST_CASE(BudgetPostStar)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    std::vector<char> init_stack{'A', 'A'};
+    auto stack = pda.encode_pre(std::vector<char>{'B', 'A', 'A', 'A'});
+
+    // The step limit is reached before the configuration is found, so the answer is unknown.
+    budget few_steps;
+    few_steps.set_step_limit(2);
+    PAutomaton limited(pda, 0, pda.encode_pre(init_stack));
+    auto result = Solver::post_star<Trace_Type::Any,weight<void>,false>(limited, [](size_t, uint32_t, size_t, trace_ptr<weight<void>>) { return false; }, few_steps);
+    BOOST_CHECK(few_steps.exceeded());
+    BOOST_CHECK(few_steps.reason() == budget::limit_t::steps);
+    BOOST_CHECK(few_steps.result(result || limited.accepts(1, stack)) == Reachability::Unknown);
+
+    // With enough budget, the answer is found.
+    budget enough;
+    enough.set_step_limit(1000).set_time_limit(60.0).set_memory_limit(1024 * 1024);
+    PAutomaton automaton(pda, 0, pda.encode_pre(init_stack));
+    result = Solver::post_star<Trace_Type::Any,weight<void>,false>(automaton, [](size_t, uint32_t, size_t, trace_ptr<weight<void>>) { return false; }, enough);
+    BOOST_CHECK(!enough.exceeded());
+    BOOST_CHECK(enough.steps() > 2);
+    BOOST_CHECK(enough.result(result || automaton.accepts(1, stack)) == Reachability::Reachable);
+
+    // A memory limit of zero bytes is exceeded at the first check.
+    budget no_memory;
+    no_memory.set_memory_limit(0);
+    for (size_t i = 1; i < budget::check_interval; ++i) {
+        BOOST_CHECK(no_memory.allow_step([]() -> size_t { return 1; }));
+    }
+    BOOST_CHECK(!no_memory.allow_step([]() -> size_t { return 1; }));
+    BOOST_CHECK(no_memory.reason() == budget::limit_t::memory);
+}
+
+BOOST_AUTO_TEST_CASE(StateIdTypePreStar)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    auto stack = pda.encode_pre(std::vector<char>{'C', 'A', 'A'});
+
+    // A small state id type gives the same result, as long as the automaton states fit.
+    PAutomaton automaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'A'}));
+    details::PreStarSaturation<weight<void>,false,packed_edge_set,uint8_t> saturation(automaton);
+    while (!saturation.workset_empty()) {
+        saturation.step();
+    }
+    BOOST_CHECK(automaton.accepts(2, stack));
+
+    // Otherwise, the solver refuses to run.
+    PAutomaton large(pda, 0, pda.encode_pre(std::vector<char>(300, 'A')));
+    BOOST_CHECK_THROW((details::PreStarSaturation<weight<void>,false,packed_edge_set,uint8_t>(large)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(EmptinessOnlyProduct)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    using instance_t = PAutomatonProduct<TypedPDA<char>,PAutomaton<>,weight<void>>;
+    std::vector<std::pair<std::string, std::function<bool(instance_t&)>>> engines{
+        {"pre*", [](instance_t& instance) { return Solver::pre_star_accepts(instance); }},
+        {"post*", [](instance_t& instance) { return Solver::post_star_accepts(instance); }},
+        {"post* no trace", [](instance_t& instance) { return Solver::post_star_accepts<Trace_Type::None>(instance); }},
+        {"dual*", [](instance_t& instance) { return Solver::dual_search_accepts(instance); }},
+        {"pre* no ET", [](instance_t& instance) { return Solver::pre_star_accepts_no_ET(instance); }},
+        {"post* no ET", [](instance_t& instance) { return Solver::post_star_accepts_no_ET(instance); }},
+    };
+    auto make_instance = [&pda](size_t final_state, const std::vector<char>& final_stack) {
+        return instance_t(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'A'})),
+                               PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+    };
+    // The emptiness-only product gives the same answers as the full product, but the product automaton gets no states or edges.
+    for (const auto& [final_state, final_stack, expected] : std::vector<std::tuple<size_t, std::vector<char>, bool>>{
+            {1, {'B', 'A', 'A', 'A'}, true}, {0, {'A', 'A'}, true}, {2, {'C', 'A', 'A'}, false}, {0, {'A'}, false}, {3, {'B'}, false}}) {
+        for (const auto& [name, engine] : engines) {
+            BOOST_TEST_CONTEXT(name << " to state " << final_state) {
+                auto full = make_instance(final_state, final_stack);
+                BOOST_CHECK_EQUAL(engine(full), expected);
+                auto emptiness = make_instance(final_state, final_stack);
+                emptiness.enable_emptiness_only();
+                BOOST_CHECK_EQUAL(engine(emptiness), expected);
+                BOOST_CHECK_EQUAL(emptiness.product_automaton().states().size(), pda.states().size());
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DualSearchPolicies)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    auto initial_stack = pda.encode_pre(std::vector<char>{'A', 'A'});
+    for (auto policy : {Dual_Policy::Alternate, Dual_Policy::Frontier, Dual_Policy::Edges}) {
+        BOOST_TEST_CONTEXT("Policy " << policy) {
+            for (const auto& [final_state, final_stack, expected] : std::vector<std::tuple<size_t, std::vector<char>, bool>>{
+                    {1, {'B', 'A', 'A', 'A'}, true}, {2, {'C', 'A', 'A'}, false}, {0, {'A'}, false}}) {
+                PAutomatonProduct instance(pda, PAutomaton(pda, 0, initial_stack), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                BOOST_CHECK_EQUAL(Solver::dual_search_accepts(instance, budget(), policy), expected);
+                if (expected) {
+                    auto trace = Solver::get_trace_dual_search(instance);
+                    BOOST_CHECK_EQUAL(trace.front()._pdastate, 0);
+                    BOOST_CHECK_EQUAL(trace.back()._pdastate, final_state);
+                    BOOST_CHECK(trace.back()._stack == final_stack);
+                }
+            }
+        }
+    }
+
+    // The path in the product may start with an epsilon edge from post*, where the final automaton stays in the same state.
+    TypedPDA<char> pop_pda(std::unordered_set<char>{'A', 'B', 'C'});
+    pop_pda.add_rule(0, 1, POP, '*', 'A');
+    pop_pda.add_rule(1, 2, SWAP, 'C', 'B');
+    for (auto policy : {Dual_Policy::Alternate, Dual_Policy::Frontier, Dual_Policy::Edges}) {
+        BOOST_TEST_CONTEXT("Policy " << policy) {
+            PAutomatonProduct instance(pop_pda, PAutomaton(pop_pda, 0, pop_pda.encode_pre(std::vector<char>{'A', 'B'})),
+                                       PAutomaton(pop_pda, 2, pop_pda.encode_pre(std::vector<char>{'C'})));
+            BOOST_CHECK(Solver::dual_search_accepts(instance, budget(), policy));
+            auto trace = Solver::get_trace_dual_search(instance);
+            BOOST_REQUIRE_EQUAL(trace.size(), 3);
+            BOOST_CHECK_EQUAL(trace[0]._pdastate, 0);
+            BOOST_CHECK_EQUAL(trace[1]._pdastate, 1);
+            BOOST_CHECK_EQUAL(trace[2]._pdastate, 2);
+            BOOST_CHECK(trace[2]._stack == std::vector<char>{'C'});
+        }
+    }
+
+    // Frontier steps the direction with the smaller workset, and Edges the direction that has done the least work.
+    dual_scheduler frontier(Dual_Policy::Frontier);
+    BOOST_CHECK(frontier.next(5, 3) == dual_scheduler::pre);
+    BOOST_CHECK(frontier.next(3, 5) == dual_scheduler::post);
+    dual_scheduler edges(Dual_Policy::Edges);
+    BOOST_CHECK(edges.next(1, 1) == dual_scheduler::post);
+    edges.record(dual_scheduler::post, 10); // Work 1 + 10.
+    for (size_t i = 0; i < 6; ++i) {        // Work 2 per step.
+        BOOST_CHECK(edges.next(1, 1) == dual_scheduler::pre);
+        edges.record(dual_scheduler::pre, 1);
+    }
+    BOOST_CHECK(edges.next(1, 1) == dual_scheduler::post);
+    BOOST_CHECK_EQUAL(edges.steps(dual_scheduler::pre), 6);
+    BOOST_CHECK_EQUAL(edges.edges(dual_scheduler::post), 10);
+}
+
+BOOST_AUTO_TEST_CASE(DualSearchParallel)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    auto initial_stack = pda.encode_pre(std::vector<char>{'A', 'A'});
+    for (size_t threads : {2, 4}) {
+        BOOST_TEST_CONTEXT("Threads " << threads) {
+            for (const auto& [final_state, final_stack, expected] : std::vector<std::tuple<size_t, std::vector<char>, bool>>{
+                    {1, {'B', 'A', 'A', 'A'}, true}, {2, {'C', 'A', 'A'}, false}, {0, {'A'}, false}}) {
+                PAutomatonProduct instance(pda, PAutomaton(pda, 0, initial_stack), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                BOOST_CHECK_EQUAL(Solver::dual_search_parallel_accepts(instance, threads), expected);
+                if (expected) {
+                    auto trace = Solver::get_trace_dual_search(instance);
+                    BOOST_CHECK_EQUAL(trace.front()._pdastate, 0);
+                    BOOST_CHECK_EQUAL(trace.back()._pdastate, final_state);
+                    BOOST_CHECK(trace.back()._stack == final_stack);
+                }
+                PAutomatonProduct emptiness_instance(pda, PAutomaton(pda, 0, initial_stack), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                emptiness_instance.enable_emptiness_only();
+                BOOST_CHECK_EQUAL(Solver::dual_search_parallel_accepts(emptiness_instance, threads), expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(WorksetPolicies)
+{
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP , '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    auto initial_stack = pda.encode_pre(std::vector<char>{'A', 'A'});
+    for (auto policy : {Workset_Policy::Default, Workset_Policy::LIFO, Workset_Policy::FIFO, Workset_Policy::Distance, Workset_Policy::Label, Workset_Policy::Goal}) {
+        BOOST_TEST_CONTEXT("Policy " << policy) {
+            for (const auto& [final_state, final_stack, expected] : std::vector<std::tuple<size_t, std::vector<char>, bool>>{
+                    {1, {'B', 'A', 'A', 'A'}, true}, {2, {'C', 'A', 'A'}, false}, {0, {'A'}, false}}) {
+                PAutomatonProduct post_instance(pda, PAutomaton(pda, 0, initial_stack), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                BOOST_CHECK_EQUAL(Solver::post_star_accepts(post_instance, budget(), policy), expected);
+                PAutomatonProduct pre_instance(pda, PAutomaton(pda, 0, initial_stack), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                BOOST_CHECK_EQUAL(Solver::pre_star_accepts(pre_instance, budget(), policy), expected);
+                if (expected) {
+                    for (const auto& trace : {Solver::get_trace(post_instance), Solver::get_trace(pre_instance)}) {
+                        BOOST_CHECK_EQUAL(trace.front()._pdastate, 0);
+                        BOOST_CHECK_EQUAL(trace.back()._pdastate, final_state);
+                        BOOST_CHECK(trace.back()._stack == final_stack);
+                    }
+                }
+            }
+        }
+    }
+
+    // Rules 0->1->3->2->0. The goal automaton has an edge from state 1, so the distance to the goal is 1 from 0, 2 from 2 and 3 from 3.
+    PAutomaton goal(pda, 1, pda.encode_pre(std::vector<char>{'B'}));
+    BOOST_CHECK(Solver::goal_distances(goal, true) == (std::vector<uint32_t>{1, 0, 2, 3}));
+    BOOST_CHECK(Solver::goal_distances(goal, false) == (std::vector<uint32_t>{3, 0, 2, 1}));
+
+    // Lower bounds on the rules to apply before the goal reads the edge.
+    auto A = pda.encode_pre(std::vector<char>{'A'})[0];
+    auto B = pda.encode_pre(std::vector<char>{'B'})[0];
+    details::goal_bound<weight<void>> bound(goal, Solver::goal_distances(goal, true));
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{1, B, 5}), 0); // The goal has this edge.
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{0, A, 5}), 1); // PUSH rule to 1.
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{0, B, 5}), 2); // POP rule to 0.
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{3, A, 5}), 3); // PUSH rule to 2.
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{1, A, 5}), 5); // No rules.
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{0, details::epsilon, 5}), 1);
+    BOOST_CHECK_EQUAL(bound(details::temp_edge_t{7, A, 5}), 0); // Not a PDA state.
+
+    distance_workset<details::temp_edge_t> by_distance({2, 0, 1});
+    by_distance.push({0, 0, 5});
+    by_distance.push({2, 0, 5});
+    by_distance.push({1, 0, 5});
+    by_distance.push({7, 0, 5}); // Not a PDA state, so distance 0.
+    std::vector<uint32_t> order;
+    while (!by_distance.empty()) order.push_back(by_distance.pop()._from);
+    BOOST_CHECK(order == (std::vector<uint32_t>{7, 1, 2, 0}));
+
+    // Depth + bound, and FIFO among equal values.
+    goal_workset<details::temp_edge_t, state_distance> by_goal(state_distance{{1, 0, 1, 3}});
+    by_goal.push({0, 0, 5}); // Depth 0, so 1.
+    by_goal.push({1, 0, 5}); // 0.
+    by_goal.push({2, 0, 5}); // 1.
+    BOOST_CHECK_EQUAL(by_goal.pop()._from, 1);
+    by_goal.push({1, 0, 5}); // Depth 1, so 1.
+    by_goal.push({3, 0, 5}); // 4.
+    order.clear();
+    while (!by_goal.empty()) order.push_back(by_goal.pop()._from);
+    BOOST_CHECK(order == (std::vector<uint32_t>{0, 2, 1, 3}));
+
+    label_workset<details::temp_edge_t> by_label;
+    by_label.push({0, 2, 5});
+    by_label.push({1, 1, 5});
+    by_label.push({2, 2, 5});
+    BOOST_CHECK_EQUAL(by_label.pop()._from, 2); // Label 2 first, since it got an edge first.
+    by_label.push({3, 2, 5});                   // Same label as the current batch.
+    BOOST_CHECK_EQUAL(by_label.pop()._from, 3);
+    BOOST_CHECK_EQUAL(by_label.pop()._from, 0);
+    BOOST_CHECK_EQUAL(by_label.pop()._from, 1);
+    BOOST_CHECK(by_label.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GoalWorksetEarlyTermination)
+{
+    // From <0, [A]>, a chain of 10 rules reaches <20, [A]>. The 10 other branches from 0 cannot reach state 20, and push B in each state.
+    TypedPDA<char> pda(std::unordered_set<char>{'A', 'B'});
+    for (size_t p = 0; p < 10; ++p) {
+        pda.add_rule(p == 0 ? 0 : 10 + p, 11 + p, NOOP, 'A', 'A');
+    }
+    for (size_t branch = 0; branch < 10; ++branch) {
+        size_t first = 100 + 10 * branch;
+        pda.add_rule(0, first, NOOP, 'A', 'A');
+        for (size_t p = first; p < first + 5; ++p) {
+            pda.add_rule(p, p + 1, NOOP, 'A', 'A');
+            pda.add_rule(p, p, PUSH, 'B', 'A');
+            pda.add_rule(p, p + 1, NOOP, 'B', 'B');
+        }
+    }
+    auto steps = [&pda](Workset_Policy policy) {
+        PAutomatonProduct instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A'})), PAutomaton(pda, 20, pda.encode_pre(std::vector<char>{'A'})));
+        budget limits;
+        BOOST_CHECK(Solver::post_star_accepts(instance, limits, policy));
+        BOOST_CHECK_EQUAL(Solver::get_trace(instance).size(), 11);
+        return limits.steps();
+    };
+    auto fifo_steps = steps(Workset_Policy::FIFO);
+    auto goal_steps = steps(Workset_Policy::Goal);
+    BOOST_CHECK_LT(goal_steps, fifo_steps);
+    BOOST_CHECK_LE(goal_steps, 11); // One step per rule on the chain, and the initial edge.
+}
+
+BOOST_AUTO_TEST_CASE(PostStarFixedPoint)
+{
+    // The fixed-point post* and pre* find the same weights, also when they are negative or unbounded.
+    auto check = [](const auto& pda, const auto& initial_stack, size_t final_state, const auto& final_stack, auto expected, auto trace_type) {
+        constexpr Trace_Type tt = decltype(trace_type)::value;
+        PAutomatonProduct post_instance(pda, PAutomaton(pda, 0, pda.encode_pre(initial_stack)), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+        BOOST_CHECK(Solver::post_star_fixed_point_accepts<tt>(post_instance));
+        auto [post_trace, post_weight] = Solver::get_trace<tt>(post_instance);
+        BOOST_CHECK_EQUAL(post_weight, expected);
+        PAutomatonProduct pre_instance(pda, PAutomaton(pda, 0, pda.encode_pre(initial_stack)), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+        BOOST_CHECK(Solver::pre_star_fixed_point_accepts<tt>(pre_instance));
+        auto [pre_trace, pre_weight] = Solver::get_trace<tt>(pre_instance);
+        BOOST_CHECK_EQUAL(pre_weight, expected);
+        if (!pre_trace.empty()) { // No trace is given when the weight is unbounded.
+            BOOST_CHECK_EQUAL(post_trace.size(), pre_trace.size());
+            BOOST_CHECK_EQUAL(post_trace.back()._pdastate, final_state);
+        }
+    };
+    using shortest_t = std::integral_constant<Trace_Type, Trace_Type::ShortestFixedPoint>;
+    using longest_t = std::integral_constant<Trace_Type, Trace_Type::Longest>;
+
+    TypedPDA<char, weight<int32_t>> negative(std::unordered_set<char>{'X', 'Y'});
+    negative.add_rule(0, 1, PUSH, 'X', 'X', -1);
+    negative.add_rule(0, 1, PUSH, 'Y', 'X', -4);
+    negative.add_rule(1, 2, PUSH, 'X', 'X', -1);
+    negative.add_rule(1, 2, PUSH, 'Y', 'Y', -1);
+    negative.add_rule(2, 2, POP, 'X', 'X', -2);
+    negative.add_rule(2, 2, POP, 'Y', 'Y', -1);
+    check(negative, std::vector<char>{'X'}, 2, std::vector<char>{}, -9, shortest_t{});
+
+    // Each loop pushes X2 and pops X1 for a total weight of -1, so there is no shortest trace.
+    TypedPDA<char, weight<int32_t>> ring(std::unordered_set<char>{'A', 'B', 'C'});
+    ring.add_rule(0, 0, POP, 'A', 'A', -1);
+    ring.add_rule(0, 0, PUSH, 'B', 'A', 0);
+    ring.add_rule(0, 0, SWAP, 'C', 'B', 0);
+    ring.add_rule(0, 0, SWAP, 'A', 'C', 0);
+    check(ring, std::vector<char>{'A'}, 0, std::vector<char>{}, min_weight<int32_t>::bottom(), shortest_t{});
+
+    TypedPDA<char, weight<uint32_t>> longest(std::unordered_set<char>{'A', 'B', 'C'});
+    longest.add_rule(0, 0, POP, 'A', 'A', 1);
+    longest.add_rule(0, 0, SWAP, 'B', 'A', 2);
+    longest.add_rule(0, 1, PUSH, 'C', 'B', 3);
+    longest.add_rule(0, 2, POP, 'C', 'C', 4);
+    longest.add_rule(1, 0, SWAP, 'C', 'C', 0);
+    longest.add_rule(1, 2, POP, 'C', 'C', 1);
+    check(longest, std::vector<char>{'A'}, 2, std::vector<char>{'B'}, 9, longest_t{});
+    longest.add_rule(0, 1, SWAP, 'C', 'C', 1); // Loop between state 0 and 1.
+    check(longest, std::vector<char>{'A'}, 2, std::vector<char>{'B'}, max_weight<uint32_t>::bottom(), longest_t{});
+
+    // Random PDAs with negative weights. Some of them have unbounded weights.
+    std::mt19937 gen(7);
+    for (size_t n = 0; n < 200; ++n) {
+        BOOST_TEST_CONTEXT("Random PDA " << n) {
+            auto pda = make_random_pda<weight<int32_t>>(gen, [](auto& g){ return static_cast<int32_t>(g() % 7) - 3; });
+            for (size_t final_state = 0; final_state < 3; ++final_state) {
+                for (const auto& final_stack : {std::vector<char>{}, std::vector<char>{'A'}, std::vector<char>{'B', 'A'}}) {
+                    PAutomatonProduct post_instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A'})), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                    PAutomatonProduct pre_instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A'})), PAutomaton(pda, final_state, pda.encode_pre(final_stack)));
+                    auto post_result = Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(post_instance);
+                    BOOST_CHECK_EQUAL(post_result, Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(pre_instance));
+                    if (post_result) {
+                        BOOST_CHECK_EQUAL(Solver::get_trace<Trace_Type::ShortestFixedPoint>(post_instance).second,
+                                          Solver::get_trace<Trace_Type::ShortestFixedPoint>(pre_instance).second);
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PreStarShortest)
+{
+    // The first accepting path found (when the edge of weight 9 is settled) has weight 18, but the shortest path has weight 11.
+    TypedPDA<char, weight<uint32_t>> pda(std::unordered_set<char>{'A', 'B'});
+    pda.add_rule(0, 1, POP, 'A', 'A', 9);
+    pda.add_rule(1, 2, POP, 'B', 'B', 9);
+    pda.add_rule(0, 3, POP, 'A', 'A', 1);
+    pda.add_rule(3, 2, POP, 'B', 'B', 10);
+    PAutomatonProduct instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(pda, 2, pda.encode_pre(std::vector<char>{})));
+    BOOST_CHECK(Solver::pre_star_accepts<Trace_Type::Shortest>(instance));
+    auto [trace, trace_weight] = Solver::get_trace<Trace_Type::Shortest>(instance);
+    BOOST_CHECK_EQUAL(trace_weight, 11);
+    BOOST_REQUIRE_EQUAL(trace.size(), 3);
+    BOOST_CHECK_EQUAL(trace[1]._pdastate, 3);
+    BOOST_CHECK_EQUAL(trace[2]._pdastate, 2);
+
+    // Random PDAs with non-negative weights. Dijkstra-ordered pre* finds the same weights as fixed-point pre*.
+    std::mt19937 gen(11);
+    for (size_t n = 0; n < 200; ++n) {
+        BOOST_TEST_CONTEXT("Random PDA " << n) {
+            auto random_pda = make_random_pda<weight<uint32_t>>(gen, [](auto& g){ return static_cast<uint32_t>(g() % 5); });
+            for (size_t final_state = 0; final_state < 3; ++final_state) {
+                for (const auto& final_stack : {std::vector<char>{}, std::vector<char>{'A'}, std::vector<char>{'B', 'A'}}) {
+                    PAutomatonProduct shortest_instance(random_pda, PAutomaton(random_pda, 0, random_pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(random_pda, final_state, random_pda.encode_pre(final_stack)));
+                    PAutomatonProduct fixed_point_instance(random_pda, PAutomaton(random_pda, 0, random_pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(random_pda, final_state, random_pda.encode_pre(final_stack)));
+                    auto result = Solver::pre_star_accepts<Trace_Type::Shortest>(shortest_instance);
+                    BOOST_CHECK_EQUAL(result, Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(fixed_point_instance));
+                    if (result) {
+                        auto [random_trace, random_weight] = Solver::get_trace<Trace_Type::Shortest>(shortest_instance);
+                        BOOST_CHECK_EQUAL(random_weight, Solver::get_trace<Trace_Type::ShortestFixedPoint>(fixed_point_instance).second);
+                        BOOST_REQUIRE(!random_trace.empty());
+                        BOOST_CHECK_EQUAL(random_trace.front()._pdastate, 0);
+                        BOOST_CHECK_EQUAL(random_trace.back()._pdastate, final_state);
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DualSearchShortest)
+{
+    // Both directions first meet on the path of weight 18, but the shortest path has weight 11.
+    TypedPDA<char, weight<uint32_t>> pda(std::unordered_set<char>{'A', 'B'});
+    pda.add_rule(0, 1, POP, 'A', 'A', 9);
+    pda.add_rule(1, 2, POP, 'B', 'B', 9);
+    pda.add_rule(0, 3, POP, 'A', 'A', 1);
+    pda.add_rule(3, 2, POP, 'B', 'B', 10);
+    for (auto policy : {Dual_Policy::Alternate, Dual_Policy::Frontier, Dual_Policy::Edges}) {
+        BOOST_TEST_CONTEXT("Policy " << policy) {
+            PAutomatonProduct instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(pda, 2, pda.encode_pre(std::vector<char>{})));
+            BOOST_CHECK(Solver::dual_search_accepts<Trace_Type::Shortest>(instance, budget(), policy));
+            auto [trace, trace_weight] = Solver::get_trace_dual_search<Trace_Type::Shortest>(instance);
+            BOOST_CHECK_EQUAL(trace_weight, 11);
+            BOOST_REQUIRE_EQUAL(trace.size(), 3);
+            BOOST_CHECK_EQUAL(trace[1]._pdastate, 3);
+            BOOST_CHECK_EQUAL(trace[2]._pdastate, 2);
+        }
+    }
+
+    // The shortest trace goes through <1, [B, A]>, which post* stores with an edge from a mid-state.
+    TypedPDA<char, weight<uint32_t>> push_pda(std::unordered_set<char>{'A', 'B'});
+    push_pda.add_rule(0, 1, PUSH, 'B', 'A', 5);
+    push_pda.add_rule(1, 2, POP, 'B', 'B', 5);
+    push_pda.add_rule(0, 3, NOOP, 'A', 'A', 4);
+    push_pda.add_rule(3, 4, NOOP, 'A', 'A', 4);
+    push_pda.add_rule(4, 2, NOOP, 'A', 'A', 3);
+    for (auto policy : {Dual_Policy::Alternate, Dual_Policy::Frontier, Dual_Policy::Edges}) {
+        BOOST_TEST_CONTEXT("Policy " << policy) {
+            PAutomatonProduct instance(push_pda, PAutomaton(push_pda, 0, push_pda.encode_pre(std::vector<char>{'A'})), PAutomaton(push_pda, 2, push_pda.encode_pre(std::vector<char>{'A'})));
+            BOOST_CHECK(Solver::dual_search_accepts<Trace_Type::Shortest>(instance, budget(), policy));
+            auto [trace, trace_weight] = Solver::get_trace_dual_search<Trace_Type::Shortest>(instance);
+            BOOST_CHECK_EQUAL(trace_weight, 10);
+            BOOST_REQUIRE_EQUAL(trace.size(), 3);
+            BOOST_CHECK_EQUAL(trace[1]._pdastate, 1);
+            BOOST_CHECK_EQUAL(trace[1]._stack.size(), 2);
+            BOOST_CHECK_EQUAL(trace[2]._pdastate, 2);
+
+            PAutomatonProduct push_instance(push_pda, PAutomaton(push_pda, 0, push_pda.encode_pre(std::vector<char>{'A'})), PAutomaton(push_pda, 1, push_pda.encode_pre(std::vector<char>{'B', 'A'})));
+            BOOST_CHECK(Solver::dual_search_accepts<Trace_Type::Shortest>(push_instance, budget(), policy));
+            auto [push_trace, push_weight] = Solver::get_trace_dual_search<Trace_Type::Shortest>(push_instance);
+            BOOST_CHECK_EQUAL(push_weight, 5);
+            BOOST_REQUIRE_EQUAL(push_trace.size(), 2);
+            BOOST_CHECK_EQUAL(push_trace[1]._pdastate, 1);
+        }
+    }
+
+    // The directions can only meet at <p, [B, A]> for 1 <= p <= 8, which post* stores with an edge from a mid-state.
+    // Both directions have 40 more edges to settle on the unrelated chains, so the search must stop long before either is saturated.
+    TypedPDA<char, weight<uint32_t>> chain_pda(std::unordered_set<char>{'A', 'B'});
+    chain_pda.add_rule(0, 1, PUSH, 'B', 'A', 1);
+    for (size_t p = 1; p < 8; ++p) chain_pda.add_rule(p, p + 1, NOOP, 'B', 'B', 1);
+    chain_pda.add_rule(8, 9, POP, 'B', 'B', 1);
+    for (size_t i = 0; i < 40; ++i) {
+        chain_pda.add_rule(i == 0 ? 0 : 20 + i, 21 + i, NOOP, 'A', 'A', 1);
+        chain_pda.add_rule(100 + i, i == 0 ? 9 : 99 + i, NOOP, 'A', 'A', 1);
+    }
+    for (auto policy : {Dual_Policy::Alternate, Dual_Policy::Edges}) {
+        BOOST_TEST_CONTEXT("Policy " << policy) {
+            PAutomatonProduct instance(chain_pda, PAutomaton(chain_pda, 0, chain_pda.encode_pre(std::vector<char>{'A'})), PAutomaton(chain_pda, 9, chain_pda.encode_pre(std::vector<char>{'A'})));
+            budget limits;
+            BOOST_CHECK(Solver::dual_search_accepts<Trace_Type::Shortest>(instance, limits, policy));
+            BOOST_CHECK_LT(limits.steps(), 30);
+            auto [trace, trace_weight] = Solver::get_trace_dual_search<Trace_Type::Shortest>(instance);
+            BOOST_CHECK_EQUAL(trace_weight, 9);
+            BOOST_CHECK_EQUAL(trace.size(), 10);
+        }
+    }
+
+    // Random PDAs with non-negative weights. The bidirectional search finds the same weights as fixed-point pre*.
+    std::mt19937 gen(13);
+    for (size_t n = 0; n < 200; ++n) {
+        BOOST_TEST_CONTEXT("Random PDA " << n) {
+            auto random_pda = make_random_pda<weight<uint32_t>>(gen, [](auto& g){ return static_cast<uint32_t>(g() % 5); });
+            for (size_t final_state = 0; final_state < 3; ++final_state) {
+                for (const auto& final_stack : {std::vector<char>{}, std::vector<char>{'A'}, std::vector<char>{'B', 'A'}}) {
+                    PAutomatonProduct fixed_point_instance(random_pda, PAutomaton(random_pda, 0, random_pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(random_pda, final_state, random_pda.encode_pre(final_stack)));
+                    auto expected = Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(fixed_point_instance);
+                    for (auto policy : {Dual_Policy::Alternate, Dual_Policy::Frontier, Dual_Policy::Edges}) {
+                        PAutomatonProduct instance(random_pda, PAutomaton(random_pda, 0, random_pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(random_pda, final_state, random_pda.encode_pre(final_stack)));
+                        auto result = Solver::dual_search_accepts<Trace_Type::Shortest>(instance, budget(), policy);
+                        BOOST_CHECK_EQUAL(result, expected);
+                        if (result && expected) {
+                            auto [random_trace, random_weight] = Solver::get_trace_dual_search<Trace_Type::Shortest>(instance);
+                            BOOST_CHECK_EQUAL(random_weight, Solver::get_trace<Trace_Type::ShortestFixedPoint>(fixed_point_instance).second);
+                            BOOST_REQUIRE(!random_trace.empty());
+                            BOOST_CHECK_EQUAL(random_trace.front()._pdastate, 0);
+                            BOOST_CHECK_EQUAL(random_trace.back()._pdastate, final_state);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SemiringWeights)
+{
+    // Bottleneck weights: The path through state 3 has capacity min(7,8) = 7, which is better than min(9,5) = 5 through state 1.
+    using bottleneck_w = semiring_weight<bottleneck_semiring<uint32_t>>;
+    TypedPDA<char, bottleneck_w> pda(std::unordered_set<char>{'A', 'B'});
+    pda.add_rule(0, 1, POP, 'A', 'A', 9);
+    pda.add_rule(1, 2, POP, 'B', 'B', 5);
+    pda.add_rule(0, 3, POP, 'A', 'A', 7);
+    pda.add_rule(3, 2, POP, 'B', 'B', 8);
+    PAutomatonProduct post_instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(pda, 2, pda.encode_pre(std::vector<char>{})));
+    BOOST_CHECK(Solver::post_star_accepts<Trace_Type::Shortest>(post_instance));
+    auto [trace, trace_weight] = Solver::get_trace<Trace_Type::Shortest>(post_instance);
+    BOOST_CHECK_EQUAL(trace_weight, 7);
+    BOOST_REQUIRE_EQUAL(trace.size(), 3);
+    BOOST_CHECK_EQUAL(trace[1]._pdastate, 3);
+    PAutomatonProduct fixed_point_instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(pda, 2, pda.encode_pre(std::vector<char>{})));
+    BOOST_CHECK(Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(fixed_point_instance));
+    BOOST_CHECK_EQUAL(Solver::get_trace<Trace_Type::ShortestFixedPoint>(fixed_point_instance).second, 7);
+
+    // Random PDAs. The (min,+) semiring gives the same weights as weight<uint32_t>, and all solvers agree on bottleneck weights.
+    std::mt19937 gen(17);
+    for (size_t n = 0; n < 100; ++n) {
+        BOOST_TEST_CONTEXT("Random PDA " << n) {
+            // Copies of the generator give the same rules in each PDA.
+            auto min_plus_gen = gen, bottleneck_gen = gen;
+            auto random_weight = [](auto& g){ return static_cast<uint32_t>(g() % 5); };
+            auto plain_pda = make_random_pda<weight<uint32_t>>(gen, random_weight);
+            auto min_plus_pda = make_random_pda<semiring_weight<min_plus_semiring<uint32_t>>>(min_plus_gen, random_weight);
+            auto bottleneck_pda = make_random_pda<bottleneck_w>(bottleneck_gen, [&random_weight](auto& g){ return random_weight(g) + 1; });
+            auto make_instance = [](const auto& random_pda, size_t final_state, const std::vector<char>& final_stack) {
+                return PAutomatonProduct(random_pda, PAutomaton(random_pda, 0, random_pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(random_pda, final_state, random_pda.encode_pre(final_stack)));
+            };
+            for (size_t final_state = 0; final_state < 3; ++final_state) {
+                for (const auto& final_stack : {std::vector<char>{}, std::vector<char>{'A'}, std::vector<char>{'B', 'A'}}) {
+                    auto plain_instance = make_instance(plain_pda, final_state, final_stack);
+                    auto min_plus_instance = make_instance(min_plus_pda, final_state, final_stack);
+                    auto result = Solver::post_star_accepts<Trace_Type::Shortest>(plain_instance);
+                    BOOST_CHECK_EQUAL(result, Solver::post_star_accepts<Trace_Type::Shortest>(min_plus_instance));
+                    if (result) {
+                        BOOST_CHECK_EQUAL(Solver::get_trace<Trace_Type::Shortest>(plain_instance).second,
+                                          Solver::get_trace<Trace_Type::Shortest>(min_plus_instance).second);
+                    }
+
+                    auto post_instance = make_instance(bottleneck_pda, final_state, final_stack);
+                    auto pre_instance = make_instance(bottleneck_pda, final_state, final_stack);
+                    auto fixed_instance = make_instance(bottleneck_pda, final_state, final_stack);
+                    auto dual_instance = make_instance(bottleneck_pda, final_state, final_stack);
+                    BOOST_CHECK_EQUAL(result, Solver::post_star_accepts<Trace_Type::Shortest>(post_instance));
+                    BOOST_CHECK_EQUAL(result, Solver::pre_star_accepts<Trace_Type::Shortest>(pre_instance));
+                    BOOST_CHECK_EQUAL(result, Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(fixed_instance));
+                    BOOST_CHECK_EQUAL(result, Solver::dual_search_accepts<Trace_Type::Shortest>(dual_instance));
+                    if (result) {
+                        auto expected = Solver::get_trace<Trace_Type::ShortestFixedPoint>(fixed_instance).second;
+                        BOOST_CHECK_EQUAL(Solver::get_trace<Trace_Type::Shortest>(post_instance).second, expected);
+                        BOOST_CHECK_EQUAL(Solver::get_trace<Trace_Type::Shortest>(pre_instance).second, expected);
+                        BOOST_CHECK_EQUAL(Solver::get_trace_dual_search<Trace_Type::Shortest>(dual_instance).second, expected);
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(NonSelectiveSemiringWeights)
+{
+    // Facts generated on every trace: Both traces to <2, []> generate fact 0, but facts 1 and 2 are only generated on one of them.
+    using bits_w = semiring_weight<bitvector_semiring<uint32_t>>;
+    TypedPDA<char, bits_w> pda(std::unordered_set<char>{'A', 'B'});
+    pda.add_rule(0, 1, POP, 'A', 'A', 0b011);
+    pda.add_rule(1, 2, POP, 'B', 'B', 0b100);
+    pda.add_rule(0, 3, POP, 'A', 'A', 0b001);
+    pda.add_rule(3, 2, POP, 'B', 'B', 0b000);
+    PAutomatonProduct pre_instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(pda, 2, pda.encode_pre(std::vector<char>{})));
+    BOOST_CHECK(Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(pre_instance));
+    auto [pre_trace, pre_weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(pre_instance);
+    BOOST_CHECK_EQUAL(pre_weight, 0b001);
+    BOOST_CHECK_EQUAL(pre_trace.size(), 3);
+    PAutomatonProduct post_instance(pda, PAutomaton(pda, 0, pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(pda, 2, pda.encode_pre(std::vector<char>{})));
+    BOOST_CHECK(Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(post_instance));
+    auto [post_trace, post_weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(post_instance);
+    BOOST_CHECK_EQUAL(post_weight, 0b001);
+    BOOST_CHECK_EQUAL(post_trace.size(), 3);
+
+    // Random PDAs with 3 facts. Fact i is generated on every trace, iff the shortest trace has positive weight when each rule weighs 1 if it generates fact i and 0 otherwise.
+    std::mt19937 gen(19);
+    for (size_t n = 0; n < 100; ++n) {
+        BOOST_TEST_CONTEXT("Random PDA " << n) {
+            // Copies of the generator give the same rules in each PDA.
+            std::array<std::mt19937,3> fact_gens{gen, gen, gen};
+            auto bits_pda = make_random_pda<bits_w>(gen, [](auto& g){ return static_cast<uint32_t>(g() % 8); });
+            std::vector<TypedPDA<char, weight<uint32_t>>> fact_pdas;
+            for (uint32_t fact = 0; fact < 3; ++fact) {
+                fact_pdas.push_back(make_random_pda<weight<uint32_t>>(fact_gens[fact], [fact](auto& g){ return static_cast<uint32_t>((g() % 8) >> fact) & 1; }));
+            }
+            auto make_instance = [](const auto& random_pda, size_t final_state, const std::vector<char>& final_stack) {
+                return PAutomatonProduct(random_pda, PAutomaton(random_pda, 0, random_pda.encode_pre(std::vector<char>{'A', 'B'})), PAutomaton(random_pda, final_state, random_pda.encode_pre(final_stack)));
+            };
+            for (size_t final_state = 0; final_state < 3; ++final_state) {
+                for (const auto& final_stack : {std::vector<char>{}, std::vector<char>{'A'}, std::vector<char>{'B', 'A'}}) {
+                    uint32_t expected = 0;
+                    bool expected_result = false;
+                    for (uint32_t fact = 0; fact < 3; ++fact) {
+                        auto fact_instance = make_instance(fact_pdas[fact], final_state, final_stack);
+                        expected_result = Solver::post_star_accepts<Trace_Type::Shortest>(fact_instance);
+                        if (expected_result && Solver::get_trace<Trace_Type::Shortest>(fact_instance).second > 0) {
+                            expected |= 1u << fact;
+                        }
+                    }
+                    auto pre_instance = make_instance(bits_pda, final_state, final_stack);
+                    auto post_instance = make_instance(bits_pda, final_state, final_stack);
+                    BOOST_CHECK_EQUAL(Solver::pre_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(pre_instance), expected_result);
+                    BOOST_CHECK_EQUAL(Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(post_instance), expected_result);
+                    if (expected_result) {
+                        auto [pre_trace, pre_weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(pre_instance);
+                        auto [post_trace, post_weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(post_instance);
+                        BOOST_CHECK_EQUAL(pre_weight, expected);
+                        BOOST_CHECK_EQUAL(post_weight, expected);
+                        BOOST_REQUIRE(!pre_trace.empty() && !post_trace.empty());
+                        BOOST_CHECK_EQUAL(pre_trace.back()._pdastate, final_state);
+                        BOOST_CHECK_EQUAL(post_trace.back()._pdastate, final_state);
+                    }
+                }
+            }
+        }
+    }
+}
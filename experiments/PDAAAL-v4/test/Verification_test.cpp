@@ -72,7 +72,7 @@ auto get_edge(const PAutomaton<W,indirect>& automaton, const TypedPDA<label_t,W,
     auto label_id = pda.exists_label(label).second;
     BOOST_TEST(pda.exists_state(to).first);
     auto to_id = pda.exists_state(to).second;
-    return automaton.states()[from_id]->_edges.get(to_id, label_id);
+    return automaton.states()[from_id]->edges().get(to_id, label_id);
 }
 
 BOOST_AUTO_TEST_CASE(Verification_Test_1)
@@ -103,6 +103,34 @@ BOOST_AUTO_TEST_CASE(Verification_Test_1)
     print_trace(trace, pda);
 }
 
+BOOST_AUTO_TEST_CASE(Verification_Test_1_pre_star)
+{
+    std::istringstream pda_stream(R"({
+      "pda": {
+        "states": {
+          "Zero": { "A": {"to": "Two", "swap": "B", "weight": 2} },
+          "One": { "B": {"to": "Two", "push": "B", "weight": 1} }
+        }
+      }
+    })");
+    auto pda = PdaJSONParser::parse<weight<uint32_t>,true>(pda_stream, std::cerr);
+    auto initial_p_automaton = PAutomatonParser::parse_string("< [Zero, One] , ([A]?[B])* >", pda);
+    auto final_p_automaton = PAutomatonParser::parse_string("< [Two] , [B] [B] [B] >", pda);
+    PAutomatonProduct instance(pda, std::move(initial_p_automaton), std::move(final_p_automaton));
+
+    bool result = Solver::pre_star_accepts<Trace_Type::Shortest>(instance);
+
+    BOOST_TEST(result);
+
+    auto [trace, weight] = Solver::get_trace<Trace_Type::Shortest>(instance);
+
+    BOOST_CHECK_EQUAL(weight, 1);
+    BOOST_CHECK_EQUAL(trace.size(), 2);
+
+    std::cout << "Weight: " << weight << std::endl;
+    print_trace(trace, pda);
+}
+
 BOOST_AUTO_TEST_CASE(Verification_negative_weight_test)
 {
     std::istringstream pda_stream(R"({
@@ -469,3 +497,159 @@ BOOST_AUTO_TEST_CASE(Verification_longest_trace_test)
     auto [trace, weight] = Solver::get_trace<Trace_Type::Longest>(instance);
     BOOST_CHECK_EQUAL(w, weight);
 }
+
+BOOST_AUTO_TEST_CASE(Verification_poststar_negative_weight_finite_path_test)
+{
+    std::istringstream pda_stream(R"({
+      "pda": {
+        "states": {
+          "a":  { "X":[{"to": "b", "push":"X", "weight": -1},
+                       {"to": "b", "push":"Y", "weight": -4}] },
+          "b":  { "X":{"to": "c", "push":"X", "weight": -1},
+                  "Y":{"to": "c", "push":"Y", "weight": -1} },
+          "c":  { "X":{"to": "c", "pop":"", "weight": -2},
+                  "Y":{"to": "c", "pop":"", "weight": -1} }
+        }
+      }
+    })");
+    auto pda = PdaJSONParser::parse<weight<int32_t>,true>(pda_stream, std::cerr);
+    auto p_automaton_i = PAutomatonParser::parse_string("< [a] , [X] >", pda);
+    auto p_automaton_f = PAutomatonParser::parse_string("< [c] , >", pda);
+    PAutomatonProduct instance(pda, std::move(p_automaton_i), std::move(p_automaton_f));
+
+    auto result = Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(instance);
+    BOOST_TEST(result);
+
+    auto [path, stack, w] = instance.find_path<Trace_Type::ShortestFixedPoint>();
+    BOOST_CHECK_EQUAL(w, -9);
+
+    auto [trace, weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(instance);
+    BOOST_CHECK_EQUAL(w, weight);
+    BOOST_CHECK_EQUAL(trace.size(), 6);
+
+    std::stringstream s;
+    print_trace(trace, pda, s);
+    BOOST_TEST_MESSAGE(s.str());
+}
+
+BOOST_AUTO_TEST_CASE(Verification_poststar_negative_weight_unreachable_loop_test)
+{
+    std::istringstream pda_stream(R"({
+      "pda": {
+        "states": {
+          "p":  { "X":{"to": "p", "pop":"", "weight": -1} },
+          "q":  { "Y":[{"to": "q", "push":"Y", "weight": -1},
+                       {"to": "p", "swap":"X", "weight": 1}] }
+        }
+      }
+    })");
+    auto pda = PdaJSONParser::parse<weight<int32_t>,true>(pda_stream, std::cerr);
+    auto p_automaton_i = PAutomatonParser::parse_string("< [q] , [Y] >", pda);
+    auto p_automaton_f = PAutomatonParser::parse_string("< [p] , >", pda);
+    PAutomatonProduct instance(pda, std::move(p_automaton_i), std::move(p_automaton_f));
+
+    // The push loop has negative weight, but only the trace without a push reaches the empty stack: <q,Y> -> <p,X> -> <p,>.
+    auto result = Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(instance);
+    BOOST_TEST(result);
+
+    auto [path, stack, w] = instance.find_path<Trace_Type::ShortestFixedPoint>();
+    BOOST_CHECK_EQUAL(w, 0);
+
+    auto [trace, weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(instance);
+    BOOST_CHECK_EQUAL(w, weight);
+    BOOST_CHECK_EQUAL(trace.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(Verification_poststar_negative_ring_swap_test)
+{
+    std::istringstream pda_stream(R"({
+      "pda": {
+        "states": {
+          "p": { "X1":[{"to":"p", "pop":"", "weight": -1},
+                       {"to":"p", "push":"X2", "weight": 0}],
+                 "X2": {"to":"p", "swap":"X3", "weight": 0},
+                 "X3": {"to":"p", "swap":"X4", "weight": 0},
+                 "X4": {"to":"p", "swap":"X5", "weight": 0},
+                 "X5": {"to":"p", "swap":"Xn", "weight": 0},
+                 "Xn": {"to":"p", "swap":"X1", "weight": 0}
+               }
+        }
+      }
+    })");
+    auto pda = PdaJSONParser::parse<weight<int32_t>,true>(pda_stream, std::cerr);
+    auto p_automaton_i = PAutomatonParser::parse_string("< [p] , [X1] >", pda);
+    auto p_automaton_f = PAutomatonParser::parse_string("< [p] , >", pda);
+    PAutomatonProduct instance(pda, std::move(p_automaton_i), std::move(p_automaton_f));
+
+    auto result = Solver::post_star_fixed_point_accepts<Trace_Type::ShortestFixedPoint>(instance);
+    BOOST_TEST(result);
+
+    auto [path, stack, w] = instance.find_path<Trace_Type::ShortestFixedPoint>();
+    BOOST_CHECK_EQUAL(w, min_weight<int32_t>::bottom());
+
+    auto [trace, weight] = Solver::get_trace<Trace_Type::ShortestFixedPoint>(instance);
+    BOOST_CHECK_EQUAL(w, weight);
+}
+
+BOOST_AUTO_TEST_CASE(Verification_poststar_longest_trace_test)
+{
+    std::istringstream pda_stream(R"({
+      "pda": {
+        "states": {
+          "p": { "X1":[{"to":"p", "pop":"", "weight": 1},
+                       {"to":"p", "swap":"X2", "weight": 2}],
+                 "X2": {"to":"q", "push":"X3", "weight": 3},
+                 "X3": {"to":"r", "pop":"", "weight": 4}
+               },
+          "q": { "X3": [{"to":"p", "swap":"X3", "weight": 0},
+                        {"to":"r", "pop":"", "weight": 1}] }
+        }
+      }
+    })");
+    auto pda = PdaJSONParser::parse<weight<uint32_t>,true>(pda_stream, std::cerr);
+    auto p_automaton_i = PAutomatonParser::parse_string("< [p] , [X1] >", pda);
+    auto p_automaton_f = PAutomatonParser::parse_string("< [r] , [X2] >", pda);
+    PAutomatonProduct instance(pda, std::move(p_automaton_i), std::move(p_automaton_f));
+
+    // <p,X1> -2-> <p,X2> -3-> <q,X3 X2> -0-> <p,X3 X2> -4-> <r,X2> is longer than the pop in q with weight 1.
+    auto result = Solver::post_star_fixed_point_accepts<Trace_Type::Longest>(instance);
+    BOOST_TEST(result);
+
+    auto [path, stack, w] = instance.find_path<Trace_Type::Longest>();
+    BOOST_CHECK_EQUAL(w, 9);
+
+    auto [trace, weight] = Solver::get_trace<Trace_Type::Longest>(instance);
+    BOOST_CHECK_EQUAL(w, weight);
+    BOOST_CHECK_EQUAL(trace.size(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(Verification_poststar_longest_trace_loop_test)
+{
+    std::istringstream pda_stream(R"({
+      "pda": {
+        "states": {
+          "p": { "X1":[{"to":"p", "pop":"", "weight": 1},
+                       {"to":"p", "push":"X2", "weight": 0}],
+                 "X2": {"to":"p", "swap":"X3", "weight": 0},
+                 "X3": {"to":"p", "swap":"X4", "weight": 0},
+                 "X4": {"to":"p", "swap":"X5", "weight": 0},
+                 "X5": {"to":"p", "swap":"Xn", "weight": 0},
+                 "Xn": {"to":"p", "swap":"X1", "weight": 0}
+               }
+        }
+      }
+    })");
+    auto pda = PdaJSONParser::parse<weight<uint32_t>,true>(pda_stream, std::cerr);
+    auto p_automaton_i = PAutomatonParser::parse_string("< [p] , [X1] >", pda);
+    auto p_automaton_f = PAutomatonParser::parse_string("< [p] , >", pda);
+    PAutomatonProduct instance(pda, std::move(p_automaton_i), std::move(p_automaton_f));
+
+    auto result = Solver::post_star_fixed_point_accepts<Trace_Type::Longest>(instance);
+    BOOST_TEST(result);
+
+    auto [path, stack, w] = instance.find_path<Trace_Type::Longest>();
+    BOOST_CHECK_EQUAL(w, max_weight<uint32_t>::bottom());
+
+    auto [trace, weight] = Solver::get_trace<Trace_Type::Longest>(instance);
+    BOOST_CHECK_EQUAL(w, weight);
+}
@@ -55,6 +55,19 @@ BOOST_AUTO_TEST_CASE(VectorWeight) {
     BOOST_CHECK_EQUAL(W::less(a,a), false);
 }
 
+BOOST_AUTO_TEST_CASE(SaturatingAdd) {
+    // Sums out of range become bottom when they are better than any weight, and max (the worst weight) otherwise.
+    BOOST_CHECK_EQUAL(min_weight<int32_t>::add(-2000000000, -2000000000), min_weight<int32_t>::bottom());
+    BOOST_CHECK_EQUAL(min_weight<int32_t>::add(2000000000, 2000000000), min_weight<int32_t>::max());
+    BOOST_CHECK_EQUAL(min_weight<int32_t>::add(-5, 3), -2);
+    BOOST_CHECK_EQUAL(min_weight<uint32_t>::add(4000000000, 4000000000), min_weight<uint32_t>::max());
+    BOOST_CHECK_EQUAL(max_weight<uint32_t>::add(4000000000, 4000000000), max_weight<uint32_t>::bottom());
+    BOOST_CHECK_EQUAL(max_weight<int32_t>::add(2000000000, 2000000000), max_weight<int32_t>::bottom());
+    BOOST_CHECK_EQUAL(max_weight<int32_t>::add(-2000000000, -2000000000), max_weight<int32_t>::max());
+    BOOST_CHECK_EQUAL(max_weight<uint32_t>::add(7, 8), 15);
+    BOOST_CHECK_EQUAL(min_weight<double>::add(1.5, 2), 3.5);
+}
+
 
 BOOST_AUTO_TEST_CASE(WeightFunctionCombinators) {
     // Setup some evaluation functions.
@@ -81,4 +94,37 @@ BOOST_AUTO_TEST_CASE(WeightFunctionCombinators) {
     auto result = d("Hello", 3);
     std::vector<long int> expected{5-3, 5*1, (5-3)*2+5*1*4};
     BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(SemiringWeight) {
+    // The solvers order semiring weights by combine and add them by extend.
+    using B = details::semiring_impl<bottleneck_semiring<uint32_t>>;
+    BOOST_CHECK(B::less(7, 5));
+    BOOST_CHECK(!B::less(5, 7));
+    BOOST_CHECK(!B::less(5, 5));
+    BOOST_CHECK_EQUAL(B::add(7, 5), 5);
+    BOOST_CHECK_EQUAL(B::add(B::zero(), 5), 5);
+    BOOST_CHECK_EQUAL(B::add(B::max(), 5), B::max());
+    BOOST_CHECK(is_bounded_height<B>);
+
+    using M = details::semiring_impl<min_plus_semiring<std::vector<int>>>;
+    std::vector<int> a{1,7,42};
+    std::vector<int> b{3,1};
+    auto sum = M::add(a, b);
+    std::vector<int> expected{4,8,42};
+    BOOST_CHECK_EQUAL_COLLECTIONS(sum.begin(), sum.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(M::less(a, b), min_weight<std::vector<int>>::less(a, b));
+    BOOST_CHECK_EQUAL(M::less(b, a), min_weight<std::vector<int>>::less(b, a));
+    BOOST_CHECK(!is_bounded_height<M>);
+    BOOST_CHECK_EQUAL(details::semiring_impl<min_plus_semiring<int32_t>>::add(-2000000000, -2000000000), min_weight<int32_t>::bottom());
+    BOOST_CHECK(is_selective<M> && is_selective<min_weight<int>>);
+
+    // Bitvector facts are combined to a weight that neither argument has, and ordered by the subset relation.
+    using V = details::semiring_impl<bitvector_semiring<uint8_t>>;
+    BOOST_CHECK(!is_selective<V> && is_bounded_height<V>);
+    BOOST_CHECK_EQUAL(V::combine(0b011, 0b110), 0b010);
+    BOOST_CHECK_EQUAL(V::add(0b011, 0b110), 0b111);
+    BOOST_CHECK_EQUAL(V::add(V::zero(), 0b110), 0b110);
+    BOOST_CHECK(V::less(0b010, 0b011));
+    BOOST_CHECK(!V::less(0b011, 0b110) && !V::less(0b110, 0b011));
+    BOOST_CHECK_EQUAL(V::max(), 0xff);
+}
@@ -0,0 +1,166 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE edge_set_test
+
+#include <boost/test/unit_test.hpp>
+#include <pdaaal/utils/edge_set.h>
+#include <pdaaal/Solver.h>
+#include <chrono>
+#include <random>
+
+using namespace pdaaal;
+
+template <typename EdgeSet>
+void check_edge_set(size_t n_states, size_t n_labels) {
+    EdgeSet set(n_states, n_labels);
+    std::unordered_set<std::tuple<size_t,uint32_t,size_t>, absl::Hash<std::tuple<size_t,uint32_t,size_t>>> reference;
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<size_t> state_dist(0, n_states - 1);
+    std::uniform_int_distribution<uint32_t> label_dist(0, n_labels + 1); // n_labels is used as epsilon and n_labels+1 as wildcard.
+    for (size_t i = 0; i < 10000; ++i) {
+        auto from = state_dist(gen);
+        auto label = label_dist(gen);
+        if (label == n_labels) label = std::numeric_limits<uint32_t>::max();
+        if (label == n_labels + 1) label = std::numeric_limits<uint32_t>::max() - 1;
+        auto to = state_dist(gen);
+        BOOST_CHECK_EQUAL(set.contains(from, label, to), reference.count({from, label, to}) == 1);
+        auto res = set.emplace(from, label, to);
+        BOOST_CHECK_EQUAL(res.second, reference.emplace(from, label, to).second);
+        BOOST_CHECK(set.contains(from, label, to));
+    }
+    BOOST_CHECK_EQUAL(set.size(), reference.size());
+    size_t count = 0;
+    set.for_each([&](size_t from, uint32_t label, size_t to) {
+        BOOST_CHECK_EQUAL(reference.count({from, label, to}), 1);
+        ++count;
+    });
+    BOOST_CHECK_EQUAL(count, reference.size());
+}
+
+BOOST_AUTO_TEST_CASE(PackedEdgeSet)
+{
+    check_edge_set<packed_edge_set>(50, 20);
+    check_edge_set<packed_edge_set>(1000, 3);
+}
+
+BOOST_AUTO_TEST_CASE(PackedEdgeSetWideKey)
+{
+    // Key does not fit in 64 bits, so the fallback is used.
+    packed_edge_set set(size_t(1) << 30, size_t(1) << 20);
+    BOOST_CHECK(set.emplace((size_t(1) << 30) - 1, 5, 7).second);
+    BOOST_CHECK(!set.emplace((size_t(1) << 30) - 1, 5, 7).second);
+    BOOST_CHECK(set.contains((size_t(1) << 30) - 1, 5, 7));
+    BOOST_CHECK(!set.contains(7, 5, (size_t(1) << 30) - 1));
+    BOOST_CHECK_EQUAL(set.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(DenseEdgeSet)
+{
+    check_edge_set<dense_edge_set>(50, 20);
+    BOOST_CHECK_THROW(dense_edge_set(size_t(1) << 20, 1000), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(HashEdgeSet)
+{
+    check_edge_set<hash_edge_set>(50, 20);
+}
+
+BOOST_AUTO_TEST_CASE(PackedEdgeMap)
+{
+    packed_edge_map<std::pair<int,int>> map(100, 10);
+    for (size_t i = 0; i < 100; ++i) {
+        auto [ptr, fresh] = map.emplace(i, i % 10, 99 - i, std::make_pair((int)i, 0));
+        BOOST_CHECK(fresh);
+        BOOST_CHECK_EQUAL(ptr->first, i);
+    }
+    auto [ptr, fresh] = map.emplace(3, 3, 96, std::make_pair(-1, -1));
+    BOOST_CHECK(!fresh);
+    ptr->second = 17;
+    BOOST_CHECK_EQUAL(map.find(3, 3, 96)->first, 3);
+    BOOST_CHECK_EQUAL(map.find(3, 3, 96)->second, 17);
+    BOOST_CHECK(map.find(3, 4, 96) == nullptr);
+    BOOST_CHECK_EQUAL(map.size(), 100);
+}
+
+template <typename EdgeSet>
+long long time_edge_set(size_t n_states, size_t n_labels, size_t n_inserts) {
+    std::mt19937_64 gen(1);
+    std::uniform_int_distribution<size_t> state_dist(0, n_states - 1);
+    std::uniform_int_distribution<uint32_t> label_dist(0, n_labels - 1);
+    std::vector<std::tuple<size_t,uint32_t,size_t>> edges;
+    edges.reserve(n_inserts);
+    for (size_t i = 0; i < n_inserts; ++i) {
+        edges.emplace_back(state_dist(gen), label_dist(gen), state_dist(gen));
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    EdgeSet set(n_states, n_labels);
+    size_t fresh = 0;
+    for (const auto& [from, label, to] : edges) {
+        fresh += set.emplace(from, label, to).second;
+    }
+    size_t found = 0;
+    for (const auto& [from, label, to] : edges) { // Lookups of existing edges, as done by the saturation.
+        found += set.contains(from, label, to);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    BOOST_CHECK_EQUAL(fresh, set.size());
+    BOOST_CHECK_EQUAL(found, n_inserts);
+    return std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+}
+
+BOOST_AUTO_TEST_CASE(EdgeSetPerformance)
+{
+    for (auto [n_states, n_labels] : std::vector<std::pair<size_t,size_t>>{{100, 10}, {1000, 100}, {100000, 1000}}) {
+        constexpr size_t n_inserts = 1000000;
+        auto packed = time_edge_set<packed_edge_set>(n_states, n_labels, n_inserts);
+        auto hash = time_edge_set<hash_edge_set>(n_states, n_labels, n_inserts);
+        std::string dense = "-";
+        if ((uint64_t)n_states * n_states * (n_labels + 2) <= dense_edge_set::max_bits) {
+            dense = std::to_string(time_edge_set<dense_edge_set>(n_states, n_labels, n_inserts));
+        }
+        BOOST_TEST_MESSAGE("States: " << n_states << " Labels: " << n_labels << " Packed: " << packed << " Dense: " << dense << " Hash: " << hash);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(EdgeSetSaturation)
+{
+    // The saturation gives the same automaton with each edge set variant.
+    std::unordered_set<char> labels{'A', 'B', 'C'};
+    TypedPDA<char> pda(labels);
+    pda.add_rule(0, 1, PUSH, 'B', 'A');
+    pda.add_rule(0, 0, POP, '*', 'B');
+    pda.add_rule(1, 3, SWAP, 'A', 'B');
+    pda.add_rule(2, 0, SWAP, 'B', 'C');
+    pda.add_rule(3, 2, PUSH, 'C', 'A');
+    std::vector<char> init_stack{'A', 'A'};
+
+    auto post_star = [&](auto&& saturation, PAutomaton<>& automaton) {
+        while (!saturation.workset_empty()) {
+            saturation.step();
+        }
+        return automaton.accepts(1, pda.encode_pre(std::vector<char>{'B', 'A', 'A', 'A'}));
+    };
+    PAutomaton automaton1(pda, 0, pda.encode_pre(init_stack));
+    PAutomaton automaton2(pda, 0, pda.encode_pre(init_stack));
+    PAutomaton automaton3(pda, 0, pda.encode_pre(init_stack));
+    BOOST_CHECK(post_star(details::PostStarSaturation<weight<void>,false,packed_edge_set>(automaton1), automaton1));
+    BOOST_CHECK(post_star(details::PostStarSaturation<weight<void>,false,dense_edge_set>(automaton2), automaton2));
+    BOOST_CHECK(post_star(details::PostStarSaturation<weight<void>,false,hash_edge_set>(automaton3), automaton3));
+    for (size_t i = 0; i < automaton1.states().size(); ++i) {
+        BOOST_CHECK_EQUAL(automaton1.states()[i]->edges().size(), automaton2.states()[i]->edges().size());
+        BOOST_CHECK_EQUAL(automaton1.states()[i]->edges().size(), automaton3.states()[i]->edges().size());
+    }
+}
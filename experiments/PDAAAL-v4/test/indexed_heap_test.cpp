@@ -0,0 +1,104 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE indexed_heap_test
+
+#include <boost/test/unit_test.hpp>
+#include <pdaaal/utils/indexed_heap.h>
+#include <pdaaal/PAutomaton.h>
+#include <map>
+#include <random>
+
+using namespace pdaaal;
+
+static_assert(std::is_same_v<shortest_queue<weight<uint32_t>>, indexed_radix_heap<uint32_t>>);
+static_assert(std::is_same_v<shortest_queue<weight<int32_t>>, indexed_dary_heap<int32_t, details::solver_weight_less<min_weight<int32_t>>>>);
+static_assert(std::is_same_v<shortest_queue<weight<uint32_t>, Trace_Type::Longest>, indexed_dary_heap<uint32_t, details::solver_weight_less<max_weight<uint32_t>>>>);
+
+// Runs a Dijkstra-like sequence of operations: Pushes have keys at least the last popped key, and ids are decreased and pushed again after being popped.
+// The popped keys must be the same as for a reference queue.
+template <typename Heap>
+void check_heap(uint32_t max_step) {
+    std::mt19937 gen(42);
+    Heap heap;
+    std::map<size_t,uint32_t> reference; // id -> key
+    uint32_t last = 0;
+    for (size_t round = 0; round < 20000; ++round) {
+        if (reference.empty() || gen() % 3 != 0) {
+            size_t id = gen() % 500;
+            uint32_t key = last + gen() % max_step;
+            auto it = reference.find(id);
+            bool expected = it == reference.end() || key < it->second;
+            BOOST_CHECK_EQUAL(heap.push(id, key), expected);
+            if (expected) reference[id] = key;
+        } else {
+            auto [id, key] = heap.pop();
+            auto min = std::min_element(reference.begin(), reference.end(), [](const auto& a, const auto& b){ return a.second < b.second; })->second;
+            BOOST_CHECK_EQUAL(key, min);
+            BOOST_CHECK_EQUAL(reference[id], key);
+            reference.erase(id);
+            last = key;
+        }
+        BOOST_CHECK_EQUAL(heap.size(), reference.size());
+    }
+    while (!heap.empty()) {
+        auto [id, key] = heap.pop();
+        BOOST_CHECK_EQUAL(reference[id], key);
+        reference.erase(id);
+    }
+    BOOST_CHECK(reference.empty());
+}
+
+BOOST_AUTO_TEST_CASE(DaryHeap)
+{
+    check_heap<indexed_dary_heap<uint32_t>>(10);
+    check_heap<indexed_dary_heap<uint32_t>>(100000);
+    check_heap<indexed_dary_heap<uint32_t, std::less<>, 2>>(100);
+}
+
+BOOST_AUTO_TEST_CASE(RadixHeap)
+{
+    check_heap<indexed_radix_heap<uint32_t>>(10);
+    check_heap<indexed_radix_heap<uint32_t>>(100000);
+    check_heap<indexed_radix_heap<uint64_t>>(100);
+}
+
+BOOST_AUTO_TEST_CASE(RadixHeapNonMonotone)
+{
+    // A key smaller than the last popped key is still popped before larger keys.
+    indexed_radix_heap<uint32_t> heap;
+    heap.push(0, 10);
+    heap.push(1, 20);
+    BOOST_CHECK_EQUAL(heap.pop().second, 10);
+    heap.push(2, 5);
+    BOOST_CHECK_EQUAL(heap.pop().first, 2);
+    BOOST_CHECK_EQUAL(heap.pop().first, 1);
+    BOOST_CHECK(heap.empty());
+}
+
+BOOST_AUTO_TEST_CASE(DaryHeapVectorWeight)
+{
+    using queue_t = shortest_queue<weight<std::vector<uint32_t>>>;
+    queue_t heap;
+    heap.push(0, {2, 1});
+    heap.push(1, {1, 5});
+    heap.push(2, {1, 3});
+    BOOST_CHECK(heap.push(0, {1}));   // Decrease-key. Missing elements are zero, so {1} < {1, 3}.
+    BOOST_CHECK(!heap.push(1, {3})); // Not smaller.
+    BOOST_CHECK_EQUAL(heap.pop().first, 0);
+    BOOST_CHECK_EQUAL(heap.pop().first, 2);
+    BOOST_CHECK_EQUAL(heap.pop().first, 1);
+    BOOST_CHECK(heap.empty());
+}
@@ -0,0 +1,109 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE scc_fixed_point_test
+
+#include <boost/test/unit_test.hpp>
+#include <pdaaal/utils/scc_fixed_point.h>
+#include <pdaaal/Weight.h>
+#include <random>
+#include <tuple>
+
+using namespace pdaaal;
+
+BOOST_AUTO_TEST_CASE(TwoPremises)
+{
+    // a = 1, b = a + a + 2, c = min(b + 1, a + 10), d = d + 1 (never reached).
+    scc_fixed_point<min_weight<int32_t>, char> fixed_point;
+    auto a = fixed_point.add_node(), b = fixed_point.add_node(), c = fixed_point.add_node(), d = fixed_point.add_node();
+    fixed_point.add_derivation(a, 1, 'a');
+    fixed_point.add_derivation(b, 2, 'b', a, a);
+    fixed_point.add_derivation(c, 1, 'x', b);
+    fixed_point.add_derivation(c, 10, 'y', a);
+    fixed_point.add_derivation(d, 1, 'd', d);
+    BOOST_CHECK(fixed_point.run());
+    BOOST_CHECK_EQUAL(fixed_point.weight(b), 4);
+    BOOST_CHECK_EQUAL(fixed_point.weight(c), 5);
+    BOOST_CHECK_EQUAL(fixed_point.payload(c), 'x');
+    BOOST_CHECK(!fixed_point.reached(d));
+}
+
+BOOST_AUTO_TEST_CASE(UnboundedOnlyAfterCycle)
+{
+    // Longest path 0 -> 1 <-> 2 -> 3, and 0 -> 4. The cycle between 1 and 2 has positive weight.
+    scc_fixed_point<max_weight<uint32_t>, int> fixed_point;
+    for (size_t i = 0; i < 5; ++i) fixed_point.add_node();
+    fixed_point.add_derivation(0, 0, 0);
+    fixed_point.add_derivation(1, 1, 0, 0);
+    fixed_point.add_derivation(2, 1, 0, 1);
+    fixed_point.add_derivation(1, 1, 0, 2);
+    fixed_point.add_derivation(3, 5, 0, 2);
+    fixed_point.add_derivation(4, 7, 0, 0);
+    BOOST_CHECK(fixed_point.run());
+    BOOST_CHECK_EQUAL(fixed_point.weight(0), 0);
+    BOOST_CHECK_EQUAL(fixed_point.weight(1), max_weight<uint32_t>::bottom());
+    BOOST_CHECK_EQUAL(fixed_point.weight(2), max_weight<uint32_t>::bottom());
+    BOOST_CHECK_EQUAL(fixed_point.weight(3), max_weight<uint32_t>::bottom());
+    BOOST_CHECK_EQUAL(fixed_point.weight(4), 7);
+}
+
+BOOST_AUTO_TEST_CASE(RandomGraphsBellmanFord)
+{
+    // Shortest paths from node 0 with negative edges. Compare with Bellman-Ford, where a node is -infinite if it is reachable from a node
+    // that still improves after n rounds.
+    using solverW = min_weight<int32_t>;
+    std::mt19937 gen(5);
+    for (size_t n_graph = 0; n_graph < 300; ++n_graph) {
+        const size_t n = 1 + gen() % 12;
+        std::vector<std::tuple<size_t,size_t,int32_t>> edges;
+        for (size_t i = 0, m = gen() % (2 * n + 1); i < m; ++i) {
+            edges.emplace_back(gen() % n, gen() % n, static_cast<int32_t>(gen() % 11) - 2);
+        }
+        scc_fixed_point<solverW, size_t> fixed_point;
+        for (size_t i = 0; i < n; ++i) fixed_point.add_node();
+        fixed_point.add_derivation(0, 0, n);
+        for (const auto& [from, to, weight] : edges) {
+            fixed_point.add_derivation(to, weight, from, from);
+        }
+        BOOST_CHECK(fixed_point.run());
+
+        std::vector<int64_t> distance(n, std::numeric_limits<int64_t>::max());
+        distance[0] = 0;
+        for (size_t round = 0; round < n; ++round) {
+            for (const auto& [from, to, weight] : edges) {
+                if (distance[from] != std::numeric_limits<int64_t>::max()) distance[to] = std::min(distance[to], distance[from] + weight);
+            }
+        }
+        std::vector<bool> unbounded(n, false);
+        for (const auto& [from, to, weight] : edges) {
+            if (distance[from] != std::numeric_limits<int64_t>::max() && distance[from] + weight < distance[to]) unbounded[to] = true;
+        }
+        for (size_t round = 0; round < n; ++round) {
+            for (const auto& [from, to, weight] : edges) {
+                if (unbounded[from]) unbounded[to] = true;
+            }
+        }
+        BOOST_TEST_CONTEXT("Graph " << n_graph) {
+            for (uint32_t i = 0; i < n; ++i) {
+                BOOST_CHECK_EQUAL(fixed_point.reached(i), distance[i] != std::numeric_limits<int64_t>::max());
+                if (unbounded[i]) {
+                    BOOST_CHECK_EQUAL(fixed_point.weight(i), solverW::bottom());
+                } else if (fixed_point.reached(i)) {
+                    BOOST_CHECK_EQUAL(fixed_point.weight(i), distance[i]);
+                }
+            }
+        }
+    }
+}